@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Worst case length of a COBS encoded block.
+ *
+ * @param length Length of the unencoded data.
+ * @return size_t Maximum encoded length.
+ */
+constexpr size_t cobs_max_encoded_length(size_t length) { return length + length / 254 + 1; }
+
+size_t cobs_encode(const uint8_t *input, size_t length, uint8_t *output, size_t size);
+size_t cobs_decode(const uint8_t *input, size_t length, uint8_t *output, size_t size);
@@ -1,12 +1,28 @@
 #pragma once
 
+#include <charconv>
 #include <cstdint>
-#include <iomanip>
-#include <sstream>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <vector>
 
 bool str_to_int(std::string &str, int &result, bool hex = false);
 bool str_to_vec(const std::string &str, const char delim, std::vector<std::string> &vec);
 bool num_to_hex_str(int num, std::string &str, int width = 0, bool fill = false, bool uppercase = false);
 int64_t datetime_to_epoch(int year, int month, int day, int hour, int min, int sec);
+
+/**
+ * @brief Converts a string to an integer without allocating.
+ * @details The whole string must be a valid number.
+ *
+ * @param str The input string.
+ * @param result Reference to store the converted integer.
+ * @param base The numeric base of the input string.
+ * @return bool True if the conversion is successful, False otherwise.
+ */
+template <typename T> bool to_int(std::string_view str, T &result, int base = 10) {
+    if (str.empty()) return false;
+    auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), result, base);
+    return ec == std::errc() && ptr == str.data() + str.size();
+}
@@ -1,6 +1,59 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
-#include <string>
+#include <string_view>
 
-uint16_t crc16(const std::string &input);
+#define CRC16_INIT       0xFFFF
+#define CRC16_POLYNOMIAL 0xA001 // CRC-16 MODBUS, reflected
+
+/**
+ * @brief Builds the lookup tables for the table-driven and slicing-by-4 CRC-16.
+ * @details Table 0 is the classic byte-at-a-time table. Table n gives the CRC of a byte followed by n zero bytes.
+ */
+constexpr std::array<std::array<uint16_t, 256>, 4> make_crc16_tables() {
+    std::array<std::array<uint16_t, 256>, 4> tables{};
+    for (int i = 0; i < 256; ++i) {
+        uint16_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x0001) ? (crc >> 1) ^ CRC16_POLYNOMIAL : crc >> 1;
+        }
+        tables[0][i] = crc;
+    }
+    for (int n = 1; n < 4; ++n) {
+        for (int i = 0; i < 256; ++i) {
+            uint16_t prev = tables[n - 1][i];
+            tables[n][i] = (prev >> 8) ^ tables[0][prev & 0xFF];
+        }
+    }
+    return tables;
+}
+
+inline constexpr std::array<std::array<uint16_t, 256>, 4> CRC16_TABLES = make_crc16_tables();
+
+/**
+ * @class Crc16
+ * @brief Incremental CRC-16 MODBUS calculator.
+ * @details Bytes can be folded in one at a time as they arrive, so the CRC is ready as soon as the last byte has
+ * been received.
+ */
+class Crc16 {
+  public:
+    /**
+     * @brief Folds a single byte into the CRC.
+     *
+     * @param byte The byte.
+     */
+    void update(uint8_t byte) { crc = (crc >> 8) ^ CRC16_TABLES[0][(crc ^ byte) & 0xFF]; }
+    void update(std::string_view data);
+    uint16_t value() const { return crc; }
+    void reset() { crc = CRC16_INIT; }
+
+  private:
+    uint16_t crc = CRC16_INIT;
+};
+
+uint16_t crc16(std::string_view input);
+uint16_t crc16_bitwise(std::string_view input);
+uint16_t crc16_table(std::string_view input);
+uint16_t crc16_slice4(std::string_view input);
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "message.hpp"
+
+#include <cstdint>
+
+#define LANE_COMMAND_WEIGHT 4 // Command lane messages taken per round while the bulk lane is also waiting
+#define LANE_BULK_WEIGHT    1 // Bulk lane messages taken per round
+
+namespace msg {
+
+/**
+ * @enum Lane
+ * @brief Traffic class of a message. Queued messages are taken per lane instead of in arrival order.
+ */
+enum Lane {
+    LANE_CONTROL = 0, // Time critical: ACKs, picture triggers, datetime and device status
+    LANE_COMMAND = 1, // Instructions and command status
+    LANE_BULK = 2,    // Diagnostics and settings
+    LANE_COUNT,
+};
+
+/**
+ * @brief Returns the lane of a message type.
+ *
+ * @param type Message type.
+ * @return Lane The lane messages of the type are queued in.
+ */
+constexpr Lane lane_of(MessageType type) {
+    switch (type) {
+        case RESPONSE:
+        case DATETIME:
+        case DEVICE_STATUS:
+        case PICTURE:
+        case LINK_ACK:
+            return LANE_CONTROL;
+        case INSTRUCTIONS:
+        case CMD_STATUS:
+            return LANE_COMMAND;
+        default:
+            return LANE_BULK;
+    }
+}
+
+/**
+ * @class LaneScheduler
+ * @brief Chooses the lane to take the next queued message from.
+ * @details The control lane has strict priority. The lanes below it are weighted: each round the command lane gets
+ * LANE_COMMAND_WEIGHT turns and the bulk lane LANE_BULK_WEIGHT, so a steady stream of command status still lets
+ * diagnostics through. A round ends when no waiting lane has turns left.
+ */
+class LaneScheduler {
+  public:
+    /**
+     * @brief Chooses the next lane.
+     *
+     * @param waiting Whether each lane has a message waiting.
+     * @return int The lane to take a message from, -1 if no lane is waiting.
+     */
+    int select(const bool (&waiting)[LANE_COUNT]) {
+        if (waiting[LANE_CONTROL]) return LANE_CONTROL;
+        for (int round = 0; round < 2; ++round) {
+            for (int lane = LANE_COMMAND; lane < LANE_COUNT; ++lane) {
+                if (waiting[lane] && turns[lane] > 0) return lane;
+            }
+            turns[LANE_COMMAND] = LANE_COMMAND_WEIGHT;
+            turns[LANE_BULK] = LANE_BULK_WEIGHT;
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Uses up a turn of a lane after a message was taken from it.
+     *
+     * @param lane The lane returned by select().
+     */
+    void taken(int lane) {
+        if (turns[lane] > 0) turns[lane]--;
+    }
+
+  private:
+    uint8_t turns[LANE_COUNT] = {0, LANE_COMMAND_WEIGHT, LANE_BULK_WEIGHT};
+};
+
+} // namespace msg
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "message.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define LINK_WINDOW_SIZE    4    // Sequenced frames in flight per direction
+#define LINK_RTO_INITIAL_MS 1000 // Retransmit timeout before the first RTT sample
+#define LINK_RTO_MIN_MS     100
+#define LINK_RTO_MAX_MS     10000
+#define LINK_MAX_RETRIES    6 // Transmissions of a frame before it is given up
+
+// Sequence numbers wrap at 256 and the SACK mask has 8 bits
+static_assert(LINK_WINDOW_SIZE > 0 && LINK_WINDOW_SIZE <= 8 && (LINK_WINDOW_SIZE & (LINK_WINDOW_SIZE - 1)) == 0,
+              "LINK_WINDOW_SIZE must be a power of two no larger than 8");
+
+namespace msg {
+
+/**
+ * @class LinkStats
+ * @brief Counters for tuning the link: messages per type and direction, ACK round trip times and buffer levels.
+ * @details Each end keeps one instance. The counters are plain integers without locking, a sample lost to a race
+ * between tasks doesn't matter for statistics. Frames that fail to decode are counted with type UNASSIGNED, the type
+ * byte of a corrupted frame can't be trusted.
+ */
+class LinkStats {
+  public:
+    /**
+     * @enum Counter
+     * @brief Events counted per message type.
+     */
+    enum Counter {
+        SENT,          // Frames written, retransmissions included
+        RECEIVED,      // Frames decoded, duplicates included
+        CRC_FAILED,    // Frames dropped because of a CRC, framing or schema error
+        NACKED,        // Messages the peer answered with a NACK
+        RETRANSMITTED, // Frames written again after a timeout, a NACK or a selective ACK
+        COUNTER_COUNT,
+    };
+
+    /**
+     * @enum Buffer
+     * @brief Buffers whose high-water mark is tracked.
+     */
+    enum Buffer {
+        RX_BUFFER, // Received bytes waiting to be parsed
+        TX_BUFFER, // Bytes waiting to be transmitted
+        RX_QUEUE,  // Received messages waiting to be handled
+        BUFFER_COUNT,
+    };
+
+    void count(Counter counter, MessageType type);
+    void rtt(uint32_t rtt_ms);
+    void level(Buffer buffer, uint32_t used);
+    void reset();
+    std::string summary() const;
+
+    uint32_t get(Counter counter, MessageType type) const { return counters[counter][index(type)]; }
+    uint32_t total(Counter counter) const;
+    uint32_t rtt_samples() const { return rtt_count; }
+    uint32_t rtt_min() const { return rtt_count > 0 ? rtt_min_ms : 0; }
+    uint32_t rtt_avg() const { return rtt_count > 0 ? static_cast<uint32_t>(rtt_sum_ms / rtt_count) : 0; }
+    uint32_t rtt_max() const { return rtt_max_ms; }
+    uint32_t high_water(Buffer buffer) const { return high_water_marks[buffer]; }
+
+  private:
+    static size_t index(MessageType type) { return type > UNASSIGNED && type <= LINK_ACK ? type : UNASSIGNED; }
+
+    uint32_t counters[COUNTER_COUNT][LINK_ACK + 1] = {};
+    uint32_t rtt_count = 0;
+    uint32_t rtt_min_ms = 0;
+    uint32_t rtt_max_ms = 0;
+    uint64_t rtt_sum_ms = 0;
+    uint32_t high_water_marks[BUFFER_COUNT] = {};
+};
+
+/**
+ * @class LinkSender
+ * @brief Transmit side of the sliding-window link.
+ * @details Assigns sequence numbers to outgoing records and keeps a copy of every unacknowledged record so it can be
+ * retransmitted. Acknowledgements are cumulative with a selective ACK mask for frames received out of order. The
+ * retransmit timeout follows the smoothed round trip time (RFC 6298) and RTT samples are only taken from frames that
+ * were sent once (Karn's algorithm). The class doesn't touch any hardware, the owner transmits the returned records
+ * and passes in the current time.
+ */
+class LinkSender {
+  public:
+    /**
+     * @enum State
+     * @brief Delivery state of a sequence number.
+     */
+    enum State { PENDING, ACKED, FAILED };
+
+    bool can_send() const;
+    const Record *send(const Record &rec, uint32_t now_ms);
+    int on_ack(uint8_t cumulative, uint8_t sack, uint32_t now_ms);
+    const Record *poll(uint32_t now_ms);
+    State state(uint8_t seq) const;
+    void reset();
+    void set_stats(LinkStats *link_stats) { stats = link_stats; }
+
+    size_t in_flight() const { return static_cast<uint8_t>(next_seq - base); }
+    uint32_t rto() const { return rto_ms; }
+    uint32_t srtt() const { return srtt_x8 / 8; }
+    uint32_t retransmissions() const { return retransmit_count; }
+    uint32_t failures() const { return failure_count; }
+
+  private:
+    struct Slot {
+        Record rec;
+        uint32_t sent_ms = 0;
+        uint8_t transmissions = 0;
+        bool acked = false;
+        bool due = false; // Retransmit on the next poll
+    };
+
+    Slot &slot(uint8_t seq) { return slots[seq % LINK_WINDOW_SIZE]; }
+    const Slot &slot(uint8_t seq) const { return slots[seq % LINK_WINDOW_SIZE]; }
+    void sample_rtt(uint32_t rtt_ms);
+    void advance();
+
+    Slot slots[LINK_WINDOW_SIZE];
+    uint8_t base = 0;         // Oldest unacknowledged sequence number
+    uint8_t next_seq = 0;     // Sequence number of the next new frame
+    uint8_t peer_expected = 0; // Next sequence number the peer is waiting for, from the last acknowledgement
+    uint8_t failed[32] = {0}; // Bit per sequence number, set when the frame was given up
+    uint32_t srtt_x8 = 0;     // Smoothed RTT, scaled by 8
+    uint32_t rttvar_x4 = 0;   // RTT variation, scaled by 4
+    uint32_t rto_ms = LINK_RTO_INITIAL_MS;
+    uint32_t retransmit_count = 0;
+    uint32_t failure_count = 0;
+    LinkStats *stats = nullptr; // Receives RTT samples and retransmissions if set
+};
+
+/**
+ * @class LinkReceiver
+ * @brief Receive side of the sliding-window link.
+ * @details Buffers frames that arrive out of order and releases them in sequence. Duplicates are dropped but still
+ * acknowledged, since the previous acknowledgement may have been lost. A frame more than a window ahead means the
+ * sender gave up on the missing frames before it, so the receiver skips them instead of stalling.
+ */
+class LinkReceiver {
+  public:
+    bool accept(const Record &rec);
+    const Record *front() const;
+    void pop();
+    uint8_t cumulative() const { return expected - 1; }
+    uint8_t sack() const;
+    void reset();
+
+  private:
+    bool has(uint8_t seq) const;
+    void skip_abandoned();
+
+    Record slots[LINK_WINDOW_SIZE];
+    bool received[LINK_WINDOW_SIZE] = {false};
+    uint8_t expected = 0;  // Next in-order sequence number
+    uint8_t abandoned = 0; // Number of sequence numbers from expected on that the sender has given up
+};
+
+} // namespace msg
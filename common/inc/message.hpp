@@ -2,10 +2,19 @@
 
 #include "convert.hpp"
 #include "crc.hpp"
+#include <charconv>
 #include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#define MSG_MAX_FIELDS  4   // Maximum number of content fields in a Record or View
+#define MSG_RECORD_SIZE 240 // Storage for the content fields of a Record
+#define MSG_MAX_LENGTH  256 // Buffer size that fits any encoded message
+
+#define MSG_BINARY_DELIMITER 0x00 // Starts and ends a binary frame
+
 namespace msg {
 
 /**
@@ -25,6 +34,17 @@ enum MessageType {
     WIFI = 8,          // Send wifi info
     SERVER = 9,        // Send server info
     API = 10,          // Send api token
+    LINK_ACK = 11,     // Acknowledges sequenced messages, see link.hpp
+};
+
+/**
+ * @enum Capability
+ * @brief Link features advertised in the optional second field of a DEVICE_STATUS message.
+ */
+enum Capability {
+    CAP_NONE = 0,
+    CAP_BINARY_FRAMING = 0x01, // Accepts binary frames, see encode_binary()
+    CAP_SEQUENCED = 0x02,      // Sends and acknowledges sequenced messages, see link.hpp
 };
 
 /**
@@ -37,10 +57,139 @@ struct Message {
     std::vector<std::string> content;
 };
 
+/**
+ * @struct Record
+ * @brief Fixed-size representation of a message that can be queued without heap allocation.
+ * @details The content fields are stored back to back in an internal buffer and accessed as string views.
+ */
+struct Record {
+    MessageType type = UNASSIGNED;
+    int16_t seq = -1; // Link sequence number, -1 if the message isn't sequenced
+    uint8_t count = 0;
+    uint16_t used = 0;
+    uint16_t offsets[MSG_MAX_FIELDS] = {0};
+    uint16_t lengths[MSG_MAX_FIELDS] = {0};
+    char data[MSG_RECORD_SIZE];
+
+    bool add(std::string_view field);
+    std::string_view field(size_t index) const;
+    void clear();
+
+    /**
+     * @brief Converts a content field to an integer.
+     *
+     * @param index Index of the field.
+     * @param result Reference to store the converted integer.
+     * @return bool True if the field exists and is a valid integer, False otherwise.
+     */
+    template <typename T> bool field_to_int(size_t index, T &result) const { return to_int(field(index), result); }
+};
+
+/**
+ * @struct View
+ * @brief Decoded message whose content fields point into the decoded buffer.
+ * @details Decoding into a View doesn't copy or allocate. The View is only valid as long as the decoded buffer.
+ */
+struct View {
+    MessageType type = UNASSIGNED;
+    int16_t seq = -1; // Link sequence number, -1 if the message isn't sequenced
+    uint8_t count = 0;
+    std::string_view fields[MSG_MAX_FIELDS];
+
+    std::string_view field(size_t index) const;
+
+    /**
+     * @brief Converts a content field to an integer.
+     *
+     * @param index Index of the field.
+     * @param result Reference to store the converted integer.
+     * @return bool True if the field exists and is a valid integer, False otherwise.
+     */
+    template <typename T> bool field_to_int(size_t index, T &result) const { return to_int(field(index), result); }
+};
+
+/**
+ * @class FrameCrc
+ * @brief Computes the CRC of a message while it is being received.
+ * @details Every byte from the '$' up to, but not including, the ';' is passed to update(). The CRC is snapshotted at
+ * each ',' so when the ';' arrives payload_crc() holds the CRC of everything before the CRC field.
+ */
+class FrameCrc {
+  public:
+    /**
+     * @brief Folds a received byte into the CRC.
+     *
+     * @param c The received byte.
+     */
+    void update(char c) {
+        if (c == ',') { at_last_comma = running.value(); }
+        running.update(static_cast<uint8_t>(c));
+    }
+    uint16_t payload_crc() const { return at_last_comma; }
+    void reset() {
+        running.reset();
+        at_last_comma = CRC16_INIT;
+    }
+
+  private:
+    Crc16 running;
+    uint16_t at_last_comma = CRC16_INIT;
+};
+
+/**
+ * @class FrameParser
+ * @brief Byte-driven framing state machine for the received byte stream.
+ * @details Bytes are fed one at a time. ASCII messages run from '$' to ';' and their CRC is computed while they
+ * arrive (see FrameCrc). Binary frames are collected between MSG_BINARY_DELIMITER bytes. When feed() reports a
+ * complete frame, frame() points to it until the next byte is fed. Both formats are always accepted, a delimiter
+ * abandons a partial ASCII message and frames longer than MSG_MAX_LENGTH are dropped.
+ */
+class FrameParser {
+  public:
+    enum Result {
+        NONE,   // No complete frame yet
+        ASCII,  // frame() holds an ASCII message without the ';', payload_crc() holds its CRC
+        BINARY, // frame() holds a COBS encoded binary frame without the delimiters
+    };
+
+    Result feed(uint8_t c);
+    std::string_view frame() const { return {buffer, length}; }
+    uint16_t payload_crc() const { return crc.payload_crc(); }
+    void reset();
+
+  private:
+    enum State { IDLE, IN_ASCII, IN_BINARY };
+
+    State state = IDLE;
+    size_t length = 0;
+    FrameCrc crc;
+    char buffer[MSG_MAX_LENGTH];
+};
+
+bool to_record(const Message &msg, Record &rec);
+bool to_record(const View &view, Record &rec);
+Message to_message(const Record &rec);
+
+// Codec, works on caller provided buffers
+int decode(std::string_view str, View &view, std::optional<uint16_t> payload_crc = std::nullopt);
+size_t encode(MessageType type, const std::string_view *fields, size_t count, char *buffer, size_t size,
+              int seq = -1);
+size_t encode(const Record &rec, char *buffer, size_t size);
+size_t encode(const Message &msg, char *buffer, size_t size);
+MessageType to_message_type(std::string_view str);
+
+// Binary codec, frames are delimited by MSG_BINARY_DELIMITER
+size_t encode_binary(MessageType type, const std::string_view *fields, size_t count, char *buffer, size_t size,
+                     int seq = -1);
+size_t encode_binary(const Record &rec, char *buffer, size_t size);
+size_t encode_binary(const Message &msg, char *buffer, size_t size);
+int decode_binary(std::string_view frame, Record &rec);
+
 // Used when receiving messages
-int convert_to_message(std::string &str, Message &msg);
+int convert_to_message(std::string &str, Message &msg, std::optional<uint16_t> payload_crc = std::nullopt);
 MessageType verify_message_type(std::string &str);
-int check_message_crc(std::string &str, std::string &crc_str);
+int check_message_crc(std::string_view str, std::string_view crc_str);
+int check_message_crc(uint16_t crc, std::string_view crc_str);
 
 // Used when sending messages
 void convert_to_string(const Message &msg, std::string &str);
@@ -48,6 +197,7 @@ Message response(bool ack);
 Message datetime_request();
 Message datetime_response(int datetime);
 Message device_status(bool ok);
+Message device_status(bool ok, int capabilities);
 Message instructions(int object_id, int image_id, int position_id);
 Message instructions(const std::string object_id, const std::string image_id, const std::string position_id);
 Message cmd_status(int image_id, int status, int datetime);
@@ -0,0 +1,282 @@
+#pragma once
+
+#include "message.hpp"
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace msg {
+
+/**
+ * @enum FieldType
+ * @brief Type of a content field, also selects its representation in a binary frame.
+ */
+enum FieldType : uint8_t {
+    FIELD_NONE = 0,
+    FIELD_U8,   // Unsigned integer, 1 byte in a binary frame
+    FIELD_I8,   // Signed integer, 1 byte in a binary frame
+    FIELD_I32,  // Signed integer, 4 bytes little-endian in a binary frame
+    FIELD_TEXT, // Text, 1 byte length followed by the text in a binary frame
+};
+
+/**
+ * @struct FieldSpec
+ * @brief Type and accepted range of a content field. The range doesn't apply to text fields.
+ */
+struct FieldSpec {
+    FieldType type = FIELD_NONE;
+    int32_t min = 0;
+    int32_t max = 0;
+};
+
+/**
+ * @struct MessageSpec
+ * @brief Content fields of a message type.
+ * @details The fields after the first required ones are optional, a message may omit them from the end.
+ */
+struct MessageSpec {
+    uint8_t required = 0;
+    uint8_t count = 0;
+    FieldSpec fields[MSG_MAX_FIELDS] = {};
+};
+
+namespace spec {
+constexpr FieldSpec u8(int32_t min = 0, int32_t max = UINT8_MAX) { return {FIELD_U8, min, max}; }
+constexpr FieldSpec i8(int32_t min = INT8_MIN, int32_t max = INT8_MAX) { return {FIELD_I8, min, max}; }
+constexpr FieldSpec i32(int32_t min = INT32_MIN, int32_t max = INT32_MAX) { return {FIELD_I32, min, max}; }
+constexpr FieldSpec text() { return {FIELD_TEXT, 0, 0}; }
+} // namespace spec
+
+/**
+ * @brief Schema of every message type, indexed by MessageType. See UART_COMMS.md for the meaning of the fields.
+ */
+constexpr MessageSpec SCHEMA[LINK_ACK + 1] = {
+    {},                                                    // UNASSIGNED
+    {1, 2, {spec::u8(0, 1), spec::i32()}},                 // RESPONSE: ack, image id when answering a PICTURE
+    {1, 1, {spec::i32()}},                                 // DATETIME: request flag or timestamp
+    {1, 2, {spec::u8(0, 1), spec::u8()}},                  // DEVICE_STATUS: status, capabilities
+    {3, 3, {spec::u8(1, 9), spec::i32(), spec::u8(1, 4)}}, // INSTRUCTIONS: object, image id, position
+    {3, 3, {spec::i32(), spec::i8(), spec::i32()}},        // CMD_STATUS: image id, status, time
+    {1, 1, {spec::i32()}},                                 // PICTURE: image id
+    {2, 2, {spec::u8(1, 3), spec::text()}},                // DIAGNOSTICS: status, message
+    {2, 2, {spec::text(), spec::text()}},                  // WIFI: ssid, password
+    {2, 2, {spec::text(), spec::i32(0, UINT16_MAX)}},      // SERVER: address, port
+    {1, 1, {spec::text()}},                                // API: token
+    {2, 2, {spec::u8(), spec::u8()}},                      // LINK_ACK: cumulative, selective ack mask
+};
+
+bool valid_field(std::string_view field, const FieldSpec &spec);
+bool conforms(MessageType type, const std::string_view *fields, size_t count);
+
+/*
+ * Typed messages. Each struct names its message type and lists its members in field order, the members must match
+ * the types in SCHEMA (checked at compile time). Text members point into the Record they were decoded from.
+ */
+
+struct Response {
+    static constexpr MessageType TYPE = RESPONSE;
+    bool ack = false;
+    std::optional<int32_t> image_id; // Only in the RESPONSE to a PICTURE
+    static constexpr auto fields(auto &self) { return std::tie(self.ack, self.image_id); }
+};
+
+struct Datetime {
+    static constexpr MessageType TYPE = DATETIME;
+    int32_t value = 0; // 1 for a request, the UNIX timestamp in a response
+    static constexpr auto fields(auto &self) { return std::tie(self.value); }
+};
+
+struct DeviceStatus {
+    static constexpr MessageType TYPE = DEVICE_STATUS;
+    bool ok = false;
+    std::optional<uint8_t> capabilities; // Omitted by older firmware
+    static constexpr auto fields(auto &self) { return std::tie(self.ok, self.capabilities); }
+};
+
+struct Instructions {
+    static constexpr MessageType TYPE = INSTRUCTIONS;
+    uint8_t object = 0;
+    int32_t image_id = 0;
+    uint8_t position = 0;
+    static constexpr auto fields(auto &self) { return std::tie(self.object, self.image_id, self.position); }
+};
+
+struct CmdStatus {
+    static constexpr MessageType TYPE = CMD_STATUS;
+    int32_t image_id = 0;
+    int8_t status = 0;
+    int32_t time = 0;
+    static constexpr auto fields(auto &self) { return std::tie(self.image_id, self.status, self.time); }
+};
+
+struct Picture {
+    static constexpr MessageType TYPE = PICTURE;
+    int32_t image_id = 0;
+    static constexpr auto fields(auto &self) { return std::tie(self.image_id); }
+};
+
+struct Diagnostics {
+    static constexpr MessageType TYPE = DIAGNOSTICS;
+    uint8_t status = 0;
+    std::string_view text;
+    static constexpr auto fields(auto &self) { return std::tie(self.status, self.text); }
+};
+
+struct Wifi {
+    static constexpr MessageType TYPE = WIFI;
+    std::string_view ssid;
+    std::string_view password;
+    static constexpr auto fields(auto &self) { return std::tie(self.ssid, self.password); }
+};
+
+struct Server {
+    static constexpr MessageType TYPE = SERVER;
+    std::string_view address;
+    int32_t port = 0;
+    static constexpr auto fields(auto &self) { return std::tie(self.address, self.port); }
+};
+
+struct Api {
+    static constexpr MessageType TYPE = API;
+    std::string_view token;
+    static constexpr auto fields(auto &self) { return std::tie(self.token); }
+};
+
+struct LinkAck {
+    static constexpr MessageType TYPE = LINK_ACK;
+    uint8_t cumulative = 0;
+    uint8_t sack = 0;
+    static constexpr auto fields(auto &self) { return std::tie(self.cumulative, self.sack); }
+};
+
+template <typename T>
+concept Typed = requires(T &typed) {
+    { T::TYPE } -> std::convertible_to<MessageType>;
+    T::fields(typed);
+};
+
+namespace detail {
+
+template <typename T> struct Optional : std::false_type {
+    using type = T;
+};
+template <typename T> struct Optional<std::optional<T>> : std::true_type {
+    using type = T;
+};
+
+template <typename T> constexpr FieldType field_type() {
+    if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, uint8_t>) {
+        return FIELD_U8;
+    } else if constexpr (std::is_same_v<T, int8_t>) {
+        return FIELD_I8;
+    } else if constexpr (std::is_same_v<T, int32_t>) {
+        return FIELD_I32;
+    } else if constexpr (std::is_same_v<T, std::string_view>) {
+        return FIELD_TEXT;
+    } else {
+        return FIELD_NONE;
+    }
+}
+
+template <typename Fields, size_t I> using Member = std::remove_reference_t<std::tuple_element_t<I, Fields>>;
+
+/**
+ * @brief Checks that the members of a typed message match its schema: same count and types, and only the members
+ * for optional fields are std::optional.
+ */
+template <Typed T> constexpr bool matches_schema() {
+    using Fields = decltype(T::fields(std::declval<T &>()));
+    constexpr MessageSpec spec = SCHEMA[T::TYPE];
+    if constexpr (std::tuple_size_v<Fields> != spec.count) {
+        return false;
+    } else {
+        return []<size_t... I>(std::index_sequence<I...>) {
+            return ((field_type<typename Optional<Member<Fields, I>>::type>() == SCHEMA[T::TYPE].fields[I].type &&
+                     Optional<Member<Fields, I>>::value == (I >= SCHEMA[T::TYPE].required)) &&
+                    ...);
+        }(std::make_index_sequence<spec.count>());
+    }
+}
+
+template <typename T> bool read_field(std::string_view field, const FieldSpec &spec, T &value) {
+    if constexpr (std::is_same_v<T, std::string_view>) {
+        value = field;
+        return true;
+    } else {
+        int32_t number;
+        if (!to_int(field, number) || number < spec.min || number > spec.max) { return false; }
+        value = static_cast<T>(number);
+        return true;
+    }
+}
+
+template <typename T> bool read_field(const Record &rec, size_t index, const FieldSpec &spec, T &value) {
+    if constexpr (Optional<T>::value) {
+        if (index >= rec.count) {
+            value.reset();
+            return true;
+        }
+        return read_field(rec.field(index), spec, value.emplace());
+    } else {
+        return read_field(rec.field(index), spec, value);
+    }
+}
+
+template <typename T> bool write_field(Record &rec, const T &value) {
+    if constexpr (Optional<T>::value) {
+        return !value || write_field(rec, *value); // Only trailing fields are optional
+    } else if constexpr (std::is_same_v<T, std::string_view>) {
+        return rec.add(value);
+    } else {
+        char text[12];
+        auto [end, ec] = std::to_chars(text, text + sizeof(text), static_cast<int32_t>(value));
+        return rec.add(std::string_view(text, end - text));
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief Decodes a Record into a typed message.
+ * @details Validates the type, the field count and every field against the schema while converting it, nothing is
+ * written to out unless all of it is valid.
+ *
+ * @param rec The Record to decode.
+ * @param out Reference to the typed message to populate.
+ * @return bool True if the Record is a valid message of the type, False otherwise.
+ */
+template <Typed T> bool decode(const Record &rec, T &out) {
+    static_assert(detail::matches_schema<T>(), "Members don't match the schema of the message type");
+    constexpr MessageSpec spec = SCHEMA[T::TYPE];
+    if (rec.type != T::TYPE || rec.count < spec.required || rec.count > spec.count) { return false; }
+
+    T typed;
+    bool ok = [&]<size_t... I>(std::index_sequence<I...>) {
+        auto members = T::fields(typed);
+        return (detail::read_field(rec, I, spec.fields[I], std::get<I>(members)) && ...);
+    }(std::make_index_sequence<spec.count>());
+    if (ok) { out = typed; }
+    return ok;
+}
+
+/**
+ * @brief Copies a typed message into a Record.
+ *
+ * @param typed The typed message.
+ * @param rec Reference to the Record to populate.
+ * @return bool True if all content fields fit in the record, False otherwise.
+ */
+template <Typed T> bool to_record(const T &typed, Record &rec) {
+    static_assert(detail::matches_schema<T>(), "Members don't match the schema of the message type");
+    rec.clear();
+    rec.type = T::TYPE;
+    return std::apply([&](const auto &...members) { return (detail::write_field(rec, members) && ...); },
+                      T::fields(typed));
+}
+
+} // namespace msg
@@ -0,0 +1,68 @@
+/**
+ * @file cobs.cpp
+ * @brief Consistent Overhead Byte Stuffing used by the binary UART framing.
+ * @details COBS removes every zero byte from a block at the cost of one byte per 254, so zero can delimit frames.
+ */
+
+#include "cobs.hpp"
+
+/**
+ * @brief Encodes a block of data.
+ *
+ * @param input Data to encode.
+ * @param length Length of the data.
+ * @param output Buffer for the encoded data. Must not overlap the input.
+ * @param size Size of the output buffer.
+ * @return size_t Length of the encoded data, 0 if it didn't fit in the output buffer.
+ */
+size_t cobs_encode(const uint8_t *input, size_t length, uint8_t *output, size_t size) {
+    if (size < cobs_max_encoded_length(length)) { return 0; }
+
+    size_t code_pos = 0; // Position of the code byte of the current block
+    size_t out = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; ++i) {
+        if (input[i] != 0) {
+            output[out++] = input[i];
+            code++;
+        }
+        if (input[i] == 0 || code == 0xFF) {
+            output[code_pos] = code;
+            code_pos = out++;
+            code = 1;
+        }
+    }
+    output[code_pos] = code;
+
+    return out;
+}
+
+/**
+ * @brief Decodes a block of data.
+ *
+ * @param input Encoded data without the zero delimiter.
+ * @param length Length of the encoded data.
+ * @param output Buffer for the decoded data. Must not overlap the input.
+ * @param size Size of the output buffer.
+ * @return size_t Length of the decoded data, 0 if the input is malformed or didn't fit in the output buffer.
+ */
+size_t cobs_decode(const uint8_t *input, size_t length, uint8_t *output, size_t size) {
+    size_t in = 0;
+    size_t out = 0;
+    while (in < length) {
+        uint8_t code = input[in++];
+        if (code == 0 || in + code - 1 > length) { return 0; }
+        if (out + code - 1 > size) { return 0; }
+        for (uint8_t i = 1; i < code; ++i) {
+            if (input[in] == 0) { return 0; }
+            output[out++] = input[in++];
+        }
+        // A zero follows every block except a full one and the last one
+        if (code != 0xFF && in != length) {
+            if (out == size) { return 0; }
+            output[out++] = 0;
+        }
+    }
+
+    return out;
+}
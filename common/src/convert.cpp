@@ -5,8 +5,13 @@
 
 #include "convert.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+
 /**
  * @brief Converts a string to an integer.
+ * @details Leading whitespace is skipped and parsing stops at the first invalid character.
  *
  * @param str The input string.
  * @param result Reference to store the converted integer.
@@ -14,10 +19,13 @@
  * @return bool True if the conversion is successful, False otherwise.
  */
 bool str_to_int(std::string &str, int &result, bool hex) {
-    std::stringstream ss(str);
-    if (hex) { ss >> std::hex; }
-    if (!(ss >> result)) { return false; }
-    return true;
+    const char *begin = str.data();
+    const char *end = str.data() + str.size();
+    while (begin != end && std::isspace(static_cast<unsigned char>(*begin))) {
+        ++begin;
+    }
+    auto [ptr, ec] = std::from_chars(begin, end, result, hex ? 16 : 10);
+    return ec == std::errc();
 }
 
 /**
@@ -29,17 +37,15 @@ bool str_to_int(std::string &str, int &result, bool hex) {
  * @return bool True if the conversion is successful, False otherwise.
  */
 bool str_to_vec(const std::string &str, const char delim, std::vector<std::string> &vec) {
-    std::stringstream ss(str);
-    std::string token;
-    bool result = false;
-
-    while (std::getline(ss, token, delim)) {
-        vec.push_back(token);
+    size_t start = 0;
+    while (start < str.size()) {
+        size_t pos = str.find(delim, start);
+        if (pos == std::string::npos) pos = str.size();
+        vec.emplace_back(str, start, pos - start);
+        start = pos + 1;
     }
 
-    if (!vec.empty()) result = true;
-
-    return result;
+    return !vec.empty();
 }
 
 /**
@@ -53,16 +59,14 @@ bool str_to_vec(const std::string &str, const char delim, std::vector<std::strin
  * @return bool True if the conversion is successful, False otherwise.
  */
 bool num_to_hex_str(int num, std::string &result, int width, bool fill, bool uppercase) {
-    std::stringstream ss;
-
-    if (width > 0) { ss << std::setw(width); }
-
-    if (fill) { ss << std::setfill('0'); }
-
-    if (uppercase) { ss << std::uppercase; }
+    char digits[2 * sizeof(num)];
+    auto [ptr, ec] = std::to_chars(digits, digits + sizeof(digits), static_cast<unsigned int>(num), 16);
+    if (ec != std::errc()) { return false; }
+    if (uppercase) { std::transform(digits, ptr, digits, [](char c) { return std::toupper(c); }); }
 
-    if (!(ss << std::hex << num)) { return false; }
-    result = ss.str();
+    int length = ptr - digits;
+    result.assign(width > length ? width - length : 0, fill ? '0' : ' ');
+    result.append(digits, ptr);
     return true;
 }
 
@@ -78,7 +82,7 @@ bool num_to_hex_str(int num, std::string &result, int width, bool fill, bool upp
  * @return int64_t The epoch timestamp.
  */
 int64_t datetime_to_epoch(int year, int month, int day, int hour, int min, int sec) {
-    struct tm time;
+    struct tm time = {}; // tm_isdst must be 0, otherwise mktime may shift the time by an hour
     time.tm_year = year - 1900;
     time.tm_mon = month - 1;
     time.tm_mday = day;
@@ -5,20 +5,39 @@
 
 #include "crc.hpp"
 
+/**
+ * @brief Folds a block of bytes into the CRC.
+ *
+ * @param data The bytes.
+ */
+void Crc16::update(std::string_view data) {
+    for (char c : data) {
+        update(static_cast<uint8_t>(c));
+    }
+}
+
 /**
  * @brief Calculates the CRC-16 checksum of a string.
  * @details This function uses a CRC-16 MODBUS algorithm to calculate the checksum of a string.
  * @param input The input string.
  * @return uint16_t The CRC-16 checksum of the input string.
  */
-uint16_t crc16(const std::string &input) {
-    uint16_t crc = 0xFFFF;
+uint16_t crc16(std::string_view input) { return crc16_slice4(input); }
+
+/**
+ * @brief Calculates the CRC-16 checksum of a string one bit at a time.
+ * @details Reference implementation, the other variants must produce the same result.
+ * @param input The input string.
+ * @return uint16_t The CRC-16 checksum of the input string.
+ */
+uint16_t crc16_bitwise(std::string_view input) {
+    uint16_t crc = CRC16_INIT;
     for (char c : input) {
-        crc ^= static_cast<uint16_t>(c);
+        crc ^= static_cast<uint8_t>(c);
         for (int i = 0; i < 8; i++) {
             if (crc & 0x0001) {
                 crc >>= 1;
-                crc ^= 0xA001;
+                crc ^= CRC16_POLYNOMIAL;
             } else {
                 crc >>= 1;
             }
@@ -26,3 +45,39 @@ uint16_t crc16(const std::string &input) {
     }
     return crc;
 }
+
+/**
+ * @brief Calculates the CRC-16 checksum of a string one byte at a time with a 256 entry lookup table.
+ * @param input The input string.
+ * @return uint16_t The CRC-16 checksum of the input string.
+ */
+uint16_t crc16_table(std::string_view input) {
+    Crc16 crc;
+    crc.update(input);
+    return crc.value();
+}
+
+/**
+ * @brief Calculates the CRC-16 checksum of a string four bytes at a time (slicing-by-4).
+ * @details Uses four 256 entry lookup tables (2 KiB) and falls back to the single table for the remaining bytes.
+ * @param input The input string.
+ * @return uint16_t The CRC-16 checksum of the input string.
+ */
+uint16_t crc16_slice4(std::string_view input) {
+    const auto &t = CRC16_TABLES;
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(input.data());
+    size_t length = input.size();
+    uint16_t crc = CRC16_INIT;
+
+    while (length >= 4) {
+        uint8_t b0 = data[0] ^ (crc & 0xFF);
+        uint8_t b1 = data[1] ^ (crc >> 8);
+        crc = t[3][b0] ^ t[2][b1] ^ t[1][data[2]] ^ t[0][data[3]];
+        data += 4;
+        length -= 4;
+    }
+    while (length--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
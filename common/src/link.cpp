@@ -0,0 +1,363 @@
+/**
+ * @file link.cpp
+ * @brief Implementation of the sliding-window link used for sequenced messages between the Pico and the ESP.
+ */
+
+#include "link.hpp"
+
+#include <cstdio>
+
+namespace msg {
+
+/**
+ * @brief Counts an event for a message type.
+ *
+ * @param counter The event.
+ * @param type Type of the message, UNASSIGNED if it couldn't be read.
+ */
+void LinkStats::count(Counter counter, MessageType type) { counters[counter][index(type)]++; }
+
+/**
+ * @brief Adds an ACK round trip time sample.
+ *
+ * @param rtt_ms Time from sending a message to receiving its acknowledgement.
+ */
+void LinkStats::rtt(uint32_t rtt_ms) {
+    if (rtt_count == 0 || rtt_ms < rtt_min_ms) { rtt_min_ms = rtt_ms; }
+    if (rtt_ms > rtt_max_ms) { rtt_max_ms = rtt_ms; }
+    rtt_sum_ms += rtt_ms;
+    rtt_count++;
+}
+
+/**
+ * @brief Records the current fill level of a buffer.
+ *
+ * @param buffer The buffer.
+ * @param used Bytes or messages in the buffer.
+ */
+void LinkStats::level(Buffer buffer, uint32_t used) {
+    if (used > high_water_marks[buffer]) { high_water_marks[buffer] = used; }
+}
+
+/**
+ * @brief Clears all counters, RTT samples and high-water marks.
+ */
+void LinkStats::reset() { *this = LinkStats(); }
+
+/**
+ * @brief Returns the sum of a counter over all message types.
+ *
+ * @param counter The event.
+ * @return uint32_t Total count.
+ */
+uint32_t LinkStats::total(Counter counter) const {
+    uint32_t sum = 0;
+    for (uint32_t value : counters[counter]) {
+        sum += value;
+    }
+    return sum;
+}
+
+/**
+ * @brief Formats the totals, the RTT and the high-water marks on one line, followed by the counters of every message
+ * type that has any.
+ * @details Per type the counters are listed as sent/received/CRC failed/NACKed/retransmitted, for example
+ * "tx 12 rx 10 crc 1 nack 0 rtx 2 rtt 8/15/40 ms hw 96/40/3 | 5:4/0/0/0/1 ...".
+ *
+ * @return std::string The summary.
+ */
+std::string LinkStats::summary() const {
+    char buffer[96];
+    std::string text;
+    snprintf(buffer, sizeof(buffer), "tx %lu rx %lu crc %lu nack %lu rtx %lu", static_cast<unsigned long>(total(SENT)),
+             static_cast<unsigned long>(total(RECEIVED)), static_cast<unsigned long>(total(CRC_FAILED)),
+             static_cast<unsigned long>(total(NACKED)), static_cast<unsigned long>(total(RETRANSMITTED)));
+    text += buffer;
+    snprintf(buffer, sizeof(buffer), " rtt %lu/%lu/%lu ms hw %lu/%lu/%lu", static_cast<unsigned long>(rtt_min()),
+             static_cast<unsigned long>(rtt_avg()), static_cast<unsigned long>(rtt_max()),
+             static_cast<unsigned long>(high_water_marks[RX_BUFFER]),
+             static_cast<unsigned long>(high_water_marks[TX_BUFFER]),
+             static_cast<unsigned long>(high_water_marks[RX_QUEUE]));
+    text += buffer;
+
+    text += " |";
+    for (size_t type = UNASSIGNED; type <= LINK_ACK; ++type) {
+        bool any = false;
+        for (const auto &counter : counters) {
+            any = any || counter[type] > 0;
+        }
+        if (!any) { continue; }
+        snprintf(buffer, sizeof(buffer), " %u:%lu/%lu/%lu/%lu/%lu", static_cast<unsigned>(type),
+                 static_cast<unsigned long>(counters[SENT][type]), static_cast<unsigned long>(counters[RECEIVED][type]),
+                 static_cast<unsigned long>(counters[CRC_FAILED][type]),
+                 static_cast<unsigned long>(counters[NACKED][type]),
+                 static_cast<unsigned long>(counters[RETRANSMITTED][type]));
+        text += buffer;
+    }
+    return text;
+}
+
+/**
+ * @brief Checks whether the transmit window has room for a new frame.
+ * @details Frames that were given up still count against half of the sequence space until the peer acknowledges
+ * something past them. Otherwise a peer that heard nothing for a while could mistake new frames for old ones once the
+ * 8-bit sequence number wraps.
+ *
+ * @return bool True if send() will accept a record.
+ */
+bool LinkSender::can_send() const {
+    return in_flight() < LINK_WINDOW_SIZE && static_cast<uint8_t>(next_seq - peer_expected) < 128 - LINK_WINDOW_SIZE;
+}
+
+/**
+ * @brief Assigns the next sequence number to a record and stores it for retransmission.
+ *
+ * @param rec The record to send.
+ * @param now_ms Current time in milliseconds.
+ * @return const Record* The sequenced record to transmit, nullptr if the window is full.
+ */
+const Record *LinkSender::send(const Record &rec, uint32_t now_ms) {
+    if (!can_send()) { return nullptr; }
+
+    Slot &s = slot(next_seq);
+    s.rec = rec;
+    s.rec.seq = next_seq;
+    s.sent_ms = now_ms;
+    s.transmissions = 1;
+    s.acked = false;
+    s.due = false;
+    failed[next_seq / 8] &= ~(1 << (next_seq % 8));
+    next_seq++;
+
+    return &s.rec;
+}
+
+/**
+ * @brief Processes an acknowledgement from the peer.
+ *
+ * @param cumulative Last sequence number the peer received in order.
+ * @param sack Bit n is set if the peer has received cumulative + 2 + n out of order.
+ * @param now_ms Current time in milliseconds.
+ * @return int Number of frames newly acknowledged.
+ */
+int LinkSender::on_ack(uint8_t cumulative, uint8_t sack, uint32_t now_ms) {
+    uint8_t expected = cumulative + 1;
+    if (static_cast<uint8_t>(next_seq - expected) >= 128) { return 0; } // Not from the current window, ignore it
+    if (static_cast<uint8_t>(expected - peer_expected) < 128) { peer_expected = expected; }
+
+    int count = 0;
+    bool sacked = false;
+    uint8_t highest_sacked = 0;
+
+    for (uint8_t seq = base; seq != next_seq; ++seq) {
+        uint8_t distance = seq - cumulative; // 1 = first missing frame, 2 and up = SACK bits
+        bool in_sack = distance >= 2 && distance - 2 < 8 && (sack & (1 << (distance - 2)));
+        bool acked = static_cast<uint8_t>(cumulative - seq) < LINK_WINDOW_SIZE || in_sack;
+        Slot &s = slot(seq);
+        if (acked && !s.acked) {
+            s.acked = true;
+            s.due = false;
+            if (s.transmissions == 1) {
+                sample_rtt(now_ms - s.sent_ms);
+                if (stats) { stats->rtt(now_ms - s.sent_ms); }
+            }
+            count++;
+        }
+        if (in_sack) {
+            sacked = true;
+            highest_sacked = seq;
+        }
+    }
+
+    // Frames below the highest selectively acknowledged one were most likely lost, resend them without waiting for
+    // the timeout unless they were sent too recently for the ACK to cover them
+    for (uint8_t seq = base; sacked && seq != highest_sacked; ++seq) {
+        Slot &s = slot(seq);
+        if (!s.acked && now_ms - s.sent_ms >= srtt()) { s.due = true; }
+    }
+
+    advance();
+    return count;
+}
+
+/**
+ * @brief Returns the next frame that needs to be retransmitted.
+ * @details Call repeatedly until it returns nullptr. Frames that exceed LINK_MAX_RETRIES are given up and the window
+ * moves past them.
+ *
+ * @param now_ms Current time in milliseconds.
+ * @return const Record* The record to transmit again, nullptr if nothing is due.
+ */
+const Record *LinkSender::poll(uint32_t now_ms) {
+    for (uint8_t seq = base; seq != next_seq; ++seq) {
+        Slot &s = slot(seq);
+        if (s.acked) { continue; }
+        bool timed_out = now_ms - s.sent_ms >= rto_ms;
+        if (!timed_out && !s.due) { continue; }
+
+        if (s.transmissions >= LINK_MAX_RETRIES) {
+            s.acked = true; // Give up, the window can't stall forever
+            failed[seq / 8] |= 1 << (seq % 8);
+            failure_count++;
+            continue;
+        }
+        if (timed_out && seq == base) { rto_ms = rto_ms * 2 > LINK_RTO_MAX_MS ? LINK_RTO_MAX_MS : rto_ms * 2; }
+        s.sent_ms = now_ms;
+        s.transmissions++;
+        s.due = false;
+        retransmit_count++;
+        if (stats) { stats->count(LinkStats::RETRANSMITTED, s.rec.type); }
+        return &s.rec;
+    }
+    advance();
+
+    return nullptr;
+}
+
+/**
+ * @brief Returns the delivery state of a sequence number returned by send().
+ *
+ * @param seq The sequence number.
+ * @return State PENDING while in flight, ACKED once acknowledged and FAILED if the frame was given up.
+ */
+LinkSender::State LinkSender::state(uint8_t seq) const {
+    if (static_cast<uint8_t>(seq - base) < in_flight() && !slot(seq).acked) { return PENDING; }
+    return failed[seq / 8] & (1 << (seq % 8)) ? FAILED : ACKED;
+}
+
+/**
+ * @brief Drops all frames in flight and restarts the sequence numbers.
+ * @details Called when the link is renegotiated, the peer starts from zero as well.
+ */
+void LinkSender::reset() {
+    for (uint8_t seq = base; seq != next_seq; ++seq) {
+        if (!slot(seq).acked) { failed[seq / 8] |= 1 << (seq % 8); }
+    }
+    base = 0;
+    next_seq = 0;
+    peer_expected = 0;
+}
+
+/**
+ * @brief Updates the smoothed RTT and the retransmit timeout with a new sample.
+ *
+ * @param rtt_ms Round trip time of a frame that was sent once.
+ */
+void LinkSender::sample_rtt(uint32_t rtt_ms) {
+    if (srtt_x8 == 0) {
+        srtt_x8 = rtt_ms * 8;
+        rttvar_x4 = rtt_ms * 2;
+    } else {
+        int32_t delta = static_cast<int32_t>(rtt_ms) - static_cast<int32_t>(srtt_x8 / 8);
+        srtt_x8 += delta; // srtt += delta / 8
+        // rttvar += (|delta| - rttvar) / 4
+        rttvar_x4 += (delta < 0 ? -delta : delta) - static_cast<int32_t>(rttvar_x4 / 4);
+    }
+    rto_ms = srtt_x8 / 8 + rttvar_x4;
+    if (rto_ms < LINK_RTO_MIN_MS) { rto_ms = LINK_RTO_MIN_MS; }
+    if (rto_ms > LINK_RTO_MAX_MS) { rto_ms = LINK_RTO_MAX_MS; }
+}
+
+/**
+ * @brief Moves the start of the window past acknowledged frames.
+ */
+void LinkSender::advance() {
+    while (base != next_seq && slot(base).acked) {
+        base++;
+    }
+}
+
+/**
+ * @brief Buffers a sequenced record if it falls inside the receive window.
+ *
+ * @param rec The received record.
+ * @return bool True if the record is new, False if it is a duplicate or outside the window.
+ */
+bool LinkReceiver::accept(const Record &rec) {
+    if (rec.seq < 0) { return false; }
+    uint8_t seq = static_cast<uint8_t>(rec.seq);
+    uint8_t distance = seq - expected;
+    if (distance >= LINK_WINDOW_SIZE && distance < 128) {
+        // The sender's window has moved past frames that never arrived
+        uint8_t skip = distance - LINK_WINDOW_SIZE + 1;
+        if (skip > abandoned) { abandoned = skip; }
+        skip_abandoned();
+        distance = seq - expected;
+    }
+    if (distance >= LINK_WINDOW_SIZE) { return false; } // Duplicate, or blocked by frames that haven't been popped
+    if (has(seq)) { return false; }
+
+    size_t index = seq % LINK_WINDOW_SIZE;
+    slots[index] = rec;
+    received[index] = true;
+    return true;
+}
+
+/**
+ * @brief Returns the next record in sequence.
+ *
+ * @return const Record* The record, nullptr if it hasn't been received yet.
+ */
+const Record *LinkReceiver::front() const { return has(expected) ? &slots[expected % LINK_WINDOW_SIZE] : nullptr; }
+
+/**
+ * @brief Removes the record returned by front().
+ */
+void LinkReceiver::pop() {
+    if (!has(expected)) { return; }
+    received[expected % LINK_WINDOW_SIZE] = false;
+    expected++;
+    if (abandoned > 0) { abandoned--; }
+    skip_abandoned();
+}
+
+/**
+ * @brief Returns the selective acknowledgement mask.
+ *
+ * @return uint8_t Bit n is set if cumulative() + 2 + n has been received.
+ */
+uint8_t LinkReceiver::sack() const {
+    uint8_t mask = 0;
+    for (uint8_t distance = 1; distance < LINK_WINDOW_SIZE; ++distance) {
+        if (has(expected + distance)) { mask |= 1 << (distance - 1); }
+    }
+    return mask;
+}
+
+/**
+ * @brief Discards buffered records and expects sequence number zero next.
+ */
+void LinkReceiver::reset() {
+    for (bool &r : received) {
+        r = false;
+    }
+    expected = 0;
+    abandoned = 0;
+}
+
+/**
+ * @brief Checks whether a sequence number is buffered.
+ * @details The slot is also compared against the sequence number, since skipping ahead can leave frames from an
+ * earlier lap of the window in their slots.
+ *
+ * @param seq The sequence number.
+ * @return bool True if the frame has been received and not popped.
+ */
+bool LinkReceiver::has(uint8_t seq) const {
+    size_t index = seq % LINK_WINDOW_SIZE;
+    return received[index] && static_cast<uint8_t>(slots[index].seq) == seq;
+}
+
+/**
+ * @brief Moves past missing frames that the sender has given up on.
+ * @details Stops at the first received frame so it is still delivered in order.
+ */
+void LinkReceiver::skip_abandoned() {
+    while (abandoned > 0 && !has(expected)) {
+        received[expected % LINK_WINDOW_SIZE] = false; // Drop a stale frame from an earlier lap
+        expected++;
+        abandoned--;
+    }
+}
+
+} // namespace msg
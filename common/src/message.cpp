@@ -5,39 +5,555 @@
 
 #include "message.hpp"
 
+#include "cobs.hpp"
+#include "schema.hpp"
+
 namespace msg {
 
 /**
- * @brief Converts a string to a Message object.
+ * @brief Appends a content field to the record.
  *
- * Parses the input string, extracts message content, verifies CRC, and assigns values to the Message struct.
+ * @param field The field to append.
+ * @return bool True if the field fit in the record, False otherwise.
+ */
+bool Record::add(std::string_view field) {
+    if (count >= MSG_MAX_FIELDS || used + field.size() > MSG_RECORD_SIZE) { return false; }
+    field.copy(data + used, field.size());
+    offsets[count] = used;
+    lengths[count] = field.size();
+    used += field.size();
+    count++;
+    return true;
+}
+
+/**
+ * @brief Returns a content field of the record.
  *
- * @param str Input message string.
- * @param msg Reference to the Message object to populate.
+ * @param index Index of the field.
+ * @return std::string_view View of the field, empty if the index is out of range.
+ */
+std::string_view Record::field(size_t index) const {
+    if (index >= count) { return {}; }
+    return std::string_view(data + offsets[index], lengths[index]);
+}
+
+/**
+ * @brief Removes the type and all content fields from the record.
+ */
+void Record::clear() {
+    type = UNASSIGNED;
+    seq = -1;
+    count = 0;
+    used = 0;
+}
+
+/**
+ * @brief Copies a Message object into a Record.
+ *
+ * @param msg The Message object to copy.
+ * @param rec Reference to the Record to populate.
+ * @return bool True if all content fields fit in the record, False otherwise.
+ */
+bool to_record(const Message &msg, Record &rec) {
+    rec.clear();
+    rec.type = msg.type;
+    for (const std::string &field : msg.content) {
+        if (!rec.add(field)) { return false; }
+    }
+    return true;
+}
+
+/**
+ * @brief Copies a View into a Record.
+ *
+ * @param view The View to copy.
+ * @param rec Reference to the Record to populate.
+ * @return bool True if all content fields fit in the record, False otherwise.
+ */
+bool to_record(const View &view, Record &rec) {
+    rec.clear();
+    rec.type = view.type;
+    rec.seq = view.seq;
+    for (size_t i = 0; i < view.count; ++i) {
+        if (!rec.add(view.fields[i])) { return false; }
+    }
+    return true;
+}
+
+/**
+ * @brief Copies a Record into a Message object.
+ *
+ * @param rec The Record to copy.
+ * @return Message The message object.
+ */
+Message to_message(const Record &rec) {
+    Message msg{.type = rec.type, .content = {}};
+    msg.content.reserve(rec.count);
+    for (size_t i = 0; i < rec.count; ++i) {
+        msg.content.emplace_back(rec.field(i));
+    }
+    return msg;
+}
+
+/**
+ * @brief Returns a content field of the view.
+ *
+ * @param index Index of the field.
+ * @return std::string_view The field, empty if the index is out of range.
+ */
+std::string_view View::field(size_t index) const {
+    if (index >= count) { return {}; }
+    return fields[index];
+}
+
+/**
+ * @brief Checks a content field against its schema.
+ *
+ * @param field The field text.
+ * @param spec The field's schema.
+ * @return bool True if the field is valid, False otherwise.
+ */
+bool valid_field(std::string_view field, const FieldSpec &spec) {
+    int32_t value;
+    switch (spec.type) {
+        case FIELD_TEXT:
+            return field.size() <= 0xFF;
+        case FIELD_U8:
+        case FIELD_I8:
+        case FIELD_I32:
+            return to_int(field, value) && value >= spec.min && value <= spec.max;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Checks the content fields of a message against the schema of its type.
+ *
+ * @param type Message type.
+ * @param fields Content fields.
+ * @param count Number of content fields.
+ * @return bool True if the message carries all required fields and every field is valid, False otherwise.
+ */
+bool conforms(MessageType type, const std::string_view *fields, size_t count) {
+    if (type <= UNASSIGNED || type > LINK_ACK) { return false; }
+    const MessageSpec &spec = SCHEMA[type];
+    if (count < spec.required || count > spec.count) { return false; }
+    for (size_t i = 0; i < count; ++i) {
+        if (!valid_field(fields[i], spec.fields[i])) { return false; }
+    }
+    return true;
+}
+
+/**
+ * @brief Decodes a message in place.
+ *
+ * Verifies the CRC, splits the message into its type and content fields and checks the fields against the schema.
+ * The fields of the View point into str, nothing is copied.
+ *
+ * @param str Message string, with or without the terminating ';'.
+ * @param view Reference to the View to populate.
+ * @param payload_crc CRC of the message up to the CRC field if it was already computed while receiving the message
+ * (see FrameCrc). Computed here otherwise.
  * @return int Error code (0 if successful, non-zero otherwise).
  */
-int convert_to_message(std::string &str, Message &msg) {
-    if (size_t pos = str.find_last_of(','); pos == std::string::npos) {
-        return 1;
+int decode(std::string_view str, View &view, std::optional<uint16_t> payload_crc) {
+    view.type = UNASSIGNED;
+    view.seq = -1;
+    view.count = 0;
+
+    if (!str.empty() && str.back() == ';') { str.remove_suffix(1); }
+    size_t pos = str.find_last_of(',');
+    if (pos == std::string_view::npos) { return 1; }
+    if (payload_crc ? check_message_crc(*payload_crc, str.substr(pos + 1))
+                    : check_message_crc(str.substr(0, pos), str.substr(pos + 1))) {
+        return 2;
+    }
+    str = str.substr(0, pos);
+
+    if (str.empty()) { return 5; }
+    pos = str.find(',');
+    if (pos == std::string_view::npos) { return 6; }
+
+    // A sequenced message has "$<type>:<seq>" as its first token
+    std::string_view type_str = str.substr(0, pos);
+    if (size_t colon = type_str.find(':'); colon != std::string_view::npos) {
+        uint8_t seq;
+        if (!to_int(type_str.substr(colon + 1), seq)) { return 7; }
+        view.seq = seq;
+        type_str = type_str.substr(0, colon);
+    }
+    view.type = to_message_type(type_str);
+    if (view.type == UNASSIGNED) { return 7; }
+
+    do {
+        if (view.count == MSG_MAX_FIELDS) {
+            view.type = UNASSIGNED;
+            return 8;
+        }
+        size_t start = pos + 1;
+        pos = str.find(',', start);
+        view.fields[view.count++] = str.substr(start, pos == std::string_view::npos ? pos : pos - start);
+    } while (pos != std::string_view::npos);
+
+    if (!conforms(view.type, view.fields, view.count)) {
+        view.type = UNASSIGNED;
+        return 11;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Encodes a message into a buffer.
+ *
+ * Writes "$<type>,<field>,...,<CRC>;" followed by a null terminator if there is room for it. A sequenced message
+ * starts with "$<type>:<seq>".
+ *
+ * @param type Message type.
+ * @param fields Content fields.
+ * @param count Number of content fields.
+ * @param buffer Buffer to write the message to.
+ * @param size Size of the buffer.
+ * @param seq Link sequence number, -1 for an unsequenced message.
+ * @return size_t Length of the encoded message, 0 if it didn't fit in the buffer.
+ */
+size_t encode(MessageType type, const std::string_view *fields, size_t count, char *buffer, size_t size, int seq) {
+    static const char hex[] = "0123456789ABCDEF";
+    char *out = buffer;
+    char *end = buffer + size;
+
+    if (out == end) { return 0; }
+    *out++ = '$';
+    auto [ptr, ec] = std::to_chars(out, end, static_cast<int>(type));
+    if (ec != std::errc()) { return 0; }
+    out = ptr;
+    if (seq >= 0) {
+        if (out == end) { return 0; }
+        *out++ = ':';
+        auto [seq_ptr, seq_ec] = std::to_chars(out, end, seq);
+        if (seq_ec != std::errc()) { return 0; }
+        out = seq_ptr;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (static_cast<size_t>(end - out) < fields[i].size() + 1) { return 0; }
+        *out++ = ',';
+        out += fields[i].copy(out, fields[i].size());
+    }
+
+    uint16_t crc = crc16(std::string_view(buffer, out - buffer));
+    if (end - out < 6) { return 0; }
+    *out++ = ',';
+    for (int shift = 12; shift >= 0; shift -= 4) {
+        *out++ = hex[(crc >> shift) & 0x0F];
+    }
+    *out++ = ';';
+    if (out != end) { *out = '\0'; }
+
+    return out - buffer;
+}
+
+/**
+ * @brief Encodes a Record into a buffer.
+ *
+ * @param rec The Record to encode.
+ * @param buffer Buffer to write the message to.
+ * @param size Size of the buffer.
+ * @return size_t Length of the encoded message, 0 if it didn't fit in the buffer.
+ */
+size_t encode(const Record &rec, char *buffer, size_t size) {
+    std::string_view fields[MSG_MAX_FIELDS];
+    for (size_t i = 0; i < rec.count; ++i) {
+        fields[i] = rec.field(i);
+    }
+    return encode(rec.type, fields, rec.count, buffer, size, rec.seq);
+}
+
+/**
+ * @brief Encodes a Message object into a buffer.
+ *
+ * @param msg The Message object to encode.
+ * @param buffer Buffer to write the message to.
+ * @param size Size of the buffer.
+ * @return size_t Length of the encoded message, 0 if it didn't fit in the buffer.
+ */
+size_t encode(const Message &msg, char *buffer, size_t size) {
+    if (msg.content.size() > MSG_MAX_FIELDS) { return 0; }
+    std::string_view fields[MSG_MAX_FIELDS];
+    for (size_t i = 0; i < msg.content.size(); ++i) {
+        fields[i] = msg.content[i];
+    }
+    return encode(msg.type, fields, msg.content.size(), buffer, size);
+}
+
+/**
+ * @brief Determines the message type from a "$<type>" string.
+ *
+ * @param str The string containing the message type.
+ * @return MessageType The corresponding message type enumeration, UNASSIGNED if invalid.
+ */
+MessageType to_message_type(std::string_view str) {
+    int type_val;
+    if (str.empty() || str[0] != '$' || !to_int(str.substr(1), type_val)) { return UNASSIGNED; }
+    if (type_val < RESPONSE || type_val > LINK_ACK) { return UNASSIGNED; }
+    return static_cast<MessageType>(type_val);
+}
+
+#define BINARY_SEQUENCED 0x80 // Set in the type byte when a sequence number byte follows it
+
+/**
+ * @brief Encodes a message into a binary frame.
+ *
+ * The frame is the message type byte, the sequence number byte for a sequenced message, the content fields in the
+ * representation given by SCHEMA and a little-endian CRC-16 of the preceding bytes. It is COBS encoded and
+ * enclosed in MSG_BINARY_DELIMITER bytes so the receiver can tell it apart from an ASCII message and resynchronize
+ * after an error.
+ *
+ * @param type Message type.
+ * @param fields Content fields.
+ * @param count Number of content fields.
+ * @param buffer Buffer to write the frame to.
+ * @param size Size of the buffer.
+ * @param seq Link sequence number, -1 for an unsequenced message.
+ * @return size_t Length of the frame, 0 if it didn't fit in the buffer or a field can't be represented in binary.
+ */
+size_t encode_binary(MessageType type, const std::string_view *fields, size_t count, char *buffer, size_t size,
+                     int seq) {
+    if (type <= UNASSIGNED || type > LINK_ACK || count > MSG_MAX_FIELDS || seq > 0xFF) { return 0; }
+
+    uint8_t raw[MSG_MAX_LENGTH];
+    size_t len = 0;
+    if (seq >= 0) {
+        raw[len++] = static_cast<uint8_t>(type) | BINARY_SEQUENCED;
+        raw[len++] = static_cast<uint8_t>(seq);
     } else {
-        if (str.back() == ';') { str.pop_back(); }
-        std::string crc_str = str.substr(pos + 1);
-        str.erase(pos);
+        raw[len++] = static_cast<uint8_t>(type);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        switch (SCHEMA[type].fields[i].type) {
+            case FIELD_U8: {
+                uint8_t value;
+                if (!to_int(fields[i], value) || len + 1 > sizeof(raw) - 2) { return 0; }
+                raw[len++] = value;
+                break;
+            }
+            case FIELD_I8: {
+                int8_t value;
+                if (!to_int(fields[i], value) || len + 1 > sizeof(raw) - 2) { return 0; }
+                raw[len++] = static_cast<uint8_t>(value);
+                break;
+            }
+            case FIELD_I32: {
+                int32_t value;
+                if (!to_int(fields[i], value) || len + 4 > sizeof(raw) - 2) { return 0; }
+                for (int b = 0; b < 4; ++b) {
+                    raw[len++] = static_cast<uint32_t>(value) >> (b * 8);
+                }
+                break;
+            }
+            case FIELD_TEXT:
+                if (fields[i].size() > 0xFF || len + 1 + fields[i].size() > sizeof(raw) - 2) { return 0; }
+                raw[len++] = fields[i].size();
+                len += fields[i].copy(reinterpret_cast<char *>(raw + len), fields[i].size());
+                break;
+            default:
+                return 0; // More fields than the message type has
+        }
+    }
+
+    uint16_t crc = crc16(std::string_view(reinterpret_cast<const char *>(raw), len));
+    raw[len++] = crc & 0xFF;
+    raw[len++] = crc >> 8;
+
+    if (size < 2) { return 0; }
+    uint8_t *out = reinterpret_cast<uint8_t *>(buffer);
+    size_t encoded = cobs_encode(raw, len, out + 1, size - 2);
+    if (encoded == 0) { return 0; }
+    out[0] = MSG_BINARY_DELIMITER;
+    out[encoded + 1] = MSG_BINARY_DELIMITER;
+
+    return encoded + 2;
+}
 
-        if (check_message_crc(str, crc_str)) { return 2; }
+/**
+ * @brief Encodes a Record into a binary frame.
+ *
+ * @param rec The Record to encode.
+ * @param buffer Buffer to write the frame to.
+ * @param size Size of the buffer.
+ * @return size_t Length of the frame, 0 if it couldn't be encoded.
+ */
+size_t encode_binary(const Record &rec, char *buffer, size_t size) {
+    std::string_view fields[MSG_MAX_FIELDS];
+    for (size_t i = 0; i < rec.count; ++i) {
+        fields[i] = rec.field(i);
     }
+    return encode_binary(rec.type, fields, rec.count, buffer, size, rec.seq);
+}
+
+/**
+ * @brief Encodes a Message object into a binary frame.
+ *
+ * @param msg The Message object to encode.
+ * @param buffer Buffer to write the frame to.
+ * @param size Size of the buffer.
+ * @return size_t Length of the frame, 0 if it couldn't be encoded.
+ */
+size_t encode_binary(const Message &msg, char *buffer, size_t size) {
+    if (msg.content.size() > MSG_MAX_FIELDS) { return 0; }
+    std::string_view fields[MSG_MAX_FIELDS];
+    for (size_t i = 0; i < msg.content.size(); ++i) {
+        fields[i] = msg.content[i];
+    }
+    return encode_binary(msg.type, fields, msg.content.size(), buffer, size);
+}
 
-    std::vector<std::string> tokens;
-    if (!str_to_vec(str, ',', tokens)) { return 5; }
+/**
+ * @brief Decodes a binary frame into a Record.
+ *
+ * Integer fields are converted to decimal text so the Record looks the same as one decoded from an ASCII message.
+ * The fields are checked against the schema while they are decoded.
+ *
+ * @param frame The COBS encoded frame without the delimiters.
+ * @param rec Reference to the Record to populate.
+ * @return int Error code (0 if successful, non-zero otherwise).
+ */
+int decode_binary(std::string_view frame, Record &rec) {
+    rec.clear();
 
-    if (tokens.size() < 2) { return 6; }
+    uint8_t raw[MSG_MAX_LENGTH];
+    size_t len = cobs_decode(reinterpret_cast<const uint8_t *>(frame.data()), frame.size(), raw, sizeof(raw));
+    if (len == 0) { return 1; }
+    if (len < 3) { return 6; }
 
-    msg.type = verify_message_type(tokens[0]);
-    if (msg.type == UNASSIGNED) { return 7; }
+    len -= 2;
+    uint16_t attached_crc = raw[len] | (raw[len + 1] << 8);
+    if (crc16(std::string_view(reinterpret_cast<const char *>(raw), len)) != attached_crc) { return 2; }
 
-    tokens.erase(tokens.begin());
-    msg.content = tokens;
+    size_t pos = 1;
+    int16_t seq = -1;
+    uint8_t type_byte = raw[0];
+    if (type_byte & BINARY_SEQUENCED) {
+        if (len < 2) { return 6; }
+        type_byte &= ~BINARY_SEQUENCED;
+        seq = raw[pos++];
+    }
+    if (type_byte <= UNASSIGNED || type_byte > LINK_ACK) { return 7; }
+    MessageType type = static_cast<MessageType>(type_byte);
 
+    const MessageSpec &spec = SCHEMA[type];
+    for (size_t i = 0; pos < len; ++i) {
+        if (i == MSG_MAX_FIELDS) { return 8; }
+
+        int32_t value;
+        switch (spec.fields[i].type) {
+            case FIELD_U8:
+                value = raw[pos];
+                pos += 1;
+                break;
+            case FIELD_I8:
+                value = static_cast<int8_t>(raw[pos]);
+                pos += 1;
+                break;
+            case FIELD_I32:
+                if (pos + 4 > len) { return 9; }
+                value = static_cast<int32_t>(raw[pos] | (raw[pos + 1] << 8) | (raw[pos + 2] << 16) |
+                                             (static_cast<uint32_t>(raw[pos + 3]) << 24));
+                pos += 4;
+                break;
+            case FIELD_TEXT:
+                if (pos + 1 + raw[pos] > len) { return 9; }
+                if (!rec.add(std::string_view(reinterpret_cast<const char *>(raw + pos + 1), raw[pos]))) { return 10; }
+                pos += 1 + raw[pos];
+                continue;
+            default:
+                return 8; // More fields than the message type has
+        }
+        if (value < spec.fields[i].min || value > spec.fields[i].max) { return 11; }
+        char text[12];
+        if (!rec.add(std::string_view(text, std::to_chars(text, text + sizeof(text), value).ptr - text))) { return 10; }
+    }
+    if (rec.count < spec.required) { return 11; }
+    rec.type = type;
+    rec.seq = seq;
+
+    return 0;
+}
+
+/**
+ * @brief Feeds a received byte to the framing state machine.
+ *
+ * @param c The received byte.
+ * @return FrameParser::Result ASCII or BINARY when the byte completed a frame, NONE otherwise.
+ */
+FrameParser::Result FrameParser::feed(uint8_t c) {
+    if (c == MSG_BINARY_DELIMITER) {
+        if (state == IN_BINARY && length > 0) {
+            state = IDLE;
+            return BINARY;
+        }
+        state = IN_BINARY; // Leading delimiter, also abandons a partial ASCII message
+        length = 0;
+        return NONE;
+    }
+
+    switch (state) {
+        case IDLE:
+            if (c != '$') { return NONE; } // Skip everything before the $
+            state = IN_ASCII;
+            length = 0;
+            crc.reset();
+            [[fallthrough]];
+        case IN_ASCII:
+            if (c == ';') {
+                state = IDLE;
+                return ASCII;
+            }
+            if (length == sizeof(buffer)) { // No terminator in sight, drop the partial message
+                state = IDLE;
+                return NONE;
+            }
+            buffer[length++] = c;
+            crc.update(c);
+            return NONE;
+        case IN_BINARY:
+            if (length == sizeof(buffer)) { // No delimiter in sight, wait for the next frame
+                state = IDLE;
+                return NONE;
+            }
+            buffer[length++] = c;
+            return NONE;
+    }
+    return NONE;
+}
+
+/**
+ * @brief Abandons a partially received frame.
+ */
+void FrameParser::reset() {
+    state = IDLE;
+    length = 0;
+}
+
+/**
+ * @brief Converts a string to a Message object.
+ *
+ * Decodes the input string and copies the content fields to the Message struct.
+ *
+ * @param str Input message string. Cleared if the conversion is successful.
+ * @param msg Reference to the Message object to populate.
+ * @param payload_crc CRC of the message up to the CRC field if it was already computed.
+ * @return int Error code (0 if successful, non-zero otherwise).
+ * @note Helper function for decode(std::string_view str, View &view, std::optional<uint16_t> payload_crc).
+ */
+int convert_to_message(std::string &str, Message &msg, std::optional<uint16_t> payload_crc) {
+    View view;
+    if (int result = decode(str, view, payload_crc); result != 0) { return result; }
+
+    msg.type = view.type;
+    msg.content.assign(view.fields, view.fields + view.count);
     str.clear();
 
     return 0;
@@ -46,42 +562,13 @@ int convert_to_message(std::string &str, Message &msg) {
 /**
  * @brief Determines the message type from a string.
  *
- * @param str Reference to the string containing the message type.
+ * @param str Reference to the string containing the message type. The leading '$' is removed.
  * @return MessageType The corresponding message type enumeration.
  */
 MessageType verify_message_type(std::string &str) {
-    if (str[0] != '$') {
-        return UNASSIGNED;
-    } else {
-        str.erase(0, 1);
-    }
-    int type_val;
-    if (!str_to_int(str, type_val)) return UNASSIGNED;
-
-    switch (type_val) {
-        case RESPONSE:
-            return RESPONSE;
-        case DATETIME:
-            return DATETIME;
-        case DEVICE_STATUS:
-            return DEVICE_STATUS;
-        case INSTRUCTIONS:
-            return INSTRUCTIONS;
-        case CMD_STATUS:
-            return CMD_STATUS;
-        case PICTURE:
-            return PICTURE;
-        case DIAGNOSTICS:
-            return DIAGNOSTICS;
-        case WIFI:
-            return WIFI;
-        case SERVER:
-            return SERVER;
-        case API:
-            return API;
-        default:
-            return UNASSIGNED;
-    }
+    MessageType type = to_message_type(str);
+    if (!str.empty() && str[0] == '$') { str.erase(0, 1); }
+    return type;
 }
 
 /**
@@ -91,17 +578,22 @@ MessageType verify_message_type(std::string &str) {
  * @param crc_str The CRC value extracted from the message.
  * @return int Error code (0 if valid, non-zero otherwise).
  */
-int check_message_crc(std::string &str, std::string &crc_str) {
+int check_message_crc(std::string_view str, std::string_view crc_str) { return check_message_crc(crc16(str), crc_str); }
+
+/**
+ * @brief Compares an already computed CRC to the CRC field of a message.
+ *
+ * @param crc The computed CRC of the message content.
+ * @param crc_str The CRC value extracted from the message.
+ * @return int Error code (0 if valid, non-zero otherwise).
+ */
+int check_message_crc(uint16_t crc, std::string_view crc_str) {
     if (crc_str.size() != 4) { return 1; }
 
     uint16_t attached_crc;
-    if (int result; !str_to_int(crc_str, result, true)) {
-        return 2;
-    } else {
-        attached_crc = static_cast<uint16_t>(result);
-    }
+    if (!to_int(crc_str, attached_crc, 16)) { return 2; }
 
-    if (attached_crc != crc16(str)) { return 3; }
+    if (attached_crc != crc) { return 3; }
 
     return 0;
 }
@@ -111,18 +603,15 @@ int check_message_crc(std::string &str, std::string &crc_str) {
  *
  * @param msg The Message object to convert.
  * @param str Reference to store the output string.
+ * @note Helper function for encode(const Message &msg, char *buffer, size_t size).
  */
 void convert_to_string(const Message &msg, std::string &str) {
-    str = "$" + std::to_string(msg.type);
-    for (auto it = msg.content.begin(); it != msg.content.end(); ++it) {
-        str += ",";
-        str += it->c_str();
+    size_t length = 16; // "$<type>" and ",<CRC>;"
+    for (const std::string &field : msg.content) {
+        length += field.size() + 1;
     }
-
-    uint16_t crc = crc16(str);
-    std::string crc_str;
-    num_to_hex_str(crc, crc_str, 4, true, true);
-    str += "," + crc_str + ";";
+    str.resize(length);
+    str.resize(encode(msg, str.data(), str.size()));
 }
 
 /**
@@ -168,6 +657,17 @@ Message device_status(bool ok) {
     }
 }
 
+/**
+ * @brief Creates a device status message that advertises link capabilities.
+ *
+ * @param ok Boolean value indicating device status.
+ * @param capabilities Bitmask of supported Capability values.
+ * @return Message The device status message object.
+ */
+Message device_status(bool ok, int capabilities) {
+    return Message{.type = DEVICE_STATUS, .content = {ok ? "1" : "0", std::to_string(capabilities)}};
+}
+
 /**
  * @brief Creates an instructions message.
  *
@@ -18,6 +18,18 @@
 #define PICO_RESPONSE_WAIT_TIME 10000
 #endif
 
+#ifndef UART_BINARY_FRAMING
+#define UART_BINARY_FRAMING 1 // Advertise binary framing to the Pico, 0 keeps the link readable on a terminal
+#endif
+
+#ifndef LINK_SERVICE_PERIOD
+#define LINK_SERVICE_PERIOD 20 // How often the Pico link is checked for retransmissions, ms
+#endif
+
+#ifndef LINK_STATS_REPORT_PERIOD
+#define LINK_STATS_REPORT_PERIOD 600000 // How often the Pico link statistics are posted as diagnostics, ms
+#endif
+
 #ifndef GET_REQUEST_TIMER_PERIOD
 #define GET_REQUEST_TIMER_PERIOD 60000
 #endif
@@ -2,7 +2,10 @@
 #define ESP_PICO_COMM_HANDLER_HPP
 
 #include "driver/uart.h"
-#include "requestHandler.hpp"
+#include "freertos/semphr.h"
+#include "lanes.hpp"
+#include "link.hpp"
+#include "message.hpp"
 #include <memory>
 #include <stdint.h>
 #include <string>
@@ -10,10 +13,13 @@
 #define UART_RING_BUFFER_SIZE  512
 #define EVENT_QUEUE_SIZE       5
 #define LONGEST_COMMAND_LENGTH 256
+#define RECEIVED_LANE_SIZE     5 // Received messages queued per traffic lane, see lanes.hpp
 
 struct UartReceivedData {
     char buffer[LONGEST_COMMAND_LENGTH];
     size_t len;
+    uint16_t crc; // CRC of the message up to the CRC field, computed while extracting
+    bool binary;  // buffer holds a COBS encoded binary frame without the delimiters
 };
 
 class EspPicoCommHandler {
@@ -37,15 +43,34 @@ class EspPicoCommHandler {
     uart_port_t get_uart_num();
     uart_config_t get_uart_config();
     QueueHandle_t get_uart_event_queue_handle();
-    QueueHandle_t get_uart_received_data_queue_handle();
+    bool enqueue_received_msg(const msg::Record &rec);
+    bool receive_msg(msg::Record &rec, TickType_t ticksToWait);
 
     void set_waiting_for_response(bool status);
     bool get_waiting_for_response();
 
-    int send_msg_and_wait_for_response(const char *data, const size_t len);
-    void check_if_confirmation_msg(const UartReceivedData &receivedData);
+    int send_msg_and_wait_for_response(const char *data, const size_t len,
+                                       msg::MessageType type = msg::MessageType::UNASSIGNED);
+    int send_msg_and_wait_for_response(const msg::Message &msg);
+    int send_msg(const msg::Message &msg);
+    void check_if_confirmation_msg(const msg::Record &rec);
 
     void send_ACK_msg(const bool ack);
+    void send_ACK_msg(const bool ack, const int32_t image_id);
+
+    void encode_msg(const msg::Message &msg, std::string &str);
+    int decode_msg(const UartReceivedData &receivedData, msg::Record &rec);
+    void set_peer_capabilities(int capabilities);
+    int get_capabilities();
+    bool binary_framing();
+
+    bool accept_msg(const msg::Record &rec);
+    bool next_msg(msg::Record &rec);
+    void service_link();
+    bool sequencing();
+
+    void update_rx_level();
+    const msg::LinkStats &get_link_stats();
 
     bool espInitMsgSent = false;
 
@@ -53,9 +78,24 @@ class EspPicoCommHandler {
     uart_port_t uart_num;
     uart_config_t uart_config;
     QueueHandle_t uart_event_queue;
-    QueueHandle_t uart_received_data_queue;
+    QueueHandle_t receivedLanes[msg::LANE_COUNT]; // Messages for handle_uart_data_task, one queue per lane
+    SemaphoreHandle_t receivedCount;              // Counts the messages in all lanes
+    msg::LaneScheduler laneScheduler;
 
     bool waitingForResponse = false;
+    int peerCapabilities = msg::CAP_NONE;
+
+    void write_record(const msg::Record &rec);
+
+    SemaphoreHandle_t linkMutex;
+    msg::LinkSender linkTx;
+    msg::LinkReceiver linkRx;
+    bool linkAckPending = false;
+
+    msg::LinkStats linkStats;
+    msg::MessageType awaitedType = msg::MessageType::UNASSIGNED; // Message send_msg_and_wait_for_response is sending
+    uint32_t awaitedSinceMs = 0;
+    bool awaitedRetransmitted = false; // No RTT sample once the awaited message was sent again
 };
 
 int find_first_char_position(const char *data_buffer, const size_t data_buffer_len, const char target);
@@ -22,6 +22,7 @@ struct Handlers {
 
 void get_request_timer_callback(void *pvParameters);
 void get_timestamp_timer_callback(void *pvParameters);
+void link_stats_timer_callback(void *pvParameters);
 bool enqueue_with_retry(const QueueHandle_t queue, const void *item, TickType_t ticks_to_wait, int retries);
 bool read_file_with_retry(SDcardHandler *sdcardHandler, const std::string &filename, std::string &file_data, int retries);
 // bool read_file_with_retry_base64(SDcardHandler *sdcardHandler, const std::string &filename, std::string &file_data, int retries);
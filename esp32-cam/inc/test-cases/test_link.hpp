@@ -0,0 +1,19 @@
+#ifndef TEST_LINK_HPP
+#define TEST_LINK_HPP
+
+#include "lanes.hpp"
+#include "link.hpp"
+#include "unity.h"
+
+void test_link_sequenced_encoding();
+void test_link_in_order_delivery();
+void test_link_selective_ack();
+void test_link_retransmit_timeout();
+void test_link_rtt_estimate();
+void test_link_receiver_skips_abandoned();
+void test_lane_scheduler();
+void test_link_stats();
+
+void run_all_link_tests();
+
+#endif // TEST_LINK_HPP
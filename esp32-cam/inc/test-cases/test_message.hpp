@@ -0,0 +1,27 @@
+#ifndef TEST_MESSAGE_HPP
+#define TEST_MESSAGE_HPP
+
+#include "cobs.hpp"
+#include "message.hpp"
+#include "unity.h"
+#include <string>
+
+void test_encode_message();
+void test_encode_buffer_too_small();
+void test_decode_message();
+void test_decode_invalid_crc();
+void test_decode_invalid_type();
+void test_decode_too_many_fields();
+void test_convert_round_trip();
+void test_crc_variants();
+void test_frame_crc();
+void test_cobs_round_trip();
+void test_binary_round_trip();
+void test_binary_invalid_frame();
+void test_frame_parser();
+void test_schema_typed_round_trip();
+void test_schema_rejects_invalid();
+
+void run_all_message_tests();
+
+#endif // TEST_MESSAGE_HPP
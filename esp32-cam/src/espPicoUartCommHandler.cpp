@@ -2,7 +2,19 @@
 #include "debug.hpp"
 #include "defines.hpp"
 #include "driver/gpio.h"
-#include "message.hpp"
+#include "freertos/task.h"
+#include "schema.hpp"
+#include "scopedMutex.hpp"
+
+#include <charconv>
+#include <cstring>
+
+/**
+ * @brief Returns the time used by the link retransmit timers.
+ *
+ * @return uint32_t Milliseconds since the scheduler started.
+ */
+static uint32_t link_time_ms() { return pdTICKS_TO_MS(xTaskGetTickCount()); }
 
 /**
  * @brief Constructs an EspPicoCommHandler object for UART communication.
@@ -13,7 +25,7 @@
  * @param uart_num The UART port to be used for communication.
  * @param uart_config The UART configuration settings.
  *
- * @note Initializes two queues for UART events and received data. Configures UART pins 
+ * @note Initializes the queue for UART events and a queue per traffic lane for received messages. Configures UART pins 
  *       for the specified UART port and installs the UART driver for communication.
  *       Uses `ESP_ERROR_CHECK` to ensure that the UART setup is successful.
  */
@@ -21,7 +33,12 @@ EspPicoCommHandler::EspPicoCommHandler(uart_port_t uart_num, uart_config_t uart_
     this->uart_num = uart_num;
     this->uart_config = uart_config;
     this->uart_event_queue = xQueueCreate(EVENT_QUEUE_SIZE, sizeof(uart_event_t));
-    this->uart_received_data_queue = xQueueCreate(EVENT_QUEUE_SIZE, sizeof(UartReceivedData));
+    for (QueueHandle_t &lane : this->receivedLanes) {
+        lane = xQueueCreate(RECEIVED_LANE_SIZE, sizeof(msg::Record));
+    }
+    this->receivedCount = xSemaphoreCreateCounting(msg::LANE_COUNT * RECEIVED_LANE_SIZE, 0);
+    this->linkMutex = xSemaphoreCreateMutex();
+    this->linkTx.set_stats(&this->linkStats);
 
     ESP_ERROR_CHECK(uart_param_config(this->uart_num, &this->uart_config));
     ESP_ERROR_CHECK(uart_set_pin(this->uart_num, 1, 3, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
@@ -44,8 +61,16 @@ EspPicoCommHandler::~EspPicoCommHandler() {
     if (this->uart_event_queue) {
         vQueueDelete(this->uart_event_queue);  // Delete UART event queue
     }
-    if (this->uart_received_data_queue) {
-        vQueueDelete(this->uart_received_data_queue);  // Delete UART received data queue
+    for (QueueHandle_t lane : this->receivedLanes) {
+        if (lane) {
+            vQueueDelete(lane);  // Delete received message queues
+        }
+    }
+    if (this->receivedCount) {
+        vSemaphoreDelete(this->receivedCount);
+    }
+    if (this->linkMutex) {
+        vSemaphoreDelete(this->linkMutex);
     }
     // Uninstall the UART driver to release resources
     ESP_ERROR_CHECK(uart_driver_delete(this->uart_num));
@@ -59,9 +84,16 @@ EspPicoCommHandler::~EspPicoCommHandler() {
  * @param data A pointer to the data to be sent.
  * @param len The length of the data to be sent.
  *
- * @note This function uses `uart_write_bytes` to send the data to the UART port.
+ * @note This function uses `uart_write_bytes` to send the data to the UART port. The fill level of the transmit
+ *       buffer is sampled afterwards for the link statistics.
  */
-void EspPicoCommHandler::send_data(const char *data, const size_t len) { uart_write_bytes(this->uart_num, data, len); }
+void EspPicoCommHandler::send_data(const char *data, const size_t len) {
+    uart_write_bytes(this->uart_num, data, len);
+    size_t free = 0;
+    if (uart_get_tx_buffer_free_size(this->uart_num, &free) == ESP_OK) {
+        this->linkStats.level(msg::LinkStats::TX_BUFFER, UART_RING_BUFFER_SIZE - free);
+    }
+}
 
 /**
  * @brief Receives data from the UART interface.
@@ -119,13 +151,52 @@ uart_config_t EspPicoCommHandler::get_uart_config() { return this->uart_config;
 QueueHandle_t EspPicoCommHandler::get_uart_event_queue_handle() { return this->uart_event_queue; }
 
 /**
- * @brief Retrieves the UART received data queue handle.
+ * @brief Queues a message received from the Pico for `handle_uart_data_task`.
+ *
+ * The message goes into the queue of its traffic lane (see `msg::lane_of`), so picture triggers and datetime
+ * requests are handled before diagnostics that arrived earlier.
  *
- * This function returns the handle to the queue used for storing received UART data.
+ * @param rec The decoded message.
+ *
+ * @return bool Returns:
+ * @return        - `true` if the message was queued.
+ * @return        - `false` if its lane stayed full for `RETRIES` attempts.
+ */
+bool EspPicoCommHandler::enqueue_received_msg(const msg::Record &rec) {
+    for (int retry = 0; retry < RETRIES; ++retry) {
+        if (xQueueSend(this->receivedLanes[msg::lane_of(rec.type)], &rec, 0) == pdTRUE) {
+            xSemaphoreGive(this->receivedCount);
+            this->linkStats.level(msg::LinkStats::RX_QUEUE, uxSemaphoreGetCount(this->receivedCount));
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Takes the next received message, choosing the lane with `msg::LaneScheduler`.
+ *
+ * @param rec Reference to store the message.
+ * @param ticksToWait Time to wait for a message.
+ *
+ * @return bool Returns:
+ * @return        - `true` if a message was received.
+ * @return        - `false` if no message arrived in time.
  *
- * @return QueueHandle_t The handle to the UART received data queue.
+ * @note Only `handle_uart_data_task` takes messages, the scheduler isn't shared.
  */
-QueueHandle_t EspPicoCommHandler::get_uart_received_data_queue_handle() { return this->uart_received_data_queue; }
+bool EspPicoCommHandler::receive_msg(msg::Record &rec, TickType_t ticksToWait) {
+    if (xSemaphoreTake(this->receivedCount, ticksToWait) != pdTRUE) { return false; }
+
+    bool waiting[msg::LANE_COUNT];
+    for (int lane = 0; lane < msg::LANE_COUNT; ++lane) {
+        waiting[lane] = uxQueueMessagesWaiting(this->receivedLanes[lane]) > 0;
+    }
+    int lane = this->laneScheduler.select(waiting);
+    if (lane < 0 || xQueueReceive(this->receivedLanes[lane], &rec, 0) != pdTRUE) { return false; }
+    this->laneScheduler.taken(lane);
+    return true;
+}
 
 /**
  * @brief Sets the status for waiting for a response.
@@ -160,6 +231,7 @@ bool EspPicoCommHandler::get_waiting_for_response() { return this->waitingForRes
  *
  * @param data A pointer to the data to be sent.
  * @param len The length of the data to be sent.
+ * @param type Type of the message, used for the link statistics.
  *
  * @return int Returns:
  * @return        - `0` if a response is received within the retry limit.
@@ -168,13 +240,21 @@ bool EspPicoCommHandler::get_waiting_for_response() { return this->waitingForRes
  * @note The function will wait for a response for a predefined amount of time
  *       between retries (`PICO_RESPONSE_WAIT_TIME`). The retry limit is defined by `RETRIES`.
  */
-int EspPicoCommHandler::send_msg_and_wait_for_response(const char *data, const size_t len) {
+int EspPicoCommHandler::send_msg_and_wait_for_response(const char *data, const size_t len, msg::MessageType type) {
     DEBUG("Sending message and waiting for response");
     int retries = 0;
+    this->awaitedType = type;
+    this->awaitedSinceMs = link_time_ms();
+    this->awaitedRetransmitted = false;
     this->set_waiting_for_response(true);
     while (this->get_waiting_for_response() && retries < RETRIES) {
         DEBUG("Sending message and waiting for response");
         this->send_data(data, len);
+        this->linkStats.count(msg::LinkStats::SENT, type);
+        if (retries > 0) {
+            this->linkStats.count(msg::LinkStats::RETRANSMITTED, type);
+            this->awaitedRetransmitted = true;
+        }
         retries++;
         vTaskDelay(pdMS_TO_TICKS(PICO_RESPONSE_WAIT_TIME));
     }
@@ -188,32 +268,100 @@ int EspPicoCommHandler::send_msg_and_wait_for_response(const char *data, const s
     return 0;
 }
 
+/**
+ * @brief Sends a message and waits until the Pico has received it.
+ *
+ * With a sequenced link the message goes through the link window and the function returns as soon as the Pico
+ * acknowledges it. The link retransmits it with an RTT based timeout in the meantime. Without sequencing the message
+ * is encoded and sent with the stop-and-wait retries of the raw overload.
+ *
+ * @param msg The message to be sent.
+ *
+ * @return int Returns:
+ * @return        - `0` if the Pico received the message.
+ * @return        - `1` if the message couldn't be delivered.
+ */
+int EspPicoCommHandler::send_msg_and_wait_for_response(const msg::Message &msg) {
+    if (!this->sequencing()) {
+        std::string str;
+        this->encode_msg(msg, str);
+        return this->send_msg_and_wait_for_response(str.c_str(), str.length(), msg.type);
+    }
+
+    int seq = this->send_msg(msg);
+    if (seq < 0) { return 1; }
+    while (true) {
+        {
+            ScopedMutex lock(this->linkMutex);
+            msg::LinkSender::State state = this->linkTx.state(seq);
+            if (state != msg::LinkSender::PENDING) {
+                if (state == msg::LinkSender::FAILED) { DEBUG("Pico didn't acknowledge sequence number ", seq); }
+                return state == msg::LinkSender::ACKED ? 0 : 1;
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(LINK_SERVICE_PERIOD));
+    }
+}
+
+/**
+ * @brief Sends a message to the Pico without waiting for a response.
+ *
+ * With a sequenced link the message is retransmitted until the Pico acknowledges it. The function only blocks while
+ * the link window is full.
+ *
+ * @param msg The message to be sent.
+ *
+ * @return int Returns:
+ * @return        - The sequence number of the message.
+ * @return        - `-1` if the link isn't sequenced or the message is too large.
+ */
+int EspPicoCommHandler::send_msg(const msg::Message &msg) {
+    msg::Record rec;
+    if (!msg::to_record(msg, rec)) {
+        DEBUG("Message too large to send");
+        return -1;
+    }
+    if (!this->sequencing() || msg.type == msg::MessageType::DEVICE_STATUS) {
+        this->write_record(rec);
+        return -1;
+    }
+
+    while (true) {
+        {
+            ScopedMutex lock(this->linkMutex);
+            if (const msg::Record *sequenced = this->linkTx.send(rec, link_time_ms())) {
+                this->write_record(*sequenced);
+                return sequenced->seq;
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(LINK_SERVICE_PERIOD)); // Window full, wait for acknowledgements
+    }
+}
+
 /**
  * @brief Checks if the received message is a confirmation response.
  *
- * This function processes the received UART data to determine if it is a valid 
- * confirmation message. If the message type is a response and indicates success 
- * (i.e., the content is "1"), it updates the waiting status. 
+ * This function checks whether a received message is a valid confirmation message. If the
+ * message type is a response and indicates success (i.e., the content is "1"), it updates
+ * the waiting status. 
  *
- * @param receivedData The received UART data to be checked.
+ * @param rec The received message to be checked.
  *
- * @note The function assumes that the received data can be successfully 
- *       converted into a `msg::Message`. If the message is of type `RESPONSE` 
- *       and contains a content of "1", it indicates a positive confirmation.
+ * @note If the message is of type `RESPONSE` and contains a content of "1", it indicates
+ *       a positive confirmation. The time since the message was sent is kept as an RTT sample unless it was
+ *       retransmitted, a NACK is counted for the type of the awaited message.
  */
-void EspPicoCommHandler::check_if_confirmation_msg(const UartReceivedData &receivedData) {
+void EspPicoCommHandler::check_if_confirmation_msg(const msg::Record &rec) {
     DEBUG("Checking if confirmation message");
-    std::string string(receivedData.buffer, receivedData.len);
-    msg::Message msg;
-
-    if (convert_to_message(string, msg) == 0) {
-        if (msg.type == msg::MessageType::RESPONSE) {
-            if (msg.content[0] == "1") {
-                DEBUG("Pico Confirmation response returned true");
-                this->set_waiting_for_response(false);
-            } else {
-                DEBUG("Pico Confirmation response returned false");
-            }
+
+    if (rec.type == msg::MessageType::RESPONSE) {
+        if (rec.field(0) == "1") {
+            DEBUG("Pico Confirmation response returned true");
+            if (!this->awaitedRetransmitted) { this->linkStats.rtt(link_time_ms() - this->awaitedSinceMs); }
+            this->set_waiting_for_response(false);
+        } else {
+            DEBUG("Pico Confirmation response returned false");
+            this->linkStats.count(msg::LinkStats::NACKED, this->awaitedType);
         }
     }
 }
@@ -228,16 +376,241 @@ void EspPicoCommHandler::check_if_confirmation_msg(const UartReceivedData &recei
  *            - `true` for a positive acknowledgment.
  *            - `false` for a negative acknowledgment.
  *
- * @note The message is generated using the `msg::response` function, 
- *       converted to a string, and then sent using the `send_data` method.
+ * @note The message is encoded into a stack buffer and then sent using the 
+ *       `send_data` method. A binary frame is used if the Pico supports it.
  */
 void EspPicoCommHandler::send_ACK_msg(const bool ack) {
-    msg::Message msg = msg::response(ack);
-    std::string string;
-    convert_to_string(msg, string);
-    this->send_data(string.c_str(), string.length());
+    std::string_view field = ack ? "1" : "0";
+    char buffer[16];
+    size_t len = this->binary_framing()
+                     ? msg::encode_binary(msg::MessageType::RESPONSE, &field, 1, buffer, sizeof(buffer))
+                     : msg::encode(msg::MessageType::RESPONSE, &field, 1, buffer, sizeof(buffer));
+    this->send_data(buffer, len);
+    this->linkStats.count(msg::LinkStats::SENT, msg::MessageType::RESPONSE);
+}
+
+/**
+ * @brief Sends the ACK or NACK for a PICTURE message.
+ * @details The image id tells the Pico which RESPONSE answers its PICTURE, RESPONSEs to other messages may arrive
+ * before or after it.
+ *
+ * @param ack True to send an ACK, false to send a NACK.
+ * @param image_id Image id of the PICTURE message.
+ */
+void EspPicoCommHandler::send_ACK_msg(const bool ack, const int32_t image_id) {
+    char id[12];
+    size_t id_len = std::to_chars(id, id + sizeof(id), image_id).ptr - id;
+    std::string_view fields[] = {ack ? "1" : "0", std::string_view(id, id_len)};
+    char buffer[32];
+    size_t len = this->binary_framing()
+                     ? msg::encode_binary(msg::MessageType::RESPONSE, fields, 2, buffer, sizeof(buffer))
+                     : msg::encode(msg::MessageType::RESPONSE, fields, 2, buffer, sizeof(buffer));
+    this->send_data(buffer, len);
+    this->linkStats.count(msg::LinkStats::SENT, msg::MessageType::RESPONSE);
+}
+
+/**
+ * @brief Encodes a message in the framing negotiated with the Pico.
+ *
+ * Uses a binary frame if the Pico advertised support for it and the message can be represented in binary. Falls
+ * back to the ASCII format otherwise.
+ *
+ * @param msg The message to encode.
+ * @param str Reference to store the encoded message.
+ */
+void EspPicoCommHandler::encode_msg(const msg::Message &msg, std::string &str) {
+    if (this->binary_framing()) {
+        str.resize(MSG_MAX_LENGTH);
+        if (size_t len = msg::encode_binary(msg, str.data(), str.size()); len > 0) {
+            str.resize(len);
+            return;
+        }
+    }
+    convert_to_string(msg, str);
+}
+
+/**
+ * @brief Decodes a message extracted from the UART buffer.
+ *
+ * @param receivedData The extracted message, either ASCII or a binary frame.
+ * @param rec Reference to the Record to populate.
+ *
+ * @return int Returns:
+ * @return        - `0` on success.
+ * @return        - Non-zero error code from `msg::decode` or `msg::decode_binary` otherwise.
+ *
+ * @note Every frame is counted in the link statistics, failed ones with type `UNASSIGNED`.
+ */
+int EspPicoCommHandler::decode_msg(const UartReceivedData &receivedData, msg::Record &rec) {
+    std::string_view data(receivedData.buffer, receivedData.len);
+    int result;
+    if (receivedData.binary) {
+        result = msg::decode_binary(data, rec);
+    } else {
+        msg::View view;
+        result = msg::decode(data, view, receivedData.crc);
+        if (result == 0 && !msg::to_record(view, rec)) { result = 10; }
+    }
+
+    if (result == 0) {
+        this->linkStats.count(msg::LinkStats::RECEIVED, rec.type);
+    } else {
+        this->linkStats.count(msg::LinkStats::CRC_FAILED, msg::MessageType::UNASSIGNED);
+    }
+    return result;
+}
+
+/**
+ * @brief Stores the capabilities the Pico advertised in its DEVICE_STATUS message and restarts the link.
+ *
+ * The Pico sends DEVICE_STATUS when it starts, so both ends restart their sequence numbers from zero.
+ *
+ * @param capabilities Bitmask of `msg::Capability` values, `CAP_NONE` for a Pico that doesn't advertise any.
+ */
+void EspPicoCommHandler::set_peer_capabilities(int capabilities) {
+    ScopedMutex lock(this->linkMutex);
+    this->peerCapabilities = capabilities;
+    this->linkTx.reset();
+    this->linkRx.reset();
+    this->linkAckPending = false;
+}
+
+/**
+ * @brief Retrieves the capabilities to advertise in DEVICE_STATUS messages.
+ *
+ * @return int Bitmask of `msg::Capability` values.
+ */
+int EspPicoCommHandler::get_capabilities() {
+    return msg::CAP_SEQUENCED | (UART_BINARY_FRAMING ? msg::CAP_BINARY_FRAMING : msg::CAP_NONE);
 }
 
+/**
+ * @brief Checks whether messages to the Pico are sent as binary frames.
+ *
+ * @return bool Returns:
+ * @return        - `true` if both devices support binary framing.
+ * @return        - `false` if the link uses the ASCII format.
+ */
+bool EspPicoCommHandler::binary_framing() {
+    return (this->get_capabilities() & this->peerCapabilities & msg::CAP_BINARY_FRAMING) != 0;
+}
+
+/**
+ * @brief Checks whether messages to the Pico go through the sliding-window link.
+ *
+ * @return bool Returns:
+ * @return        - `true` if both devices support sequenced messages.
+ * @return        - `false` if the link is stop-and-wait.
+ */
+bool EspPicoCommHandler::sequencing() {
+    return (this->get_capabilities() & this->peerCapabilities & msg::CAP_SEQUENCED) != 0;
+}
+
+/**
+ * @brief Passes a decoded message received from the Pico to the link.
+ *
+ * LINK_ACK messages are consumed by the link. Sequenced messages are buffered until they can be
+ * released in order with `next_msg` and are acknowledged on the next `service_link`.
+ *
+ * @param rec The decoded message.
+ *
+ * @return bool Returns:
+ * @return        - `true` if the message is unsequenced and should be handled right away.
+ * @return        - `false` if the link consumed the message.
+ */
+bool EspPicoCommHandler::accept_msg(const msg::Record &rec) {
+    if (rec.type == msg::MessageType::LINK_ACK) {
+        if (msg::LinkAck ack; msg::decode(rec, ack)) {
+            ScopedMutex lock(this->linkMutex);
+            this->linkTx.on_ack(ack.cumulative, ack.sack, link_time_ms());
+        }
+        return false;
+    }
+    if (rec.seq < 0) { return true; }
+
+    ScopedMutex lock(this->linkMutex);
+    this->linkRx.accept(rec); // Duplicates are acknowledged again, the previous LINK_ACK may have been lost
+    this->linkAckPending = true;
+    return false;
+}
+
+/**
+ * @brief Retrieves the next sequenced message in order.
+ *
+ * @param rec Reference to store the message.
+ *
+ * @return bool Returns:
+ * @return        - `true` if a message was released.
+ * @return        - `false` if the next message in sequence hasn't been received.
+ */
+bool EspPicoCommHandler::next_msg(msg::Record &rec) {
+    ScopedMutex lock(this->linkMutex);
+    const msg::Record *front = this->linkRx.front();
+    if (front == nullptr) { return false; }
+    rec = *front;
+    this->linkRx.pop();
+    return true;
+}
+
+/**
+ * @brief Sends pending link acknowledgements and retransmits messages the Pico hasn't acknowledged in time.
+ *
+ * @note Called by `uart_read_task` after every UART event and at least every `LINK_SERVICE_PERIOD` milliseconds.
+ */
+void EspPicoCommHandler::service_link() {
+    ScopedMutex lock(this->linkMutex);
+    if (this->linkAckPending) {
+        msg::Record ack;
+        if (msg::to_record(msg::LinkAck{this->linkRx.cumulative(), this->linkRx.sack()}, ack)) {
+            this->write_record(ack);
+        }
+        this->linkAckPending = false;
+    }
+    if (!this->sequencing()) { return; }
+
+    uint32_t now = link_time_ms();
+    while (const msg::Record *rec = this->linkTx.poll(now)) {
+        DEBUG("Retransmitting sequence number ", rec->seq);
+        this->write_record(*rec);
+    }
+}
+
+/**
+ * @brief Encodes a message record in the negotiated framing and sends it.
+ *
+ * @param rec The record to be sent.
+ */
+void EspPicoCommHandler::write_record(const msg::Record &rec) {
+    char buffer[MSG_MAX_LENGTH];
+    size_t len = this->binary_framing() ? msg::encode_binary(rec, buffer, sizeof(buffer)) : 0;
+    if (len == 0) { len = msg::encode(rec, buffer, sizeof(buffer)); }
+    if (len > 0) {
+        this->send_data(buffer, len);
+        this->linkStats.count(msg::LinkStats::SENT, rec.type);
+    } else {
+        DEBUG("Message too long to send");
+    }
+}
+
+/**
+ * @brief Samples the number of received bytes waiting in the UART driver for the link statistics.
+ *
+ * @note Called by `uart_read_task` before it reads the data of a UART event.
+ */
+void EspPicoCommHandler::update_rx_level() {
+    size_t buffered = 0;
+    if (uart_get_buffered_data_len(this->uart_num, &buffered) == ESP_OK) {
+        this->linkStats.level(msg::LinkStats::RX_BUFFER, buffered);
+    }
+}
+
+/**
+ * @brief Retrieves the link statistics.
+ *
+ * @return const msg::LinkStats& Counters since boot. Updated by several tasks without locking.
+ */
+const msg::LinkStats &EspPicoCommHandler::get_link_stats() { return this->linkStats; }
+
 /**
  * @brief Finds the position of the first occurrence of a target character in a buffer.
  *
@@ -275,11 +648,78 @@ int find_first_char_position(const char *data_buffer, const size_t data_buffer_l
     return -2; // char not found
 }
 
+/**
+ * @brief Removes a range of characters from a UART buffer.
+ *
+ * @param data_buffer A pointer to the UART data buffer.
+ * @param data_buffer_len A pointer to the length of the data buffer, updated after the removal.
+ * @param start_pos Index of the first character to remove.
+ * @param count Number of characters to remove.
+ */
+static void remove_from_uart_buffer(char *data_buffer, size_t *data_buffer_len, size_t start_pos, size_t count) {
+    size_t index = start_pos;
+    while (index < *data_buffer_len - count) {
+        data_buffer[index] = data_buffer[index + count];
+        index++;
+    }
+    data_buffer[index] = '\0';
+    *data_buffer_len -= count;
+}
+
+/**
+ * @brief Extracts a binary frame from a UART buffer.
+ *
+ * The frame starts at a `MSG_BINARY_DELIMITER` byte and ends at the next one. Repeated
+ * delimiters are skipped. The frame is copied without the delimiters.
+ *
+ * @param data_buffer A pointer to the UART data buffer containing the frame.
+ * @param data_buffer_len A pointer to the length of the data buffer.
+ * @param start_pos Index of the leading delimiter.
+ * @param extracted_msg A pointer to a structure where the extracted frame will be stored.
+ *
+ * @return int Returns:
+ * @return        - `0` on successful extraction.
+ * @return        - `-2` if the end of the frame hasn't been received.
+ * @return        - `-4` if the frame is too long.
+ */
+static int extract_binary_frame(char *data_buffer, size_t *data_buffer_len, int start_pos,
+                                UartReceivedData *extracted_msg) {
+    size_t data_pos = start_pos;
+    while (data_pos < *data_buffer_len && data_buffer[data_pos] == MSG_BINARY_DELIMITER) {
+        data_pos++;
+    }
+
+    int end_pos = find_first_char_position(data_buffer + data_pos, *data_buffer_len - data_pos, MSG_BINARY_DELIMITER);
+    if (end_pos < 0) {
+        DEBUG("No end of binary frame found");
+        return -2; // No end of message found
+    }
+
+    size_t frame_length = end_pos;
+    if (frame_length >= LONGEST_COMMAND_LENGTH) {
+        DEBUG("Binary frame too long");
+        remove_from_uart_buffer(data_buffer, data_buffer_len, start_pos, data_pos + frame_length - start_pos);
+        return -4; // Message too long
+    }
+
+    memcpy(extracted_msg->buffer, data_buffer + data_pos, frame_length);
+    extracted_msg->buffer[frame_length] = '\0';
+    extracted_msg->len = frame_length;
+    extracted_msg->crc = 0;
+    extracted_msg->binary = true;
+
+    // Remove the frame and its trailing delimiter
+    remove_from_uart_buffer(data_buffer, data_buffer_len, start_pos, data_pos + frame_length + 1 - start_pos);
+    DEBUG("Binary frame extracted, length: ", frame_length);
+    return 0; // Success
+}
+
 /**
  * @brief Extracts a message from a UART buffer.
  *
  * This function searches for a message enclosed between the '$' and ';' characters 
- * in the given buffer. If a valid message is found, it is extracted into the 
+ * or a binary frame enclosed between two `MSG_BINARY_DELIMITER` bytes, whichever
+ * starts first in the given buffer. If a valid message is found, it is extracted into the 
  * `extracted_msg` structure, and the original buffer is updated by removing the 
  * extracted message. The function returns an error code in case of any issues, 
  * such as an invalid start or end position, or if the message is too long.
@@ -297,23 +737,30 @@ int find_first_char_position(const char *data_buffer, const size_t data_buffer_l
  *
  * @note This function modifies the original `data_buffer` by removing the extracted 
  *       message, and updates the `data_buffer_len` accordingly.
+ * @note The CRC of the message is computed while it is copied and stored in `extracted_msg->crc`.
+ *       Binary frames are copied without the delimiters and decoded later with `msg::decode_binary`.
  */
 int extract_msg_from_uart_buffer(char *data_buffer, size_t *data_buffer_len, UartReceivedData *extracted_msg) {
     DEBUG("Extracting message from buffer: ", data_buffer);
     DEBUG("Buffer length: ", *data_buffer_len);
     int start_pos = find_first_char_position(data_buffer, *data_buffer_len, '$');
+    int binary_pos = find_first_char_position(data_buffer, *data_buffer_len, MSG_BINARY_DELIMITER);
+    if (binary_pos >= 0 && (start_pos < 0 || binary_pos < start_pos)) {
+        return extract_binary_frame(data_buffer, data_buffer_len, binary_pos, extracted_msg);
+    }
     if (start_pos < 0) {
         DEBUG("No start of message found");
         DEBUG("Start position: ", start_pos);
         return -1; // No message found
     }
 
-    int end_pos = find_first_char_position(data_buffer, *data_buffer_len, ';');
+    int end_pos = find_first_char_position(data_buffer + start_pos, *data_buffer_len - start_pos, ';');
     if (end_pos < 0) {
         DEBUG("No end of message found");
         DEBUG("End position: ", end_pos);
         return -2; // No end of message found
     }
+    end_pos += start_pos;
 
     if (start_pos >= end_pos) {
         DEBUG("Start position is after end position");
@@ -323,27 +770,25 @@ int extract_msg_from_uart_buffer(char *data_buffer, size_t *data_buffer_len, Uar
 
     // Extract the message from the buffer
     int msg_length = end_pos - start_pos + 1;
-    if (msg_length > LONGEST_COMMAND_LENGTH) {
+    if (msg_length >= LONGEST_COMMAND_LENGTH) { // Room is needed for the null terminator
         DEBUG("Message too long");
         return -4; // Message too long
     }
 
-    // Copy the message to extracted_msg_buffer
-    strncpy(extracted_msg->buffer, data_buffer + start_pos, msg_length);
+    // Copy the message to extracted_msg_buffer and fold it into the CRC on the way
+    msg::FrameCrc crc;
+    for (int i = 0; i < msg_length - 1; ++i) {
+        extracted_msg->buffer[i] = data_buffer[start_pos + i];
+        crc.update(data_buffer[start_pos + i]);
+    }
+    extracted_msg->buffer[msg_length - 1] = ';';
     extracted_msg->buffer[msg_length] = '\0'; // Null terminate the string
     extracted_msg->len = msg_length;
+    extracted_msg->crc = crc.payload_crc();
+    extracted_msg->binary = false;
 
     // remove the message from the buffer
-    int chars_to_remove = end_pos - start_pos + 1;
-    int index = start_pos;
-    while (index < *data_buffer_len - chars_to_remove) {
-        data_buffer[index] = data_buffer[index + chars_to_remove];
-        index++;
-    }
-    data_buffer[index] = '\0';
-
-    // Update the data buffer length
-    *data_buffer_len -= chars_to_remove;
+    remove_from_uart_buffer(data_buffer, data_buffer_len, start_pos, end_pos - start_pos + 1);
     DEBUG("Buffer after extraction: ", data_buffer);
     DEBUG("Buffer length after extraction: ", *data_buffer_len);
     return 0; // Success
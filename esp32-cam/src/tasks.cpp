@@ -20,6 +20,7 @@
 #include "message.hpp"
 #include "nvs_flash.h"
 #include "requestHandler.hpp"
+#include "schema.hpp"
 #include "sd-card.hpp"
 #include "sdkconfig.h"
 #include "socket.h"
@@ -205,6 +206,19 @@ void wifi_reconnect_timer_callback(TimerHandle_t timer) {
     if (wirelessHandler->isConnected() == false) { xTimerStart(timer, pdMS_TO_TICKS(RECONNECT_TIMER_PERIOD)); }
 }
 
+/**
+ * @brief Timer callback function that posts the Pico link statistics as diagnostics.
+ *
+ * @param timer The timer handle that triggered this callback. It contains the reference to the `Handlers` struct.
+ *
+ * @note See `msg::LinkStats::summary` for the format of the message.
+ */
+void link_stats_timer_callback(TimerHandle_t timer) {
+    Handlers *handlers = (Handlers *)pvTimerGetTimerID(timer);
+    handlers->diagnosticsPoster->add_diagnostics_to_queue(
+        "ESP: Pico link " + handlers->espPicoCommHandler->get_link_stats().summary(), DiagnosticsStatus::INFO);
+}
+
 // ----------------------------------------------------------
 // ------------------------TASKS-----------------------------
 // ----------------------------------------------------------
@@ -297,9 +311,12 @@ void init_task(void *pvParameters) {
                                                handlers->requestHandler.get(), get_request_timer_callback);
     TimerHandle_t getTimestampTmr = xTimerCreate("GETTimestampTimer", pdMS_TO_TICKS(20000), pdFALSE,
                                                  handlers->requestHandler.get(), get_timestamp_timer_callback);
+    TimerHandle_t linkStatsTmr = xTimerCreate("LinkStatsTimer", pdMS_TO_TICKS(LINK_STATS_REPORT_PERIOD), pdTRUE,
+                                              handlers.get(), link_stats_timer_callback);
 
     xTimerStart(getRequestTmr, GET_REQUEST_TIMER_PERIOD);
     xTimerStart(getTimestampTmr, 0);
+    xTimerStart(linkStatsTmr, 0);
 
     xTaskCreate(send_request_to_websrv_task, "send_request_to_websrv_task", 40960, handlers.get(), TaskPriorities::HIGH,
                 nullptr);
@@ -307,11 +324,12 @@ void init_task(void *pvParameters) {
     xTaskCreate(handle_uart_data_task, "handle_uart_data_task", 8192, handlers.get(), TaskPriorities::MEDIUM, nullptr);
 
     // Send ESP initialized message to Pico to let it ESP is ready to communicate
-    msg::Message msg = msg::device_status(true);
+    msg::Message msg = msg::device_status(true, handlers->espPicoCommHandler->get_capabilities());
     std::string msg_str;
-    convert_to_string(msg, msg_str);
+    convert_to_string(msg, msg_str); // Framing is negotiated by this message, so it is always ASCII
     handlers->espPicoCommHandler->espInitMsgSent = true;
-    handlers->espPicoCommHandler->send_msg_and_wait_for_response(msg_str.c_str(), msg_str.length());
+    handlers->espPicoCommHandler->send_msg_and_wait_for_response(msg_str.c_str(), msg_str.length(),
+                                                                 msg::MessageType::DEVICE_STATUS);
 
     // Start reconnect loop if not connected
     if (handlers->wirelessHandler->isConnected() == false) {
@@ -411,9 +429,7 @@ void send_request_to_websrv_task(void *pvParameters) {
 
                     uart_msg =
                         msg::instructions(parsed_results["target"], parsed_results["id"], parsed_results["position"]);
-                    convert_to_string(uart_msg, uart_msg_str);
-
-                    espPicoCommHandler->send_data(uart_msg_str.c_str(), uart_msg_str.length());
+                    espPicoCommHandler->send_msg(uart_msg);
 
                     parsed_results.clear();
                     response.buffer_length = 0;
@@ -494,8 +510,24 @@ void send_request_to_websrv_task(void *pvParameters) {
     }
 }
 
+// Passes a message received from the Pico to the task waiting for a confirmation or to handle_uart_data_task
+static void route_received_msg(EspPicoCommHandler *espPicoCommHandler, DiagnosticsPoster *diagnosticsPoster,
+                               const msg::Record &record) {
+    if (espPicoCommHandler->get_waiting_for_response()) {
+        DEBUG("Waiting for response");
+        espPicoCommHandler->check_if_confirmation_msg(record);
+    } else {
+        DEBUG("Enqueuing message of type: ", static_cast<int>(record.type));
+        if (espPicoCommHandler->enqueue_received_msg(record) == false) {
+            diagnosticsPoster->add_diagnostics_to_queue("ESP: Failed to enqueue data received from uart for handling.",
+                                                        DiagnosticsStatus::ERROR);
+            DEBUG("Failed to enqueue received data");
+        }
+    }
+}
+
 // Run on highest prio.
-// Reads uart and enqueues received buffer to queue.
+// Reads uart and enqueues received messages to queue.
 // Requires EspPicoCommHandler to be initialized
 // TODO: holy shit this is trash plz have time to rework...
 void uart_read_task(void *pvParameters) {
@@ -507,17 +539,19 @@ void uart_read_task(void *pvParameters) {
     char data_read_from_uart[UART_RING_BUFFER_SIZE];
     size_t uart_databuffer_len;
     UartReceivedData uartReceivedData;
-    std::string string;
-    msg::Message msg;
+    msg::Record record;
 
     int return_code;
 
     DiagnosticsPoster *diagnosticsPoster = handlers->diagnosticsPoster.get();
 
     while (true) {
-        if (xQueueReceive(espPicoCommHandler->get_uart_event_queue_handle(), (void *)&uart_event, portMAX_DELAY)) {
+        // Wake up regularly even without UART events so the link can retransmit unacknowledged messages
+        if (xQueueReceive(espPicoCommHandler->get_uart_event_queue_handle(), (void *)&uart_event,
+                          pdMS_TO_TICKS(LINK_SERVICE_PERIOD))) {
             switch (uart_event.type) {
                 case UART_DATA:
+                    espPicoCommHandler->update_rx_level();
                     uart_databuffer_len =
                         uart_read_bytes(espPicoCommHandler->get_uart_num(), (uint8_t *)data_read_from_uart,
                                         (sizeof(data_read_from_uart) - 1), pdMS_TO_TICKS(100));
@@ -532,17 +566,17 @@ void uart_read_task(void *pvParameters) {
                         extract_msg_from_uart_buffer(data_read_from_uart, &uart_databuffer_len, &uartReceivedData);
                     DEBUG("Return code: ", return_code);
                     while (return_code == 0) {
-                        if (espPicoCommHandler->get_waiting_for_response()) {
-                            DEBUG("Waiting for response");
-                            espPicoCommHandler->check_if_confirmation_msg(uartReceivedData);
+                        if (espPicoCommHandler->decode_msg(uartReceivedData, record) != 0) {
+                            diagnosticsPoster->add_diagnostics_to_queue("ESP: Failed to convert UART data to message",
+                                                                        DiagnosticsStatus::ERROR);
+                            DEBUG("Failed to convert received data to message");
                         } else {
-                            DEBUG("Enqueuing : ", uartReceivedData.buffer);
-                            if (enqueue_with_retry(espPicoCommHandler->get_uart_received_data_queue_handle(),
-                                                   &uartReceivedData, 0, RETRIES) == false) {
-                                diagnosticsPoster->add_diagnostics_to_queue(
-                                    "ESP: Failed to enqueue data received from uart for handling.",
-                                    DiagnosticsStatus::ERROR);
-                                DEBUG("Failed to enqueue received data");
+                            // Sequenced messages are released by the link in order, possibly several at once
+                            if (espPicoCommHandler->accept_msg(record)) {
+                                route_received_msg(espPicoCommHandler, diagnosticsPoster, record);
+                            }
+                            while (espPicoCommHandler->next_msg(record)) {
+                                route_received_msg(espPicoCommHandler, diagnosticsPoster, record);
                             }
                         }
                         return_code =
@@ -557,6 +591,7 @@ void uart_read_task(void *pvParameters) {
                     break;
             }
         }
+        espPicoCommHandler->service_link();
     }
 
     free(data_read_from_uart); // should never reach here
@@ -567,7 +602,6 @@ void handle_uart_data_task(void *pvParameters) {
     DEBUG("handle_uart_data_task started");
     Handlers *handlers = (Handlers *)pvParameters;
     EspPicoCommHandler *espPicoCommHandler = handlers->espPicoCommHandler.get();
-    UartReceivedData uartReceivedData;
 
     CameraHandler *cameraHandler = handlers->cameraHandler.get();
     std::string filepath;
@@ -581,245 +615,275 @@ void handle_uart_data_task(void *pvParameters) {
 
     std::string string;
     msg::Message msg;
+    msg::Record record;
 
     while (true) {
-        if (xQueueReceive(espPicoCommHandler->get_uart_received_data_queue_handle(), &uartReceivedData,
-                          portMAX_DELAY) == pdTRUE) {
-            string = uartReceivedData.buffer;
-            DEBUG("Received data: ", string.c_str());
-            if (msg::convert_to_message(string, msg) == 0) {
-
-                switch (msg.type) {
-                    case msg::MessageType::UNASSIGNED:
-                        diagnosticsPoster->add_diagnostics_to_queue("ESP: Unassigned message type received from Pico.",
-                                                                    DiagnosticsStatus::ERROR);
-                        DEBUG("Unassigned message type received");
-                        string.clear();
-                        break;
+        if (espPicoCommHandler->receive_msg(record, portMAX_DELAY)) {
+            DEBUG("Received message of type: ", static_cast<int>(record.type));
+            string.clear();
+
+            // Received messages were checked against the schema when they were decoded, the typed decoders below
+            // convert their fields
+            switch (record.type) {
+                case msg::MessageType::UNASSIGNED:
+                    diagnosticsPoster->add_diagnostics_to_queue("ESP: Unassigned message type received from Pico.",
+                                                                DiagnosticsStatus::ERROR);
+                    DEBUG("Unassigned message type received");
+                    string.clear();
+                    break;
+
+                case msg::MessageType::RESPONSE:
+                    DEBUG("Response message not filtered before reaching handle_uart_data_task");
+                    string.clear();
+                    break;
+
+                case msg::MessageType::DATETIME:
+                    DEBUG("Datetime request received");
 
-                    case msg::MessageType::RESPONSE:
-                        DEBUG("Response message not filtered before reaching handle_uart_data_task");
+                    if (handlers->requestHandler->getTimeSyncedStatus() == false) {
+                        DEBUG("Time not synced, cannot respond to datetime request");
+
+                        espPicoCommHandler->send_ACK_msg(false);
                         string.clear();
                         break;
+                    }
 
-                    case msg::MessageType::DATETIME:
-                        DEBUG("Datetime request received");
+                    if (msg::Datetime datetime; msg::decode(record, datetime) && datetime.value == 1) {
+                        msg = msg::datetime_response(get_datetime());
+                        espPicoCommHandler->send_msg_and_wait_for_response(msg);
+                    } else {
+                        DEBUG("Datetime request first value is not 1");
+                    }
+                    break;
 
-                        if (handlers->requestHandler->getTimeSyncedStatus() == false) {
-                            DEBUG("Time not synced, cannot respond to datetime request");
+                case msg::MessageType::DEVICE_STATUS: {
+                    DEBUG("INIT message received");
 
-                            espPicoCommHandler->send_ACK_msg(false);
-                            string.clear();
-                            break;
-                        }
+                    // The optional capabilities advertise the link features of the Pico, older firmware omits them
+                    msg::DeviceStatus status;
+                    msg::decode(record, status);
+                    espPicoCommHandler->set_peer_capabilities(status.capabilities.value_or(msg::CAP_NONE));
 
-                        if (msg.content[0] == "1") {
-                            msg = msg::datetime_response(get_datetime());
-                            convert_to_string(msg, string);
-                            espPicoCommHandler->send_data(string.c_str(), string.length());
+                    if (espPicoCommHandler->espInitMsgSent == false) {
 
-                            espPicoCommHandler->send_msg_and_wait_for_response(string.c_str(), string.length());
-                            string.clear();
-                        } else {
-                            DEBUG("Datetime request first value is not 1");
+                        msg = msg::device_status(true, espPicoCommHandler->get_capabilities());
+                        convert_to_string(msg, string); // Negotiation messages are always ASCII
+                        if (espPicoCommHandler->send_msg_and_wait_for_response(string.c_str(), string.length(),
+                                                                               msg::MessageType::DEVICE_STATUS) != 0) {
+                            DEBUG("Failed to send device status message");
+                            break;
                         }
-                        break;
+                    } else {
 
-                    case msg::MessageType::DEVICE_STATUS:
-                        DEBUG("INIT message received");
-
-                        if (espPicoCommHandler->espInitMsgSent == false) {
-
-                            msg = msg::device_status(true);
-                            convert_to_string(msg, string);
-                            if (espPicoCommHandler->send_msg_and_wait_for_response(string.c_str(), string.length()) !=
-                                0) {
-                                DEBUG("Failed to send device status message");
-                                break;
-                            }
-                        } else {
+                        espPicoCommHandler->send_ACK_msg(true);
+                    }
 
-                            espPicoCommHandler->send_ACK_msg(true);
-                        }
+                    espPicoCommHandler->espInitMsgSent = false;
 
-                        espPicoCommHandler->espInitMsgSent = false;
+                    diagnosticsPoster->add_diagnostics_to_queue("ESP: Pico initialized message received",
+                                                                DiagnosticsStatus::INFO);
 
-                        diagnosticsPoster->add_diagnostics_to_queue("ESP: Pico initialized message received",
-                                                                    DiagnosticsStatus::INFO);
+                    strncpy(request.str_buffer, string.c_str(), string.size());
+                    request.str_buffer[string.size()] = '\0';
+                    request.buffer_length = string.size();
 
-                        strncpy(request.str_buffer, string.c_str(), string.size());
-                        request.str_buffer[string.size()] = '\0';
-                        request.buffer_length = string.size();
+                    DEBUG("Diagnostics message: ", request.str_buffer);
 
-                        DEBUG("Diagnostics message: ", request.str_buffer);
+                    if (enqueue_with_retry(handlers->requestHandler->getWebSrvRequestQueue(), &request, 0,
+                                           RETRIES) == false) {
+                        DEBUG("Failed to enqueue POST_IMAGE request");
+                    }
 
-                        if (enqueue_with_retry(handlers->requestHandler->getWebSrvRequestQueue(), &request, 0,
-                                               RETRIES) == false) {
-                            DEBUG("Failed to enqueue POST_IMAGE request");
-                        }
+                    request.buffer_length = 0;
+                    request.str_buffer[0] = '\0';
+                    string.clear();
+                    break;
+                }
 
-                        request.buffer_length = 0;
-                        request.str_buffer[0] = '\0';
-                        string.clear();
-                        break;
+                case msg::MessageType::INSTRUCTIONS: // Should not be sent by Pico
+                    diagnosticsPoster->add_diagnostics_to_queue(
+                        "ESP: INSTRUCTIONS message type received from Pico.", DiagnosticsStatus::ERROR);
+                    DEBUG("INSTRUCTIONS message sent by Pico");
+                    string.clear();
+                    break;
 
-                    case msg::MessageType::INSTRUCTIONS: // Should not be sent by Pico
-                        diagnosticsPoster->add_diagnostics_to_queue(
-                            "ESP: INSTRUCTIONS message type received from Pico.", DiagnosticsStatus::ERROR);
-                        DEBUG("INSTRUCTIONS message sent by Pico");
-                        string.clear();
+                case msg::MessageType::CMD_STATUS: {
+                    msg::CmdStatus status;
+                    if (!msg::decode(record, status)) {
+                        espPicoCommHandler->send_ACK_msg(false);
                         break;
+                    }
+                    espPicoCommHandler->send_ACK_msg(true);
+
+                    request.requestType = RequestType::POST;
+                    if (status.time <= 0) {
+                        handlers->requestHandler->createGenericPOSTRequest(
+                            &string, "/api/command", "token",
+                            handlers->wirelessHandler->get_setting(Settings::WEB_TOKEN), "id", status.image_id,
+                            "status", status.status);
+                    } else {
+                        handlers->requestHandler->createGenericPOSTRequest(
+                            &string, "/api/command", "token",
+                            handlers->wirelessHandler->get_setting(Settings::WEB_TOKEN), "id", status.image_id,
+                            "status", status.status, "time", status.time);
+                    }
 
-                    case msg::MessageType::CMD_STATUS:
-                        espPicoCommHandler->send_ACK_msg(true);
+                    DEBUG("Command status message: ", string.c_str());
 
-                        request.requestType = RequestType::POST;
-                        if (std::stoi(msg.content[2]) <= 0) {
-                            handlers->requestHandler->createGenericPOSTRequest(
-                                &string, "/api/command", "token",
-                                handlers->wirelessHandler->get_setting(Settings::WEB_TOKEN), "id",
-                                std::stoi(msg.content[0].c_str()), "status", std::stoi(msg.content[1].c_str()));
-                        } else {
-                            handlers->requestHandler->createGenericPOSTRequest(
-                                &string, "/api/command", "token",
-                                handlers->wirelessHandler->get_setting(Settings::WEB_TOKEN), "id",
-                                std::stoi(msg.content[0].c_str()), "status", std::stoi(msg.content[1].c_str()), "time",
-                                std::stoi(msg.content[2].c_str()));
-                        }
+                    request.buffer_length = string.size();
+                    strncpy(request.str_buffer, string.c_str(), string.size());
+                    request.str_buffer[string.size()] = '\0';
 
-                        DEBUG("Command status message: ", string.c_str());
+                    if (enqueue_with_retry(handlers->requestHandler->getWebSrvRequestQueue(), &request, 0,
+                                           RETRIES) == false) {
+                        diagnosticsPoster->add_diagnostics_to_queue(
+                            "ESP: Failed to enqueue command status message for sending to server.",
+                            DiagnosticsStatus::ERROR);
+                        DEBUG("Failed to enqueue POST_IMAGE request");
+                    }
 
-                        request.buffer_length = string.size();
-                        strncpy(request.str_buffer, string.c_str(), string.size());
-                        request.str_buffer[string.size()] = '\0';
+                    request.buffer_length = 0;
+                    request.str_buffer[0] = '\0';
+                    string.clear();
 
-                        if (enqueue_with_retry(handlers->requestHandler->getWebSrvRequestQueue(), &request, 0,
-                                               RETRIES) == false) {
-                            diagnosticsPoster->add_diagnostics_to_queue(
-                                "ESP: Failed to enqueue command status message for sending to server.",
-                                DiagnosticsStatus::ERROR);
-                            DEBUG("Failed to enqueue POST_IMAGE request");
-                        }
-
-                        request.buffer_length = 0;
-                        request.str_buffer[0] = '\0';
-                        string.clear();
+                    break;
+                }
 
+                case msg::MessageType::PICTURE: {
+                    msg::Picture picture;
+                    if (!msg::decode(record, picture)) {
+                        espPicoCommHandler->send_ACK_msg(false);
                         break;
+                    }
 
-                    case msg::MessageType::PICTURE:
-                        // The camera takes time to 'refresh', a delay is needed to make sure we're taking
-                        // an image of what were pointing at and not what we were pointing at previously.
-                        vTaskDelay(pdMS_TO_TICKS(10000));
+                    // The camera takes time to 'refresh', a delay is needed to make sure we're taking
+                    // an image of what were pointing at and not what we were pointing at previously.
+                    vTaskDelay(pdMS_TO_TICKS(10000));
 
-                        msg::convert_to_message(string, msg);
+                    cameraHandler->create_image_filename(filepath);
+                    if (cameraHandler->take_picture_and_save_to_sdcard(filepath.c_str()) != 0) {
+                        diagnosticsPoster->add_diagnostics_to_queue(
+                            "ESP: Failed to take picture and save to SD card", DiagnosticsStatus::ERROR);
+                        DEBUG("Failed to take picture and save to SD card");
+                        espPicoCommHandler->send_ACK_msg(false, picture.image_id);
+                        break;
+                    }
 
-                        cameraHandler->create_image_filename(filepath);
-                        if (cameraHandler->take_picture_and_save_to_sdcard(filepath.c_str()) != 0) {
-                            diagnosticsPoster->add_diagnostics_to_queue(
-                                "ESP: Failed to take picture and save to SD card", DiagnosticsStatus::ERROR);
-                            DEBUG("Failed to take picture and save to SD card");
-                            break;
-                        }
+                    // Confirm after taking image as the pico will unpower the motors after receiving an ack.
+                    espPicoCommHandler->send_ACK_msg(true, picture.image_id);
 
-                        // Confirm after taking image as the pico will unpower the motors after receiving an ack.
-                        espPicoCommHandler->send_ACK_msg(true);
+                    request.requestType = RequestType::POST_IMAGE;
+                    if (filepath.size() < BUFFER_SIZE) {
+                        strncpy(request.imageFilename, filepath.c_str(), filepath.size());
+                        request.imageFilename[filepath.size()] = '\0';
+                        DEBUG("Image filename: ", request.imageFilename);
+                    } else {
+                        DEBUG("Filename too long");
+                        break;
+                    }
 
-                        request.requestType = RequestType::POST_IMAGE;
-                        if (filepath.size() < BUFFER_SIZE) {
-                            strncpy(request.imageFilename, filepath.c_str(), filepath.size());
-                            request.imageFilename[filepath.size()] = '\0';
-                            DEBUG("Image filename: ", request.imageFilename);
-                        } else {
-                            DEBUG("Filename too long");
-                            break;
-                        }
+                    request.image_id = picture.image_id;
+                    DEBUG("Image ID: ", request.image_id);
 
-                        request.image_id = std::stoi(msg.content[0]);
-                        DEBUG("Image ID: ", request.image_id);
+                    if (enqueue_with_retry(handlers->requestHandler->getWebSrvRequestQueue(), &request, 0,
+                                           RETRIES) == false) {
+                        DEBUG("Failed to enqueue POST_IMAGE request");
+                    }
 
-                        if (enqueue_with_retry(handlers->requestHandler->getWebSrvRequestQueue(), &request, 0,
-                                               RETRIES) == false) {
-                            DEBUG("Failed to enqueue POST_IMAGE request");
-                        }
+                    request.buffer_length = 0;
+                    request.imageFilename[0] = '\0';
+                    filepath.clear();
+                    string.clear();
+                    break;
+                }
 
-                        request.buffer_length = 0;
-                        request.imageFilename[0] = '\0';
-                        filepath.clear();
-                        string.clear();
+                case msg::MessageType::DIAGNOSTICS: {
+                    msg::Diagnostics diagnostics;
+                    if (!msg::decode(record, diagnostics)) {
+                        espPicoCommHandler->send_ACK_msg(false);
                         break;
+                    }
+                    espPicoCommHandler->send_ACK_msg(true);
 
-                    case msg::MessageType::DIAGNOSTICS:
-                        espPicoCommHandler->send_ACK_msg(true);
+                    diagnosticsPoster->add_diagnostics_to_queue(std::string(diagnostics.text),
+                                                                static_cast<DiagnosticsStatus>(diagnostics.status));
+                    break;
+                }
 
-                        diagnosticsPoster->add_diagnostics_to_queue(
-                            msg.content[1], static_cast<DiagnosticsStatus>(std::stoi(msg.content[0].c_str())));
+                case msg::MessageType::WIFI: {
+                    msg::Wifi wifi;
+                    if (!msg::decode(record, wifi)) {
+                        espPicoCommHandler->send_ACK_msg(false);
                         break;
+                    }
+                    espPicoCommHandler->send_ACK_msg(true);
 
-                    case msg::MessageType::WIFI:
-                        espPicoCommHandler->send_ACK_msg(true);
+                    wirelessHandler->set_setting(wifi.ssid.data(), wifi.ssid.size(), Settings::WIFI_SSID);
+                    wirelessHandler->set_setting(wifi.password.data(), wifi.password.size(), Settings::WIFI_PASSWORD);
 
-                        wirelessHandler->set_setting(msg.content[0].c_str(), msg.content[0].size(),
-                                                     Settings::WIFI_SSID);
-                        wirelessHandler->set_setting(msg.content[1].c_str(), msg.content[1].size(),
-                                                     Settings::WIFI_PASSWORD);
+                    if (wirelessHandler->save_settings_to_sdcard(*wirelessHandler->get_all_settings_pointer()) !=
+                        0) {
+                        diagnosticsPoster->add_diagnostics_to_queue("ESP: Failed to save Wi-Fi settings to SD card",
+                                                                    DiagnosticsStatus::ERROR);
+                        DEBUG("Failed to save Wi-Fi settings to SD card");
+                    }
 
-                        if (wirelessHandler->save_settings_to_sdcard(*wirelessHandler->get_all_settings_pointer()) !=
-                            0) {
-                            diagnosticsPoster->add_diagnostics_to_queue("ESP: Failed to save Wi-Fi settings to SD card",
-                                                                        DiagnosticsStatus::ERROR);
-                            DEBUG("Failed to save Wi-Fi settings to SD card");
-                        }
+                    wirelessHandler->connect(wirelessHandler->get_setting(Settings::WIFI_SSID),
+                                             wirelessHandler->get_setting(Settings::WIFI_PASSWORD));
+                    break;
+                }
 
-                        wirelessHandler->connect(wirelessHandler->get_setting(Settings::WIFI_SSID),
-                                                 wirelessHandler->get_setting(Settings::WIFI_PASSWORD));
+                case msg::MessageType::SERVER: {
+                    msg::Server server;
+                    if (!msg::decode(record, server)) {
+                        espPicoCommHandler->send_ACK_msg(false);
                         break;
+                    }
+                    espPicoCommHandler->send_ACK_msg(true);
 
-                    case msg::MessageType::SERVER:
-                        espPicoCommHandler->send_ACK_msg(true);
+                    std::string port = std::to_string(server.port);
+                    wirelessHandler->set_setting(server.address.data(), server.address.size(), Settings::WEB_DOMAIN);
+                    wirelessHandler->set_setting(port.c_str(), port.size(), Settings::WEB_PORT);
 
-                        wirelessHandler->set_setting(msg.content[0].c_str(), msg.content[0].size(),
-                                                     Settings::WEB_DOMAIN);
-                        wirelessHandler->set_setting(msg.content[1].c_str(), msg.content[1].size(), Settings::WEB_PORT);
+                    if (wirelessHandler->save_settings_to_sdcard(*wirelessHandler->get_all_settings_pointer()) !=
+                        0) {
+                        diagnosticsPoster->add_diagnostics_to_queue(
+                            "ESP: Failed to save server settings to SD card", DiagnosticsStatus::ERROR);
+                        DEBUG("Failed to save server settings to SD card");
+                    }
 
-                        if (wirelessHandler->save_settings_to_sdcard(*wirelessHandler->get_all_settings_pointer()) !=
-                            0) {
-                            diagnosticsPoster->add_diagnostics_to_queue(
-                                "ESP: Failed to save server settings to SD card", DiagnosticsStatus::ERROR);
-                            DEBUG("Failed to save server settings to SD card");
-                        }
+                    requestHandler->updateUserInstructionsGETRequest();
+                    break;
+                }
 
-                        requestHandler->updateUserInstructionsGETRequest();
+                case msg::MessageType::API: {
+                    msg::Api api;
+                    if (!msg::decode(record, api)) {
+                        espPicoCommHandler->send_ACK_msg(false);
                         break;
+                    }
+                    espPicoCommHandler->send_ACK_msg(true);
 
-                    case msg::MessageType::API:
-                        espPicoCommHandler->send_ACK_msg(true);
-
-                        wirelessHandler->set_setting(msg.content[0].c_str(), msg.content[0].size(),
-                                                     Settings::WEB_TOKEN);
-
-                        if (wirelessHandler->save_settings_to_sdcard(*wirelessHandler->get_all_settings_pointer()) !=
-                            0) {
-                            diagnosticsPoster->add_diagnostics_to_queue("ESP: Failed to save API token to SD card",
-                                                                        DiagnosticsStatus::ERROR);
-                            DEBUG("Failed to save API token to SD card");
-                        }
-
-                        requestHandler->updateUserInstructionsGETRequest();
-                        break;
+                    wirelessHandler->set_setting(api.token.data(), api.token.size(), Settings::WEB_TOKEN);
 
-                    default:
-                        diagnosticsPoster->add_diagnostics_to_queue("ESP: Unknown message type received from Pico.",
+                    if (wirelessHandler->save_settings_to_sdcard(*wirelessHandler->get_all_settings_pointer()) !=
+                        0) {
+                        diagnosticsPoster->add_diagnostics_to_queue("ESP: Failed to save API token to SD card",
                                                                     DiagnosticsStatus::ERROR);
-                        DEBUG("Unknown message type received");
-                        break;
+                        DEBUG("Failed to save API token to SD card");
+                    }
+
+                    requestHandler->updateUserInstructionsGETRequest();
+                    break;
                 }
 
-            } else {
-                diagnosticsPoster->add_diagnostics_to_queue("ESP: Failed to convert UART data to message",
-                                                            DiagnosticsStatus::ERROR);
-                DEBUG("Failed to convert received data to message");
+                default:
+                    diagnosticsPoster->add_diagnostics_to_queue("ESP: Unknown message type received from Pico.",
+                                                                DiagnosticsStatus::ERROR);
+                    DEBUG("Unknown message type received");
+                    break;
             }
+
         }
     }
 }
@@ -0,0 +1,225 @@
+#include "test_link.hpp"
+
+#include <string>
+
+static msg::Record make_record(int image_id) {
+    msg::Record rec;
+    msg::to_record(msg::picture(image_id), rec);
+    return rec;
+}
+
+void test_link_sequenced_encoding() {
+    msg::Record rec = make_record(5);
+    rec.seq = 200;
+    char buffer[MSG_MAX_LENGTH];
+
+    size_t len = msg::encode(rec, buffer, sizeof(buffer));
+    TEST_ASSERT_TRUE(std::string(buffer, len).starts_with("$6:200,5,"));
+    msg::View view;
+    TEST_ASSERT_EQUAL_INT(0, msg::decode(std::string_view(buffer, len), view));
+    TEST_ASSERT_EQUAL_INT(200, view.seq);
+
+    len = msg::encode_binary(rec, buffer, sizeof(buffer));
+    msg::Record decoded;
+    TEST_ASSERT_EQUAL_INT(0, msg::decode_binary(std::string_view(buffer + 1, len - 2), decoded));
+    TEST_ASSERT_EQUAL_INT(200, decoded.seq);
+    TEST_ASSERT_EQUAL_INT(msg::PICTURE, decoded.type);
+
+    // Unsequenced messages are unchanged
+    len = msg::encode(make_record(5), buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_INT(0, msg::decode(std::string_view(buffer, len), view));
+    TEST_ASSERT_EQUAL_INT(-1, view.seq);
+}
+
+void test_link_in_order_delivery() {
+    msg::LinkSender sender;
+    msg::LinkReceiver receiver;
+
+    const msg::Record *first = sender.send(make_record(1), 0);
+    const msg::Record *second = sender.send(make_record(2), 0);
+    TEST_ASSERT_EQUAL_INT(0, first->seq);
+    TEST_ASSERT_EQUAL_INT(1, second->seq);
+
+    // Second frame arrives first and is held back
+    TEST_ASSERT_TRUE(receiver.accept(*second));
+    TEST_ASSERT_NULL(receiver.front());
+    TEST_ASSERT_EQUAL_INT(255, receiver.cumulative());
+    TEST_ASSERT_EQUAL_INT(0x01, receiver.sack());
+
+    TEST_ASSERT_TRUE(receiver.accept(*first));
+    TEST_ASSERT_FALSE(receiver.accept(*first)); // Duplicate
+    TEST_ASSERT_EQUAL_STRING("1", std::string(receiver.front()->field(0)).c_str());
+    receiver.pop();
+    TEST_ASSERT_EQUAL_STRING("2", std::string(receiver.front()->field(0)).c_str());
+    receiver.pop();
+    TEST_ASSERT_NULL(receiver.front());
+
+    TEST_ASSERT_EQUAL_INT(2, sender.on_ack(receiver.cumulative(), receiver.sack(), 10));
+    TEST_ASSERT_EQUAL_INT(0, sender.in_flight());
+    TEST_ASSERT_EQUAL_INT(msg::LinkSender::ACKED, sender.state(1));
+}
+
+void test_link_selective_ack() {
+    msg::LinkSender sender;
+    for (int i = 0; i < LINK_WINDOW_SIZE; ++i) {
+        TEST_ASSERT_NOT_NULL(sender.send(make_record(i), 0));
+    }
+    TEST_ASSERT_FALSE(sender.can_send());
+    TEST_ASSERT_NULL(sender.send(make_record(9), 0));
+
+    // Frame 1 was lost, the rest arrived
+    TEST_ASSERT_EQUAL_INT(3, sender.on_ack(0, 0x03, 50));
+    TEST_ASSERT_EQUAL_INT(msg::LinkSender::PENDING, sender.state(1));
+    TEST_ASSERT_EQUAL_INT(msg::LinkSender::ACKED, sender.state(3));
+
+    // The lost frame is resent right away instead of after the timeout
+    const msg::Record *resent = sender.poll(51);
+    TEST_ASSERT_NOT_NULL(resent);
+    TEST_ASSERT_EQUAL_INT(1, resent->seq);
+    TEST_ASSERT_NULL(sender.poll(52));
+
+    TEST_ASSERT_EQUAL_INT(1, sender.on_ack(3, 0, 60));
+    TEST_ASSERT_EQUAL_INT(0, sender.in_flight());
+    TEST_ASSERT_TRUE(sender.can_send());
+}
+
+void test_link_retransmit_timeout() {
+    msg::LinkSender sender;
+    sender.send(make_record(1), 0);
+
+    TEST_ASSERT_NULL(sender.poll(LINK_RTO_INITIAL_MS - 1));
+    TEST_ASSERT_NOT_NULL(sender.poll(LINK_RTO_INITIAL_MS));
+    TEST_ASSERT_EQUAL_INT(LINK_RTO_INITIAL_MS * 2, sender.rto()); // Backed off
+
+    uint32_t now = LINK_RTO_INITIAL_MS;
+    for (int i = 2; i < LINK_MAX_RETRIES; ++i) {
+        now += sender.rto();
+        TEST_ASSERT_NOT_NULL(sender.poll(now));
+    }
+    now += sender.rto();
+    TEST_ASSERT_NULL(sender.poll(now)); // Given up
+    TEST_ASSERT_EQUAL_INT(msg::LinkSender::FAILED, sender.state(0));
+    TEST_ASSERT_EQUAL_INT(1, sender.failures());
+    TEST_ASSERT_EQUAL_INT(0, sender.in_flight());
+}
+
+void test_link_rtt_estimate() {
+    msg::LinkSender sender;
+    uint32_t now = 0;
+    for (int i = 0; i < 20; ++i) {
+        sender.send(make_record(i), now);
+        now += 20;
+        sender.on_ack(i, 0, now);
+    }
+    TEST_ASSERT_EQUAL_INT(20, sender.srtt());
+    TEST_ASSERT_EQUAL_INT(LINK_RTO_MIN_MS, sender.rto());
+    TEST_ASSERT_EQUAL_INT(0, sender.retransmissions());
+}
+
+void test_link_receiver_skips_abandoned() {
+    msg::LinkReceiver receiver;
+    msg::Record rec = make_record(1);
+
+    // Frame 0 was given up by the sender, frame 1 is held back until a frame shows the window moved past 0
+    rec.seq = 1;
+    TEST_ASSERT_TRUE(receiver.accept(rec));
+    TEST_ASSERT_NULL(receiver.front());
+
+    rec = make_record(LINK_WINDOW_SIZE);
+    rec.seq = LINK_WINDOW_SIZE;
+    TEST_ASSERT_TRUE(receiver.accept(rec));
+    TEST_ASSERT_EQUAL_STRING("1", std::string(receiver.front()->field(0)).c_str());
+    receiver.pop();
+    TEST_ASSERT_EQUAL_INT(1, receiver.cumulative());
+
+    // Frames in between may still be retransmitted, a late copy of the abandoned frame is a duplicate
+    TEST_ASSERT_NULL(receiver.front());
+    rec.seq = 0;
+    TEST_ASSERT_FALSE(receiver.accept(rec));
+    rec = make_record(2);
+    rec.seq = 2;
+    TEST_ASSERT_TRUE(receiver.accept(rec));
+    TEST_ASSERT_EQUAL_STRING("2", std::string(receiver.front()->field(0)).c_str());
+}
+
+void test_lane_scheduler() {
+    TEST_ASSERT_EQUAL_INT(msg::LANE_CONTROL, msg::lane_of(msg::PICTURE));
+    TEST_ASSERT_EQUAL_INT(msg::LANE_COMMAND, msg::lane_of(msg::CMD_STATUS));
+    TEST_ASSERT_EQUAL_INT(msg::LANE_BULK, msg::lane_of(msg::DIAGNOSTICS));
+
+    msg::LaneScheduler scheduler;
+    bool waiting[msg::LANE_COUNT] = {true, true, true};
+    // The control lane always goes first
+    for (int i = 0; i < 10; ++i) {
+        TEST_ASSERT_EQUAL_INT(msg::LANE_CONTROL, scheduler.select(waiting));
+        scheduler.taken(msg::LANE_CONTROL);
+    }
+
+    // Below it the command and bulk lanes share the link by weight
+    waiting[msg::LANE_CONTROL] = false;
+    int taken[msg::LANE_COUNT] = {0};
+    for (int i = 0; i < 5 * (LANE_COMMAND_WEIGHT + LANE_BULK_WEIGHT); ++i) {
+        int lane = scheduler.select(waiting);
+        scheduler.taken(lane);
+        taken[lane]++;
+    }
+    TEST_ASSERT_EQUAL_INT(5 * LANE_COMMAND_WEIGHT, taken[msg::LANE_COMMAND]);
+    TEST_ASSERT_EQUAL_INT(5 * LANE_BULK_WEIGHT, taken[msg::LANE_BULK]);
+
+    // A lane on its own isn't held back by its weight
+    waiting[msg::LANE_COMMAND] = false;
+    for (int i = 0; i < 3; ++i) {
+        TEST_ASSERT_EQUAL_INT(msg::LANE_BULK, scheduler.select(waiting));
+        scheduler.taken(msg::LANE_BULK);
+    }
+    waiting[msg::LANE_BULK] = false;
+    TEST_ASSERT_EQUAL_INT(-1, scheduler.select(waiting));
+}
+
+void test_link_stats() {
+    msg::LinkStats stats;
+    msg::LinkSender sender;
+    sender.set_stats(&stats);
+
+    msg::Record rec;
+    TEST_ASSERT_TRUE(msg::to_record(msg::picture(7), rec));
+    sender.send(rec, 0);
+    sender.send(rec, 0);
+    TEST_ASSERT_NOT_NULL(sender.poll(LINK_RTO_INITIAL_MS)); // First frame times out and is sent again
+    sender.on_ack(1, 0, LINK_RTO_INITIAL_MS + 40);
+
+    // Only the frame that was sent once gives an RTT sample
+    TEST_ASSERT_EQUAL_UINT32(1, stats.get(msg::LinkStats::RETRANSMITTED, msg::PICTURE));
+    TEST_ASSERT_EQUAL_UINT32(1, stats.rtt_samples());
+    TEST_ASSERT_EQUAL_UINT32(LINK_RTO_INITIAL_MS + 40, stats.rtt_max());
+
+    stats.rtt(20);
+    TEST_ASSERT_EQUAL_UINT32(20, stats.rtt_min());
+    TEST_ASSERT_EQUAL_UINT32((LINK_RTO_INITIAL_MS + 60) / 2, stats.rtt_avg());
+
+    stats.count(msg::LinkStats::SENT, msg::CMD_STATUS);
+    stats.count(msg::LinkStats::SENT, msg::DIAGNOSTICS);
+    stats.count(msg::LinkStats::CRC_FAILED, static_cast<msg::MessageType>(42)); // Out of range counts as unknown
+    TEST_ASSERT_EQUAL_UINT32(2, stats.total(msg::LinkStats::SENT));
+    TEST_ASSERT_EQUAL_UINT32(1, stats.get(msg::LinkStats::CRC_FAILED, msg::UNASSIGNED));
+
+    stats.level(msg::LinkStats::RX_QUEUE, 3);
+    stats.level(msg::LinkStats::RX_QUEUE, 1);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.high_water(msg::LinkStats::RX_QUEUE));
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, stats.summary().find(" 5:1/0/0/0/0"));
+
+    stats.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, stats.total(msg::LinkStats::SENT));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.rtt_samples());
+}
+
+void run_all_link_tests() {
+    RUN_TEST(test_link_sequenced_encoding);
+    RUN_TEST(test_link_in_order_delivery);
+    RUN_TEST(test_link_selective_ack);
+    RUN_TEST(test_link_retransmit_timeout);
+    RUN_TEST(test_link_rtt_estimate);
+    RUN_TEST(test_link_receiver_skips_abandoned);
+    RUN_TEST(test_lane_scheduler);
+    RUN_TEST(test_link_stats);
+}
@@ -0,0 +1,282 @@
+#include "test_message.hpp"
+
+#include "schema.hpp"
+
+void test_encode_message() {
+    char buffer[MSG_MAX_LENGTH];
+    size_t len = msg::encode(msg::cmd_status(12, 2, 1700000000), buffer, sizeof(buffer));
+    std::string expected = "$5,12,2,1700000000";
+    std::string crc;
+    num_to_hex_str(crc16(expected), crc, 4, true, true);
+    expected += "," + crc + ";";
+
+    TEST_ASSERT_EQUAL_INT(expected.size(), len);
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), buffer);
+}
+
+void test_encode_buffer_too_small() {
+    char buffer[8];
+    TEST_ASSERT_EQUAL_INT(0, msg::encode(msg::cmd_status(12, 2, 1700000000), buffer, sizeof(buffer)));
+}
+
+void test_decode_message() {
+    std::string str;
+    convert_to_string(msg::instructions(2, 34, 1), str);
+
+    msg::View view;
+    TEST_ASSERT_EQUAL_INT(0, msg::decode(str, view));
+    TEST_ASSERT_EQUAL_INT(msg::INSTRUCTIONS, view.type);
+    TEST_ASSERT_EQUAL_INT(3, view.count);
+    int id = 0;
+    TEST_ASSERT_TRUE(view.field_to_int(1, id));
+    TEST_ASSERT_EQUAL_INT(34, id);
+    // Fields point into the decoded string
+    TEST_ASSERT_TRUE(view.field(0).data() >= str.data() && view.field(0).data() < str.data() + str.size());
+}
+
+void test_decode_invalid_crc() {
+    msg::View view;
+    TEST_ASSERT_EQUAL_INT(2, msg::decode("$1,1,0000;", view));
+    TEST_ASSERT_EQUAL_INT(1, msg::decode("$1;", view));
+}
+
+void test_decode_invalid_type() {
+    char buffer[MSG_MAX_LENGTH];
+    std::string_view fields[] = {"1"};
+    size_t len = msg::encode(static_cast<msg::MessageType>(42), fields, 1, buffer, sizeof(buffer));
+
+    msg::View view;
+    TEST_ASSERT_EQUAL_INT(7, msg::decode(std::string_view(buffer, len), view));
+    TEST_ASSERT_EQUAL_INT(msg::UNASSIGNED, view.type);
+}
+
+void test_decode_too_many_fields() {
+    char buffer[MSG_MAX_LENGTH];
+    std::string_view fields[] = {"1", "2", "3", "4", "5"};
+    size_t len = msg::encode(msg::DIAGNOSTICS, fields, 5, buffer, sizeof(buffer));
+
+    msg::View view;
+    TEST_ASSERT_EQUAL_INT(8, msg::decode(std::string_view(buffer, len), view));
+}
+
+void test_convert_round_trip() {
+    std::string str;
+    convert_to_string(msg::wifi("ssid", "password"), str);
+
+    msg::Message msg;
+    TEST_ASSERT_EQUAL_INT(0, msg::convert_to_message(str, msg));
+    TEST_ASSERT_EQUAL_INT(msg::WIFI, msg.type);
+    TEST_ASSERT_EQUAL_INT(2, msg.content.size());
+    TEST_ASSERT_EQUAL_STRING("ssid", msg.content[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("password", msg.content[1].c_str());
+    TEST_ASSERT_TRUE(str.empty());
+}
+
+void test_crc_variants() {
+    std::string data = "123456789";
+    TEST_ASSERT_EQUAL_UINT16(0x4B37, crc16_bitwise(data));
+    TEST_ASSERT_EQUAL_UINT16(0x4B37, crc16_table(data));
+    TEST_ASSERT_EQUAL_UINT16(0x4B37, crc16_slice4(data));
+    TEST_ASSERT_EQUAL_UINT16(0x4B37, crc16(data));
+}
+
+void test_frame_crc() {
+    std::string str;
+    convert_to_string(msg::cmd_status(7, 2, 1700000000), str);
+
+    msg::FrameCrc crc;
+    for (char c : str) {
+        if (c == ';') break;
+        crc.update(c);
+    }
+    TEST_ASSERT_EQUAL_UINT16(crc16(str.substr(0, str.find_last_of(','))), crc.payload_crc());
+
+    msg::View view;
+    TEST_ASSERT_EQUAL_INT(0, msg::decode(str, view, crc.payload_crc()));
+    TEST_ASSERT_EQUAL_INT(2, msg::decode(str, view, crc.payload_crc() ^ 1));
+}
+
+void test_cobs_round_trip() {
+    uint8_t data[300];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = i % 7 == 0 ? 0 : i; // Zeros and a run longer than 254 non-zero bytes
+    }
+    uint8_t encoded[cobs_max_encoded_length(sizeof(data))];
+    uint8_t decoded[sizeof(data)];
+
+    size_t len = cobs_encode(data, sizeof(data), encoded, sizeof(encoded));
+    TEST_ASSERT_TRUE(len > sizeof(data));
+    for (size_t i = 0; i < len; ++i) {
+        TEST_ASSERT_NOT_EQUAL(0, encoded[i]);
+    }
+    TEST_ASSERT_EQUAL_INT(sizeof(data), cobs_decode(encoded, len, decoded, sizeof(decoded)));
+    TEST_ASSERT_EQUAL_MEMORY(data, decoded, sizeof(data));
+}
+
+void test_binary_round_trip() {
+    char buffer[MSG_MAX_LENGTH];
+    char ascii[MSG_MAX_LENGTH];
+    size_t len = msg::encode_binary(msg::cmd_status(12, -2, 1700000000), buffer, sizeof(buffer));
+    TEST_ASSERT_TRUE(len > 0);
+    TEST_ASSERT_TRUE(len < msg::encode(msg::cmd_status(12, -2, 1700000000), ascii, sizeof(ascii)));
+    TEST_ASSERT_EQUAL_INT(MSG_BINARY_DELIMITER, buffer[0]);
+    TEST_ASSERT_EQUAL_INT(MSG_BINARY_DELIMITER, buffer[len - 1]);
+
+    msg::Record rec;
+    TEST_ASSERT_EQUAL_INT(0, msg::decode_binary(std::string_view(buffer + 1, len - 2), rec));
+    TEST_ASSERT_EQUAL_INT(msg::CMD_STATUS, rec.type);
+    TEST_ASSERT_EQUAL_INT(3, rec.count);
+    TEST_ASSERT_EQUAL_STRING("12", std::string(rec.field(0)).c_str());
+    TEST_ASSERT_EQUAL_STRING("-2", std::string(rec.field(1)).c_str());
+    TEST_ASSERT_EQUAL_STRING("1700000000", std::string(rec.field(2)).c_str());
+
+    len = msg::encode_binary(msg::wifi("ssid", "pass,word;"), buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_INT(0, msg::decode_binary(std::string_view(buffer + 1, len - 2), rec));
+    TEST_ASSERT_EQUAL_INT(msg::WIFI, rec.type);
+    TEST_ASSERT_EQUAL_STRING("pass,word;", std::string(rec.field(1)).c_str());
+}
+
+void test_binary_invalid_frame() {
+    char buffer[MSG_MAX_LENGTH];
+    // Fields that don't fit the binary representation
+    TEST_ASSERT_EQUAL_INT(0, msg::encode_binary(msg::instructions("moon", "1", "1"), buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_INT(0, msg::encode_binary(msg::response(true), buffer, 4));
+
+    size_t len = msg::encode_binary(msg::picture(5), buffer, sizeof(buffer));
+    msg::Record rec;
+    buffer[2] ^= 0x01; // Corrupt the first content byte
+    TEST_ASSERT_EQUAL_INT(2, msg::decode_binary(std::string_view(buffer + 1, len - 2), rec));
+}
+
+void test_frame_parser() {
+    char binary[MSG_MAX_LENGTH];
+    size_t binary_len = msg::encode_binary(msg::picture(9), binary, sizeof(binary));
+    std::string stream;
+    convert_to_string(msg::cmd_status(7, 2, 1700000000), stream);
+    stream.insert(0, "noise");
+    stream.append(binary, binary_len);
+    stream += "$partial";
+    stream.append(binary, binary_len); // The delimiter abandons the partial ASCII message
+
+    msg::FrameParser framer;
+    int ascii_count = 0;
+    int binary_count = 0;
+    for (char c : stream) {
+        msg::View view;
+        msg::Record rec;
+        switch (framer.feed(c)) {
+            case msg::FrameParser::ASCII:
+                TEST_ASSERT_EQUAL_INT(0, msg::decode(framer.frame(), view, framer.payload_crc()));
+                TEST_ASSERT_EQUAL_INT(msg::CMD_STATUS, view.type);
+                ++ascii_count;
+                break;
+            case msg::FrameParser::BINARY:
+                TEST_ASSERT_EQUAL_INT(0, msg::decode_binary(framer.frame(), rec));
+                TEST_ASSERT_EQUAL_INT(msg::PICTURE, rec.type);
+                ++binary_count;
+                break;
+            case msg::FrameParser::NONE:
+                break;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(1, ascii_count);
+    TEST_ASSERT_EQUAL_INT(2, binary_count);
+
+    // A message longer than the buffer is dropped without producing a frame
+    framer.feed('$');
+    for (int i = 0; i < MSG_MAX_LENGTH + 10; ++i) {
+        TEST_ASSERT_EQUAL_INT(msg::FrameParser::NONE, framer.feed('1'));
+    }
+    TEST_ASSERT_EQUAL_INT(msg::FrameParser::NONE, framer.feed(';'));
+}
+
+void test_schema_typed_round_trip() {
+    msg::Record rec;
+    TEST_ASSERT_TRUE(msg::to_record(msg::CmdStatus{12, -2, 1700000000}, rec));
+    char buffer[MSG_MAX_LENGTH];
+    char expected[MSG_MAX_LENGTH];
+    size_t len = msg::encode(rec, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_INT(msg::encode(msg::cmd_status(12, -2, 1700000000), expected, sizeof(expected)), len);
+    TEST_ASSERT_EQUAL_STRING(expected, buffer);
+
+    msg::CmdStatus status;
+    TEST_ASSERT_TRUE(msg::decode(rec, status));
+    TEST_ASSERT_EQUAL_INT(12, status.image_id);
+    TEST_ASSERT_EQUAL_INT(-2, status.status);
+    TEST_ASSERT_EQUAL_INT(1700000000, status.time);
+
+    // Optional trailing fields are omitted when empty
+    TEST_ASSERT_TRUE(msg::to_record(msg::DeviceStatus{true, std::nullopt}, rec));
+    TEST_ASSERT_EQUAL_INT(1, rec.count);
+    msg::DeviceStatus device;
+    TEST_ASSERT_TRUE(msg::decode(rec, device));
+    TEST_ASSERT_FALSE(device.capabilities.has_value());
+
+    // Only the RESPONSE to a PICTURE carries the image id
+    msg::Response response;
+    TEST_ASSERT_TRUE(msg::to_record(msg::Response{false, 42}, rec));
+    TEST_ASSERT_TRUE(msg::decode(rec, response));
+    TEST_ASSERT_FALSE(response.ack);
+    TEST_ASSERT_TRUE(response.image_id == 42);
+    msg::to_record(msg::response(true), rec);
+    TEST_ASSERT_TRUE(msg::decode(rec, response));
+    TEST_ASSERT_TRUE(response.ack);
+    TEST_ASSERT_FALSE(response.image_id.has_value());
+
+    msg::to_record(msg::diagnostics(3, "Motor stalled"), rec);
+    msg::Diagnostics diagnostics;
+    TEST_ASSERT_TRUE(msg::decode(rec, diagnostics));
+    TEST_ASSERT_EQUAL_INT(3, diagnostics.status);
+    TEST_ASSERT_EQUAL_STRING("Motor stalled", std::string(diagnostics.text).c_str());
+
+    // The wrong type is rejected
+    msg::Picture picture;
+    TEST_ASSERT_FALSE(msg::decode(rec, picture));
+}
+
+void test_schema_rejects_invalid() {
+    msg::Record rec;
+    msg::Instructions instructions{2, 34, 1};
+    msg::to_record(msg::instructions(10, 34, 1), rec); // Object out of range
+    TEST_ASSERT_FALSE(msg::decode(rec, instructions));
+    TEST_ASSERT_EQUAL_INT(2, instructions.object); // Left untouched
+    msg::to_record(msg::instructions("moon", "34", "1"), rec);
+    TEST_ASSERT_FALSE(msg::decode(rec, instructions));
+    msg::to_record(msg::cmd_status(1, 2, 3), rec);
+    rec.count = 2; // Missing required field
+    msg::CmdStatus status;
+    TEST_ASSERT_FALSE(msg::decode(rec, status));
+
+    // Malformed messages are rejected by both decoders
+    std::string str;
+    convert_to_string(msg::instructions(2, 34, 7), str);
+    msg::View view;
+    TEST_ASSERT_EQUAL_INT(11, msg::decode(str, view));
+    TEST_ASSERT_EQUAL_INT(msg::UNASSIGNED, view.type);
+    convert_to_string(msg::Message{msg::CMD_STATUS, {"1", "2"}}, str);
+    TEST_ASSERT_EQUAL_INT(11, msg::decode(str, view));
+
+    char buffer[MSG_MAX_LENGTH];
+    size_t len = msg::encode_binary(msg::diagnostics(9, "status out of range"), buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_INT(11, msg::decode_binary(std::string_view(buffer + 1, len - 2), rec));
+    len = msg::encode_binary(msg::Message{msg::WIFI, {"ssid"}}, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_INT(11, msg::decode_binary(std::string_view(buffer + 1, len - 2), rec));
+}
+
+void run_all_message_tests() {
+    RUN_TEST(test_encode_message);
+    RUN_TEST(test_encode_buffer_too_small);
+    RUN_TEST(test_decode_message);
+    RUN_TEST(test_decode_invalid_crc);
+    RUN_TEST(test_decode_invalid_type);
+    RUN_TEST(test_decode_too_many_fields);
+    RUN_TEST(test_convert_round_trip);
+    RUN_TEST(test_crc_variants);
+    RUN_TEST(test_frame_crc);
+    RUN_TEST(test_cobs_round_trip);
+    RUN_TEST(test_binary_round_trip);
+    RUN_TEST(test_binary_invalid_frame);
+    RUN_TEST(test_frame_parser);
+    RUN_TEST(test_schema_typed_round_trip);
+    RUN_TEST(test_schema_rejects_invalid);
+}
@@ -1,16 +1,22 @@
 #include "camera.hpp"
 #include "test_jsonParser.hpp"
+#include "test_link.hpp"
+#include "test_message.hpp"
 #include "test_sd-card.hpp"
 #include "test_requestHandler.hpp"
 #include "unity.h"
 
 // #define JSON_PARSER_TESTS
+// #define LINK_TESTS
+// #define MESSAGE_TESTS
 // #define SDCARD_TESTS
 #define REQUESTHANDLER_TESTS
 // #define ALL_TESTS
 
 #ifdef ALL_TESTS
 #define JSON_PARSER_TESTS
+#define LINK_TESTS
+#define MESSAGE_TESTS
 #define SDCARD_TESTS
 #define REQUESTHANDLER_TESTS
 #endif // ALL_TESTS
@@ -27,6 +33,14 @@ void app_main(void) {
     run_all_json_tests();
 #endif // JSON_PARSER_TESTS
 
+#ifdef LINK_TESTS
+    run_all_link_tests();
+#endif // LINK_TESTS
+
+#ifdef MESSAGE_TESTS
+    run_all_message_tests();
+#endif // MESSAGE_TESTS
+
 #ifdef SDCARD_TESTS
     run_all_sd_card_tests();
 #endif // SDCARD_TESTS
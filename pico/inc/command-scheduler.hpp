@@ -0,0 +1,41 @@
+#pragma once
+
+#include "structs.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#define SCHEDULER_CAPACITY 32
+
+/**
+ * @struct ScheduledCommand
+ * @brief A command together with its execution time in seconds since the Unix epoch.
+ */
+struct ScheduledCommand {
+    int64_t epoch;
+    uint32_t sequence; // Insertion order, keeps commands with the same time in FIFO order
+    Command command;
+};
+
+/**
+ * @class CommandScheduler
+ * @brief Fixed-capacity min-heap of commands keyed by execution time.
+ * @details Insert and pop are O(log n). The execution time is converted to epoch seconds once on insertion so
+ * ordering never needs to compare datetime fields.
+ */
+class CommandScheduler {
+  public:
+    bool insert(const Command &command);
+    bool insert(const Command &command, int64_t epoch);
+    const ScheduledCommand &top() const;
+    Command pop();
+    bool pop_expired(int64_t oldest_allowed, Command &expired);
+    bool empty() const;
+    size_t size() const;
+
+  private:
+    std::array<ScheduledCommand, SCHEDULER_CAPACITY> heap;
+    size_t count = 0;
+    uint32_t next_sequence = 0;
+};
@@ -4,33 +4,61 @@
 #include "pico/time.h"
 
 #include "PicoUart.hpp"
+#include "link.hpp"
 #include "message.hpp"
+#include "spsc-queue.hpp"
 
 #include <memory>
-#include <queue>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
-#define RBUFFER_SIZE 64
-#define RWAIT_MS     20
+#define RECEIVE_QUEUE_SIZE    8
+#define UART_WRITE_TIMEOUT_MS 100 // Longest wait for the UART pending slot, a full buffer drains in ~45 ms at 115200
+
+using MessageQueue = SpscQueue<msg::Record, RECEIVE_QUEUE_SIZE>;
 
 /**
  * @brief Handles communication between the Raspberry Pi Pico and the ESP32.
  */
 class CommBridge {
   public:
-    CommBridge(std::shared_ptr<PicoUart> uart, std::shared_ptr<std::queue<msg::Message>> queue);
-    int read(std::string &str);
+    CommBridge(std::shared_ptr<PicoUart> uart, std::shared_ptr<MessageQueue> queue);
     void send(const msg::Message &msg);
-    void send(const std::string &str);
-    int parse(std::string &str);
+    void send(const msg::Record &rec);
+    bool send(std::string_view str);
+    int parse(std::span<const uint8_t> data);
     int read_and_parse(const uint16_t timeout_ms = 5000, bool reset_on_activity = true);
     bool ready_to_send();
+    bool can_send() const;
+    void set_peer_capabilities(int capabilities);
+    void allow_binary(bool allow);
+    int capabilities() const;
+    bool binary_framing() const;
+    bool sequencing() const;
+    const msg::LinkStats &stats() const;
 
   private:
+    void write(const msg::Record &rec);
+    int push_binary(std::string_view frame);
+    int deliver(const msg::Record &rec);
+    int release();
+    void service_link();
+    void on_response(const msg::Record &rec);
+
     absolute_time_t last_sent_time = 0;
 
     std::shared_ptr<PicoUart> uart;
-    std::shared_ptr<std::queue<msg::Message>> queue;
-    std::string string_buffer = "";
+    std::shared_ptr<MessageQueue> queue;
+    msg::FrameParser framer;
+    bool binary_allowed = true;
+    uint32_t rx_overflows = 0; // UART overflow count at the last read
+    int peer_capabilities = msg::CAP_NONE;
+    msg::LinkSender link_tx;
+    msg::LinkReceiver link_rx;
+    bool ack_pending = false; // A sequenced message arrived since the last LINK_ACK
+    msg::LinkStats link_stats;
+    msg::MessageType awaiting = msg::UNASSIGNED; // Last unsequenced message sent that the ESP answers with a RESPONSE
+    uint32_t awaiting_since_ms = 0;
 };
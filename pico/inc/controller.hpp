@@ -3,22 +3,40 @@
 #include <memory>
 
 #include "clock.hpp"
+#include "command-scheduler.hpp"
 #include "commbridge.hpp"
 #include "compass.hpp"
 #include "convert.hpp"
+#include "diagnostics-aggregator.hpp"
 #include "gps.hpp"
+#include "lane-queue.hpp"
+#include "line-editor.hpp"
 #include "motor-control.hpp"
 #include "planet_finder.hpp"
 #include "stepper-motor.hpp"
 #include "storage.hpp"
 #include "structs.hpp"
+#include "trace-recorder.hpp"
+#include "usb-link.hpp"
 
 // #define GPS_COORDS
 
+#define INSTRUCTION_QUEUE_SIZE 8
+#define SEND_LANE_SIZE         8 // Per traffic lane, see lanes.hpp
+
+#define ESP_SETTLE_TIME_S          10 // ESP waits this long after a PICTURE message before taking the picture
+#define PICTURE_RESPONSE_TIMEOUT_S 40 // The picture is given up if the ESP doesn't answer the PICTURE in this time
+
+#define GPS_REFIX_PERIOD_S  21600   // Background fix to confirm the stored position every 6 hours
+#define GPS_REFIX_TIMEOUT_S 120     // The GPS goes back to standby if the background fix takes longer
+#define GPS_FIX_MOVED_M     100     // A fix this far from the stored one replaces it
+#define GPS_FIX_MAX_AGE_S   2592000 // The stored fix is rewritten after 30 days to refresh its timestamp
+
 /**
  * @class Controller
  * @brief Main class for the Pico.
- * @details Handles the main control flow of the Pico.
+ * @details Handles the main control flow of the Pico. Its buffers are kept inline, so the Controller takes several
+ * kilobytes and must have static storage, it doesn't fit in the main stack.
  */
 class Controller {
   public:
@@ -40,30 +58,57 @@ class Controller {
         TRACE,
     };
 
+    /**
+     * @enum ShellState
+     * @brief Enumeration of config shell states.
+     */
+    enum ShellState {
+        SHELL_OFF,
+        SHELL_COMMAND,
+        SHELL_PASSWORD,
+        SHELL_WAIT_RESPONSE,
+        SHELL_CALIBRATE_COMPASS,
+    };
+
   public:
     Controller(std::shared_ptr<Clock> clock, std::shared_ptr<GPS> gps, std::shared_ptr<Compass> compass,
                std::shared_ptr<CommBridge> commbridge, std::shared_ptr<MotorControl> motor_controller,
-               std::shared_ptr<Storage> storage, std::shared_ptr<std::queue<msg::Message>> msg_queue);
+               std::shared_ptr<Storage> storage, std::shared_ptr<MessageQueue> msg_queue,
+               std::shared_ptr<UsbLink> usb = nullptr);
 
     void run();
 
   private:
     bool init();
     void comm_process();
+    void usb_process();
+    void gps_process();
+    void load_fix();
+    void save_fix();
     void instr_process();
-    void config_mode();
-    int input(std::string &input, uint32_t timeout, bool hidden = false);
+    void config_poll();
+    void config_enter();
+    void config_exit();
+    void config_prompt();
+    void config_command(const std::string &line);
+    void config_wait_for_response();
+    void config_response(const msg::Record &msg);
     void wait_for_event(absolute_time_t abs_time, int max_sleep_time);
-    bool input_detected();
     void trace();
-    bool config_wait_for_response();
     void motor_control();
     void send(const msg::Message mesg);
+    void report(uint8_t status, std::string_view text);
+    void transmit(const msg::Message &mesg);
+    void transmit(const msg::Record &rec);
     void send_process();
     void sanitize_commands();
+    int64_t capture_lead(const Command &command) const;
+    void aim_for_shutter(int64_t now);
 
   private:
     State state = COMM_READ;
+    State traced_state = COMM_READ;
+    ShellState shell_state = SHELL_OFF;
     msg::MessageType last_sent = msg::UNASSIGNED;
     Command current_command = {0};
     Command trace_command = {0};
@@ -73,17 +118,37 @@ class Controller {
     bool check_motor = false;
     bool waiting_for_camera = false;
     bool trace_started = false;
-    bool input_received = false;
     bool waiting_for_response = false;
     bool esp_initialized = false;
     bool commands_fetched = false;
     bool trace_pause = true;
+    bool command_triggered = false;
+    bool waiting_for_shutter = false;
+    bool picture_pending = false; // PICTURE sent and its RESPONSE not received yet
     uint64_t trace_time = 0;
+    uint64_t shell_activity = 0;
+    uint64_t shell_wait_start = 0;
     int now_commands = 0;
+    int64_t armed_epoch = -1;
+    int64_t target_epoch = 0;  // Requested capture time of current_command
+    int64_t shutter_epoch = 0; // Planned capture time of current_command
+    int64_t picture_epoch = 0; // Time the PICTURE message was sent
+    int32_t picture_id = 0;    // Image id of the pending PICTURE
+    GpsFix stored_fix = {0};
+    bool fix_loaded = false;      // Stored fix was looked up
+    bool fix_stored = false;      // stored_fix holds the fix in EEPROM
+    bool refixing = false;        // Background fix in progress
+    uint32_t seen_fixes = 0;      // GPS fix count when the fix was last saved
+    uint64_t refix_at_us = GPS_REFIX_PERIOD_S * 1000000ull;
+    uint64_t refix_started_us = 0;
 
-    std::queue<msg::Message> instr_msg_queue;
-    std::queue<msg::Message> send_msg_queue;
-    std::vector<Command> commands;
+    SpscQueue<msg::Record, INSTRUCTION_QUEUE_SIZE> instr_msg_queue;
+    LaneQueue<msg::Record, SEND_LANE_SIZE> send_msg_queue;
+    CommandScheduler commands;
+    DiagnosticsAggregator diagnostics;
+    TraceRecorder tracer;
+    LineEditor console;
+    std::string wifi_ssid;
 
     std::shared_ptr<Clock> clock;
     std::shared_ptr<GPS> gps;
@@ -91,5 +156,6 @@ class Controller {
     std::shared_ptr<CommBridge> commbridge;
     std::shared_ptr<MotorControl> mctrl;
     std::shared_ptr<Storage> storage;
-    std::shared_ptr<std::queue<msg::Message>> msg_queue;
+    std::shared_ptr<MessageQueue> msg_queue;
+    std::shared_ptr<UsbLink> usb;
 };
@@ -4,33 +4,75 @@
 #include "pico/stdlib.h"
 #include <cmath>
 #include <cstdint>
+#include <memory>
 
 #include "debug.hpp"
+#include "ellipsoid-fit.hpp"
+#include "storage.hpp"
+#include "structs.hpp"
 
-struct CalibrationMaxValue {
-    float X;
-    float Y;
-    float Z;
-};
+#define COMPASS_SAMPLE_PERIOD_MS 67 // Output rate of the sensor in continuous mode is 15 Hz
+#define COMPASS_SAMPLES          8  // Samples averaged by getHeading(), about half a second
 
-struct CalibrationMinValue {
-    float X;
-    float Y;
-    float Z;
-};
+#define COMPASS_CALIBRATION_SAMPLES   240 // Samples collected for the ellipsoid fit
+#define COMPASS_CALIBRATION_SPACING   15  // Raw distance between collected samples, keeps them spread over the shell
+#define COMPASS_CALIBRATION_TIMEOUT_S 120 // Calibration gives up if the compass isn't rotated enough in this time
 
+/**
+ * @class Compass
+ * @brief Driver for the HMC5883L magnetometer.
+ * @details The sensor runs in continuous-measurement mode and a repeating timer reads each measurement into a ring
+ * of the last COMPASS_SAMPLES samples, so reading the compass never waits for the I2C bus. Samples are corrected for
+ * hard- and soft-iron distortion with a calibration from an ellipsoid fit, which is kept in EEPROM.
+ */
 class Compass {
   public:
-    Compass(i2c_inst_t *I2C_PORT, uint SCL_PIN, uint SDA_PIN);
-    void readRawData(int16_t &x, int16_t &y, int16_t &z);
-    void calibrate();
+    /**
+     * @enum CalibrationStatus
+     * @brief Progress of a calibration started with startCalibration().
+     */
+    enum class CalibrationStatus {
+        IDLE,    // No calibration in progress
+        RUNNING, // Still collecting samples
+        DONE,    // Calibrated and stored
+        FAILED,  // Timed out or the fit failed, the previous calibration is kept
+    };
+
+    Compass(i2c_inst_t *I2C_PORT, uint SCL_PIN, uint SDA_PIN, std::shared_ptr<Storage> storage = nullptr);
+    Compass(const Compass &) = delete; // The sampling timer points to the object
+    ~Compass();
+    bool readRawData(int16_t &x, int16_t &y, int16_t &z);
+    void startCalibration();
+    CalibrationStatus pollCalibration();
+    void cancelCalibration();
+    bool isCalibrated() const;
     float getHeading();
 
+  private:
+    static bool sampleCallback(repeating_timer_t *timer);
+    int copySamples(CompassSample *out);
+    void collectCalibrationSample(int16_t x, int16_t y, int16_t z);
+    bool rotatedEnough() const;
+
   private:
     i2c_inst_t *I2C_PORT;
     uint SCL_PIN;
     uint SDA_PIN;
-    float xRawValueOffset;
-    float yRawValueOffset;
-    float zRawValueOffset;
+    std::shared_ptr<Storage> storage;
+    CompassCalibration calibration;
+    bool calibrated = false;
+
+    CompassSample calibrationPoints[COMPASS_CALIBRATION_SAMPLES];
+    int calibrationCount = 0;         // Samples in calibrationPoints
+    int axisCrossings[3] = {};        // Times each axis swung past zero during the calibration
+    bool nearZero[3] = {};            // Each axis is close to zero
+    bool calibrating = false;
+    uint64_t calibrationStart = 0;    // time_us_64() when the calibration started
+    uint64_t lastCalibrationPoll = 0; // time_us_64() of the last sample taken for the calibration
+
+    repeating_timer_t timer;
+    CompassSample samples[COMPASS_SAMPLES]; // Written by the timer callback
+    volatile uint8_t sampleHead = 0;        // Index of the next sample to write
+    volatile uint8_t sampleCount = 0;       // Valid samples in the ring
+    volatile uint32_t readErrors = 0;       // Failed or saturated reads
 };
@@ -14,11 +14,17 @@ class Storage {
     int get_all_commands(std::vector<Command> &vector);
     bool delete_command(uint64_t id);
     void clear_eeprom();
+    bool store_fix(const GpsFix &fix);
+    bool load_fix(GpsFix &fix);
+    bool store_calibration(const CompassCalibration &calibration);
+    bool load_calibration(CompassCalibration &calibration);
 
   private:
     bool write(Command &command, uint addr);
     bool read(Command &command, uint addr);
     bool write_page(uint16_t address, const uint8_t *data, size_t size);
+    bool write_record(uint16_t addr, const uint8_t *data, size_t size);
+    bool read_record(uint16_t addr, uint8_t *data, size_t size);
     i2c_inst_t *i2c;
     //    uint16_t head = 0xFFFF;
     //    uint16_t tail = 0xFFFF;
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "structs.hpp"
+
+bool fit_ellipsoid(const CompassSample *points, int count, CompassCalibration &result);
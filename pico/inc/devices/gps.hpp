@@ -3,13 +3,13 @@
 #include "hardware/timer.h"
 #include "pico/stdlib.h"
 
-#include <algorithm>
 #include <cstdint>
+#include <ctime>
 #include <memory>
-#include <sstream>
-#include <string>
+#include <span>
 
 #include "PicoUart.hpp"
+#include "nmea.hpp"
 #include "structs.hpp"
 
 /**
@@ -28,23 +28,20 @@ class GPS {
   public:
     GPS(std::shared_ptr<PicoUart> uart, bool gpgga_on = true, bool gpgll_on = true);
     int locate_position(uint16_t timeout_s = 10);
+    size_t poll();
     Coordinates get_coordinates() const;
+    GpsFix get_fix() const;
+    uint32_t fixes() const;
+    bool get_utc(time_t &timestamp) const;
     void set_mode(Mode mode);
     Mode get_mode() const;
     void set_coordinates(double lat, double lon);
 
   private:
-    enum class SentenceState {
-        EMPTY,
-        INCOMPLETE,
-        COMPLETE
-    };
-
-  private:
-    int parse_output(std::string output);
-    int parse_gpgga();
-    int parse_gpgll();
-    int nmea_to_decimal_deg(const std::string &value, const std::string &direction);
+    int parse_output(std::span<const uint8_t> output);
+    int parse_sentence();
+    int parse_position(size_t index);
+    int parse_utc(std::string_view time, std::string_view date);
     void full_on_mode();
     void standby_mode();
     void alwayslocate_mode();
@@ -54,11 +51,15 @@ class GPS {
     double latitude = 0.0;
     double longitude = 0.0;
     bool status = false; // false if coordinates not found
+    uint8_t quality = 0;
+    uint8_t satellites = 0;
+    uint32_t fix_count = 0; // Sentences that updated the position
     bool gpgga = false;
     bool gpgll = false;
+    time_t utc = 0;         // UTC of the last GPRMC sentence with a valid fix, 0 if none was received
+    uint64_t utc_us = 0;    // time_us_64() when that sentence ended
 
-    std::string gps_sentence;
-    SentenceState sentence_state = SentenceState::EMPTY;
+    NmeaParser nmea;
 
     std::shared_ptr<PicoUart> uart;
 };
@@ -9,6 +9,8 @@
 #define MAX_ANGLE M_PI // half of a full turn (180 degrees)
 #define MIN_ANGLE 0
 
+#define CALIBRATION_TIME_DEFAULT_MS 30000 // used until the first calibration has been timed
+
 enum Axis {
     HORIZONTAL,
     VERTICAL
@@ -28,10 +30,13 @@ class MotorControl {
     bool isCalibrating(void) const;
     bool isRunning(void) const;
     void setHeading(double heading);
+    double estimate_slew_time(azimuthal_coordinates coords) const;
+    uint32_t calibration_time_ms(void) const;
 
   private:
     void init_optoforks(void);
     void calibration_handler(Axis axis, bool rise);
+    bool to_motor_coordinates(azimuthal_coordinates &coords) const;
     std::shared_ptr<StepperMotor> motor_horizontal;
     std::shared_ptr<StepperMotor> motor_vertical;
     int opto_horizontal;
@@ -42,4 +47,6 @@ class MotorControl {
     bool vertical_calibrating;
     bool handler_attached;
     double heading_correction;
+    uint64_t calibration_start;
+    volatile uint32_t calibration_duration_ms;
 };
\ No newline at end of file
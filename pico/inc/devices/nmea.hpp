@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#define NMEA_MAX_LENGTH 82 // Longest sentence allowed by NMEA 0183, from the '$' to the line end
+#define NMEA_MAX_FIELDS 24 // Fields kept per sentence, later ones are ignored
+
+/**
+ * @class NmeaParser
+ * @brief Byte-driven state machine for NMEA 0183 sentences.
+ * @details Bytes are fed one at a time, straight from the UART receive buffer. The XOR checksum is computed while the
+ * sentence arrives and compared with the "*hh" suffix, so a sentence is reported as soon as its last checksum digit
+ * is received. Sentences without a checksum, with bytes that aren't printable ASCII or longer than NMEA_MAX_LENGTH
+ * are rejected. When feed() reports a sentence, field() points into it until the next byte is fed. Nothing is
+ * allocated.
+ */
+class NmeaParser {
+  public:
+    enum Result {
+        NONE,     // No complete sentence yet
+        SENTENCE, // A sentence with a valid checksum was received, see field()
+        INVALID,  // A sentence was rejected
+    };
+
+    Result feed(uint8_t c);
+    std::string_view field(size_t index) const;
+    size_t field_count() const { return count; }
+    uint32_t errors() const { return error_count; }
+    void reset();
+
+  private:
+    enum State { IDLE, IN_BODY, IN_CHECKSUM };
+
+    Result reject();
+
+    State state = IDLE;
+    uint8_t checksum = 0;          // XOR of the bytes between '$' and '*'
+    uint8_t expected = 0;          // Checksum received after the '*'
+    uint8_t digits = 0;            // Checksum digits received
+    uint8_t length = 0;            // Bytes in buffer
+    uint8_t count = 0;             // Fields in buffer
+    uint8_t starts[NMEA_MAX_FIELDS];
+    char buffer[NMEA_MAX_LENGTH];  // Sentence between '$' and '*'
+    uint32_t error_count = 0;      // Rejected sentences
+};
+
+bool nmea_to_fixed(std::string_view value, std::string_view hemisphere, int32_t &result);
@@ -13,6 +13,10 @@
 #define RPM_MAX 15.
 #define RPM_MIN 1.8
 
+#define RPM_SLEW_MAX RPM_MAX // Top speed of a ramped move, not above RPM_MAX until faster slews are tested on hardware
+#define RAMP_ACCEL   30.     // Acceleration of a ramped move in RPM per second
+#define RAMP_TICK_MS 5       // Interval of the speed updates during a ramped move
+
 #define CLOCKWISE     true
 #define ANTICLOCKWISE false
 
@@ -25,7 +29,8 @@ class StepperMotor {
     void init(PIO pio, float rpm, bool clockwise);
 
     void turnSteps(uint16_t steps);
-    void turn_to(double radians);
+    void turnSteps(uint16_t steps, float peak_rpm);
+    void turn_to(double radians, float peak_rpm = 0);
     void turnOneRevolution();
     void stop();
     void off();
@@ -39,10 +44,26 @@ class StepperMotor {
     uint16_t getMaxSteps() const;
     int16_t getStepCount() const;
     bool getDirection() const;
+    double estimate_time_to(double from, double to, float rpm, float peak_rpm = 0) const;
 
   private:
+    // Trapezoidal velocity profile, speeds in steps per second and times in seconds
+    struct Ramp {
+        uint16_t steps; // Length of the move
+        float startSpeed;
+        float peakSpeed;
+        float accel; // Steps per second squared
+        float accelTime;
+        float cruiseTime;
+        float totalTime;
+        float speed; // Speed set by the last timer tick
+    };
+
+    static Ramp planRamp(uint16_t steps, float start_rpm, float peak_rpm);
+    static bool rampCallback(repeating_timer_t *timer);
+    void cancelRamp();
     void pioInit(void);
-    float calculateClkDiv(float rpm) const;
+    float calculateClkDiv(float rpm, float max_rpm = RPM_MAX) const;
     void morph_pio_pin_definitions(void);
     void pins_init();
     int read_steps_left(void);
@@ -58,6 +79,9 @@ class StepperMotor {
     int stepCounter;        // Total steps taken
     uint stepMax;           // Maximum number of steps for a full revolution
     uint64_t stepMemory;    // Tracks recent step movements
+    repeating_timer_t rampTimer;
+    Ramp ramp;              // Profile of the ramped move in progress
+    volatile bool ramping;  // rampTimer is running
 };
 
 #endif // STEPPER_MOTOR_H
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "message.hpp"
+
+#include <cstdint>
+#include <string_view>
+
+#define DIAG_AGGREGATOR_SIZE 8   // Distinct diagnostics kept between flushes
+#define DIAG_TEXT_LENGTH     64  // Longest diagnostics text kept, longer ones are cut
+#define DIAG_BATCH_LENGTH    180 // Longest batched text, leaves room for the framing in MSG_MAX_LENGTH
+#define DIAG_FLUSH_PERIOD_S  60  // Pending diagnostics are sent at the latest this long after the first one
+#define DIAG_URGENT_STATUS   3   // Diagnostics of this status or higher are sent without waiting for the period
+#define DIAG_URGENT_HOLDOFF  5   // Seconds between urgent flushes, a burst of errors still shares one message
+
+/**
+ * @class DiagnosticsAggregator
+ * @brief Collects diagnostics and sends them to the ESP in batches.
+ * @details Repeats of a diagnostic with the same status and text are counted instead of queued again, together with
+ * the time of the first and the last occurrence. A flush packs as many diagnostics as fit into one DIAGNOSTICS
+ * message, so a burst of warnings costs one exchange with the ESP and one POST to the server. Diagnostics that
+ * don't fit stay for the next flush. When all entries are in use a new diagnostic replaces the oldest one of a lower
+ * status, otherwise it is dropped. Dropped diagnostics are counted in the batch.
+ */
+class DiagnosticsAggregator {
+  public:
+    void report(uint8_t status, std::string_view text, int64_t now);
+    bool due(int64_t now) const;
+    bool flush(msg::Message &batch, int64_t now);
+    bool empty() const { return count == 0 && dropped == 0; }
+
+  private:
+    struct Entry {
+        uint8_t status;
+        uint8_t length;
+        char text[DIAG_TEXT_LENGTH];
+        uint32_t occurrences;
+        int64_t first; // Epoch of the first occurrence
+        int64_t last;  // Epoch of the last occurrence
+    };
+
+    Entry entries[DIAG_AGGREGATOR_SIZE];
+    uint8_t count = 0;
+    uint8_t highest = 0;                        // Highest status pending
+    uint32_t dropped = 0;                       // Distinct diagnostics lost because all entries were in use
+    int64_t pending_since = 0;                  // Epoch of the first report since the aggregator was last empty
+    int64_t last_urgent = -DIAG_URGENT_HOLDOFF; // Epoch of the last flush with an urgent diagnostic
+};
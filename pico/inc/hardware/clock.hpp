@@ -8,6 +8,30 @@
 #include <ctime>
 #include <string>
 
+/**
+ * @enum TimeSource
+ * @brief Where the time of the clock came from.
+ */
+enum class TimeSource {
+    NONE,   // Not set
+    MANUAL, // Config mode or the USB link, always accepted
+    ESP,    // DATETIME response from the ESP, fetched from the server
+    GPS,    // GPRMC sentence of the GPS
+};
+
+/**
+ * @enum TimePriority
+ * @brief Which of the ESP and the GPS sets the clock.
+ * @details The preferred source replaces time from the other one, the other one only sets a clock that wasn't set by
+ * the preferred source. The _ONLY priorities ignore the other source.
+ */
+enum class TimePriority {
+    GPS_FIRST,
+    ESP_FIRST,
+    GPS_ONLY,
+    ESP_ONLY,
+};
+
 /**
  * @class Clock
  * @brief Class for handling RTC timekeeping and alarms.
@@ -17,11 +41,17 @@ class Clock {
     Clock();
 
     void update(std::string &str);
-    void update(time_t timestamp);
+    bool update(time_t timestamp, TimeSource source = TimeSource::MANUAL);
+    bool accepts(TimeSource source) const;
+    TimeSource get_source() const;
+    void set_priority(TimePriority priority);
+    TimePriority get_priority() const;
     datetime_t get_datetime() const;
+    time_t get_epoch() const;
     bool is_synced() const;
     void add_alarm(datetime_t datetime);
     bool is_alarm_ringing() const;
+    uint64_t alarm_fired_at() const;
     void clear_alarm();
 
   private:
@@ -29,6 +59,10 @@ class Clock {
 
   private:
     time_t last_timestamp = 0;
+    uint64_t last_update_us = 0;
     bool synced = false;
-    bool alarm_wakeup = false;
+    TimeSource source = TimeSource::NONE;
+    TimePriority priority = TimePriority::GPS_FIRST;
+    volatile bool alarm_wakeup = false;
+    volatile uint64_t alarm_time_us = 0;
 };
@@ -1,35 +1,79 @@
 #pragma once
 
+#include <hardware/dma.h>
 #include <hardware/irq.h>
 #include <hardware/uart.h>
 
+#include <atomic>
+#include <span>
 #include <string>
 
 #include "RingBuffer.hpp"
 
+#define UART_TX_BUFFER_SIZE   256                           // Must be a power of two
+#define UART_RX_BUFFER_SIZE   256                           // Must be a power of two, used in interrupt mode
+#define UART_DMA_RX_RING_BITS 10                            // Receive ring of 1 KiB per UART in DMA mode
+#define UART_DMA_RX_SIZE      (1u << UART_DMA_RX_RING_BITS) // Must match the DMA ring size
+#define UART_DMA_RX_TRANSFERS 0x0FFFFFFFu                   // Restarted when it runs out, after ~6 days at 115200
+
 /**
  * @class PicoUart
  * @brief Class for handling UART communication on Raspberry Pi Pico.
+ * @details In DMA mode a DMA channel copies received bytes into a ring buffer in the background and the read
+ * position follows the DMA write pointer. Written data is sent from the transmit ring with one DMA transfer per
+ * contiguous region. Interrupt mode moves every byte through the UART interrupt and is used if DMA is disabled or no
+ * DMA channels are free.
+ *
+ * write_frame() queues a frame as a whole or not at all. A frame that doesn't fit in the transmit ring waits in a
+ * pending slot and the transmit interrupt moves it into the ring once there is room, so a long message is never cut
+ * short by a full buffer.
  */
 class PicoUart {
     friend void pico_uart0_handler(void);
     friend void pico_uart1_handler(void);
+    friend void pico_uart_dma_handler(void);
 
   public:
-    PicoUart(int uart_nr, int tx_pin, int rx_pin, int speed, int stop = 1, int tx_size = 256, int rx_size = 256);
+    PicoUart(int uart_nr, int tx_pin, int rx_pin, int speed, int stop = 1, bool dma = true);
     PicoUart(const PicoUart &) = delete; // prevent copying because each instance is associated with a HW peripheral
     int read(uint8_t *buffer, int size);
+    std::span<const uint8_t> peek();
+    void consume(size_t count);
     int write(const uint8_t *buffer, int size);
+    bool write_frame(const uint8_t *buffer, size_t size);
+    bool tx_ready() const;
+    bool tx_done() const;
     int send(const char *str);
     int send(const std::string &str);
     int flush();
+    bool dma_enabled() const;
+    uint32_t overflows() const;
+    uint32_t rx_high_water() const;
+    uint32_t tx_high_water() const;
 
   private:
     void uart_irq_rx();
     void uart_irq_tx();
-    RingBuffer tx;
-    RingBuffer rx;
+    bool dma_init(int uart_nr);
+    uint32_t dma_rx_written();
+    void dma_tx_start();
+    void tx_kick();
+    void tx_resume();
+    RingBuffer<UART_TX_BUFFER_SIZE> tx;
+    uint8_t tx_pending[UART_TX_BUFFER_SIZE]; // Frame waiting for room in tx
+    std::atomic<size_t> tx_pending_len{0};    // Set by write_frame(), cleared when the frame is moved into tx
+    RingBuffer<UART_RX_BUFFER_SIZE> rx;
     uart_inst_t *uart;
     int irqn;
     int speed;
+    uint32_t overflow_count = 0;     // Received bytes lost because the DMA ring was full
+    uint32_t rx_high_water_mark = 0; // Most unread bytes seen in the DMA ring
+
+    // DMA mode
+    int rx_dma = -1;
+    int tx_dma = -1;
+    uint8_t *rx_ring = nullptr;
+    uint32_t rx_read = 0;     // Total number of bytes read from the ring
+    uint32_t rx_dma_base = 0; // Total number of bytes written by previous runs of the receive channel
+    size_t tx_dma_len = 0;    // Bytes of tx in transfer, only changed with interrupts disabled or in the DMA interrupt
 };
@@ -1,22 +1,189 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <vector>
+#include <cstring>
+#include <span>
 
 /**
  * @class RingBuffer
- * @brief Class implementing a ring buffer for UART communication.
+ * @brief Single-producer/single-consumer byte ring with compile-time capacity.
+ * @details The producer may run in an interrupt handler while the consumer runs in thread context, or the other way
+ * around. Head and tail are free-running counters published with release/acquire ordering, so only loads and stores
+ * are needed (no read-modify-write atomics, which the Cortex-M0+ lacks). Besides single bytes, data can be copied in
+ * bulk or accessed in place: prepare()/commit() expose the contiguous free space to the producer and peek()/consume()
+ * expose the contiguous stored bytes to the consumer.
+ *
+ * @tparam N Capacity in bytes, must be a power of two.
  */
-class RingBuffer {
+template <size_t N> class RingBuffer {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of two");
+
   public:
-    explicit RingBuffer(int size);
-    bool empty() const;
-    bool full() const;
-    bool put(uint8_t data);
-    uint8_t get();
+    /**
+     * @brief Stores a byte. Producer only.
+     *
+     * @param data The byte to store.
+     * @return true if the byte was stored, false if the buffer was full.
+     */
+    bool put(uint8_t data) {
+        const uint32_t h = head.load(std::memory_order_relaxed);
+        const uint32_t used = h - tail.load(std::memory_order_acquire);
+        if (used == N) {
+            count_overflow(1);
+            return false;
+        }
+        buffer[h & (N - 1)] = data;
+        head.store(h + 1, std::memory_order_release);
+        update_high_water(used + 1);
+        return true;
+    }
+
+    /**
+     * @brief Removes a byte. Consumer only.
+     *
+     * @param data Reference to store the byte.
+     * @return true if a byte was removed, false if the buffer was empty.
+     */
+    bool get(uint8_t &data) {
+        const uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) return false;
+        data = buffer[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Copies as many bytes as fit into the buffer. Producer only.
+     *
+     * @param data The bytes to store.
+     * @return size_t Number of bytes stored, the rest are counted as overflow.
+     */
+    size_t write(std::span<const uint8_t> data) {
+        size_t count = 0;
+        while (count < data.size()) {
+            std::span<uint8_t> space = prepare();
+            if (space.empty()) break;
+            const size_t chunk = std::min(space.size(), data.size() - count);
+            std::memcpy(space.data(), data.data() + count, chunk);
+            commit(chunk);
+            count += chunk;
+        }
+        if (count < data.size()) count_overflow(data.size() - count);
+        return count;
+    }
+
+    /**
+     * @brief Copies stored bytes out of the buffer. Consumer only.
+     *
+     * @param data Destination for the bytes.
+     * @return size_t Number of bytes copied.
+     */
+    size_t read(std::span<uint8_t> data) {
+        size_t count = 0;
+        while (count < data.size()) {
+            std::span<const uint8_t> stored = peek();
+            if (stored.empty()) break;
+            const size_t chunk = std::min(stored.size(), data.size() - count);
+            std::memcpy(data.data() + count, stored.data(), chunk);
+            consume(chunk);
+            count += chunk;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Returns the contiguous free space after the head. Producer only.
+     * @details Fill it and call commit(). The free space may continue at the start of the buffer, call prepare()
+     * again after committing.
+     *
+     * @return std::span<uint8_t> Writable region, empty if the buffer is full.
+     */
+    std::span<uint8_t> prepare() {
+        const uint32_t h = head.load(std::memory_order_relaxed);
+        const uint32_t free = N - (h - tail.load(std::memory_order_acquire));
+        const uint32_t index = h & (N - 1);
+        return {&buffer[index], std::min<size_t>(free, N - index)};
+    }
+
+    /**
+     * @brief Publishes bytes written to the region returned by prepare(). Producer only.
+     *
+     * @param count Number of bytes written, at most the size of the prepared region.
+     */
+    void commit(size_t count) {
+        const uint32_t h = head.load(std::memory_order_relaxed) + count;
+        head.store(h, std::memory_order_release);
+        update_high_water(h - tail.load(std::memory_order_acquire));
+    }
+
+    /**
+     * @brief Returns the contiguous stored bytes after the tail. Consumer only.
+     * @details Process them in place and call consume(). The data may continue at the start of the buffer, call
+     * peek() again after consuming.
+     *
+     * @return std::span<const uint8_t> Readable region, empty if the buffer is empty.
+     */
+    std::span<const uint8_t> peek() const {
+        const uint32_t t = tail.load(std::memory_order_relaxed);
+        const uint32_t used = head.load(std::memory_order_acquire) - t;
+        const uint32_t index = t & (N - 1);
+        return {&buffer[index], std::min<size_t>(used, N - index)};
+    }
+
+    /**
+     * @brief Releases bytes returned by peek(). Consumer only.
+     *
+     * @param count Number of bytes processed, at most the size of the peeked region.
+     */
+    void consume(size_t count) {
+        tail.store(tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    /**
+     * @brief Discards all stored bytes. Consumer only.
+     */
+    void clear() { tail.store(head.load(std::memory_order_acquire), std::memory_order_release); }
+
+    bool empty() const { return size() == 0; }
+
+    bool full() const { return size() == N; }
+
+    size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+
+    static constexpr size_t capacity() { return N; }
+
+    /**
+     * @brief Returns the number of bytes dropped because the buffer was full.
+     *
+     * @return uint32_t Overflow count.
+     */
+    uint32_t overflows() const { return overflow_count.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns the highest number of bytes stored at once.
+     *
+     * @return uint32_t High-water mark.
+     */
+    uint32_t high_water() const { return high_water_mark.load(std::memory_order_relaxed); }
 
   private:
-    uint32_t head;
-    uint32_t tail;
-    std::vector<uint8_t> buffer;
+    void count_overflow(uint32_t count) {
+        overflow_count.store(overflow_count.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+
+    void update_high_water(uint32_t used) {
+        if (used > high_water_mark.load(std::memory_order_relaxed)) {
+            high_water_mark.store(used, std::memory_order_relaxed);
+        }
+    }
+
+    std::array<uint8_t, N> buffer;
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> overflow_count{0};
+    std::atomic<uint32_t> high_water_mark{0};
 };
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "lanes.hpp"
+#include "spsc-queue.hpp"
+
+#include <cstddef>
+
+/**
+ * @class LaneQueue
+ * @brief Queue with one SpscQueue per traffic lane, see lanes.hpp.
+ * @details Every front() chooses the lane again with a LaneScheduler, so a message queued in the control lane is
+ * taken next even if a lower lane was looked at before. pop() removes the item of the last front(), a message queued
+ * in between doesn't change which one is popped. Single producer and single consumer like SpscQueue.
+ *
+ * @tparam T Type of the queued items.
+ * @tparam N Capacity of each lane, must be a power of two.
+ */
+template <typename T, size_t N> class LaneQueue {
+  public:
+    /**
+     * @brief Copies an item to the back of a lane. Producer only.
+     *
+     * @param item The item to push.
+     * @param lane The lane to queue it in.
+     * @return bool True if the item was queued, False if the lane was full.
+     */
+    bool push(const T &item, msg::Lane lane) { return lanes[lane].push(item); }
+
+    /**
+     * @brief Returns the next item to take without removing it. Consumer only.
+     *
+     * @return T* Pointer to the item, nullptr if all lanes are empty.
+     */
+    T *front() {
+        bool waiting[msg::LANE_COUNT];
+        for (int lane = 0; lane < msg::LANE_COUNT; ++lane) {
+            waiting[lane] = !lanes[lane].empty();
+        }
+        selected = scheduler.select(waiting);
+        if (selected < 0) return nullptr;
+        return lanes[selected].front();
+    }
+
+    /**
+     * @brief Removes the item returned by front(). Consumer only.
+     */
+    void pop() {
+        if (selected < 0 && front() == nullptr) return;
+        lanes[selected].pop();
+        scheduler.taken(selected);
+        selected = -1;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t size() const {
+        size_t count = 0;
+        for (const auto &lane : lanes) {
+            count += lane.size();
+        }
+        return count;
+    }
+
+    size_t size(msg::Lane lane) const { return lanes[lane].size(); }
+
+    /**
+     * @brief Returns the number of items dropped because their lane was full.
+     *
+     * @return uint32_t Overflow count.
+     */
+    uint32_t overflows() const {
+        uint32_t count = 0;
+        for (const auto &lane : lanes) {
+            count += lane.overflows();
+        }
+        return count;
+    }
+
+  private:
+    SpscQueue<T, N> lanes[msg::LANE_COUNT];
+    msg::LaneScheduler scheduler;
+    int selected = -1; // Lane chosen by the last front(), -1 after pop()
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+#include <string>
+
+#define LINE_EDITOR_MAX_LENGTH 128 // Characters beyond this are ignored
+#define LINE_EDITOR_POLL_MAX   32  // Characters consumed per poll
+
+/**
+ * @class LineEditor
+ * @brief Incremental line editor for the USB console.
+ * @details Consumes only the characters that are already available on stdio so it can be polled from the main loop
+ * without blocking. Handles echo, hidden input and backspace.
+ */
+class LineEditor {
+  public:
+    /**
+     * @enum Result
+     * @brief Result of a poll.
+     */
+    enum Result {
+        IDLE,       // No input available
+        ACTIVITY,   // Characters were consumed but the line is not complete
+        LINE_READY, // A full line is available through line()
+    };
+
+  public:
+    LineEditor();
+
+    bool available();
+    Result poll(int max_chars = LINE_EDITOR_POLL_MAX);
+    const std::string &line() const;
+    void clear();
+    void set_hidden(bool hidden);
+
+  private:
+    bool feed(char c);
+
+  private:
+    std::string buffer;
+    int pending = PICO_ERROR_TIMEOUT;
+    char last_c = '\0';
+    bool hidden = false;
+    bool ready = false;
+};
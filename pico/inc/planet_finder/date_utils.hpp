@@ -13,3 +13,4 @@ int calculate_hour_difference(const datetime_t& dt1, const datetime_t& dt2);
 int calculate_sec_difference(const datetime_t &dt1, const datetime_t &dt2);
 
 int64_t datetime_to_epoch(datetime_t date);
+datetime_t epoch_to_datetime(int64_t epoch);
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class SpscQueue
+ * @brief Lock-free single-producer/single-consumer queue with compile-time capacity.
+ * @details Items are stored in a fixed array so pushing and popping never allocates. The producer may run in an
+ * interrupt handler or on the other core while the consumer drains the queue from the main loop. Head and tail are
+ * free-running counters published with release/acquire ordering, so only loads and stores are needed (no
+ * read-modify-write atomics, which the Cortex-M0+ lacks).
+ *
+ * @tparam T Type of the queued items.
+ * @tparam N Capacity of the queue, must be a power of two.
+ */
+template <typename T, size_t N> class SpscQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+  public:
+    /**
+     * @brief Copies an item to the back of the queue. Producer only.
+     *
+     * @param item The item to push.
+     * @return bool True if the item was queued, False if the queue was full.
+     */
+    bool push(const T &item) {
+        const uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N) {
+            overflow_count.store(overflow_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        items[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Returns the item at the front of the queue without removing it. Consumer only.
+     *
+     * @return T* Pointer to the front item, nullptr if the queue is empty.
+     */
+    T *front() {
+        const uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) return nullptr;
+        return &items[t & (N - 1)];
+    }
+
+    /**
+     * @brief Removes the item at the front of the queue. Consumer only.
+     */
+    void pop() {
+        const uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) return;
+        tail.store(t + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Discards all queued items. Consumer only.
+     */
+    void clear() { tail.store(head.load(std::memory_order_acquire), std::memory_order_release); }
+
+    bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+
+    size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+
+    static constexpr size_t capacity() { return N; }
+
+    /**
+     * @brief Returns the number of items dropped because the queue was full.
+     *
+     * @return uint32_t Overflow count.
+     */
+    uint32_t overflows() const { return overflow_count.load(std::memory_order_relaxed); }
+
+  private:
+    std::array<T, N> items;
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> overflow_count{0};
+};
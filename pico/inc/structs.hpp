@@ -7,6 +7,25 @@ struct Coordinates {
     bool status;
 };
 
+struct GpsFix {
+    double latitude;
+    double longitude;
+    int64_t time;       // Epoch of the fix, 0 if the clock wasn't set
+    uint8_t quality;    // GPGGA fix quality, 1 for a fix from a sentence without one, 0 if not from the GPS
+    uint8_t satellites; // Satellites in use, 0 if unknown
+};
+
+struct CompassSample {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+};
+
+struct CompassCalibration {
+    float offset[3];    // Hard-iron offset in raw units, x y z
+    float matrix[3][3]; // Soft-iron correction applied after subtracting the offset
+};
+
 struct azimuthal_coordinates {
     double azimuth;
     double altitude;
@@ -16,4 +35,5 @@ struct Command {
     uint64_t id;
     azimuthal_coordinates coords;
     datetime_t time;
+    uint8_t object_id; // Celestial object the command points at, 0 if none
 };
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+#define TRACE_CAPACITY 256 // Must be a power of two
+
+/**
+ * @enum TraceEventType
+ * @brief Types of events stored by the TraceRecorder.
+ * @details The numeric values are part of the dump format and are decoded by python/trace_decoder.py.
+ */
+enum TraceEventType : uint8_t {
+    TRACE_NONE = 0,
+    TRACE_STATE_CHANGE = 1, // arg8 = new state, arg16 = previous state
+    TRACE_MSG_SEND = 2,     // arg8 = message type
+    TRACE_MSG_RECV = 3,     // arg8 = message type, arg16 = 1 for ACK, 0 for NACK (RESPONSE only)
+    TRACE_ALARM_FIRE = 4,   // timestamp is the time the RTC alarm interrupt fired
+    TRACE_MOTOR_START = 5,  // arg32 = command id
+    TRACE_MOTOR_STOP = 6,   // arg32 = command id
+};
+
+/**
+ * @struct TraceEvent
+ * @brief A single 16 byte trace record.
+ */
+struct TraceEvent {
+    uint64_t timestamp; // time_us_64()
+    uint8_t type;       // TraceEventType
+    uint8_t arg8;
+    uint16_t arg16;
+    uint32_t arg32;
+};
+
+static_assert(sizeof(TraceEvent) == 16, "TraceEvent dump format expects 16 byte records");
+static_assert((TRACE_CAPACITY & (TRACE_CAPACITY - 1)) == 0, "TRACE_CAPACITY must be a power of two");
+
+/**
+ * @class TraceRecorder
+ * @brief Fixed-size ring buffer of timestamped events for latency analysis.
+ * @details Recording never allocates and overwrites the oldest event when the buffer is full.
+ */
+class TraceRecorder {
+  public:
+    void record(TraceEventType type, uint8_t arg8 = 0, uint16_t arg16 = 0, uint32_t arg32 = 0,
+                uint64_t timestamp = 0);
+    void dump(std::ostream &out) const;
+    void clear();
+    uint32_t size() const;
+    uint32_t overwritten() const;
+
+  private:
+    std::array<TraceEvent, TRACE_CAPACITY> events{};
+    uint32_t total = 0; // Total number of events recorded since last clear
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "message.hpp"
+#include "spsc-queue.hpp"
+
+#include <cstdint>
+
+#define USB_CONSOLE_ITF       0   // CDC interface of the console (stdio)
+#define USB_LINK_ITF          1   // CDC interface of the message link
+#define USB_LINK_QUEUE_SIZE   16  // Received messages waiting for the Controller, must be a power of two
+#define USB_WRITE_TIMEOUT_MS  100 // Longest wait for room in the USB transmit buffer
+#define USB_TASK_INTERVAL_US  1000 // Period of the background USB task, the same as pico_stdio_usb
+
+/**
+ * @class UsbLink
+ * @brief Message link to a laptop over the second CDC interface of the USB port.
+ * @details The Pico is a composite USB device: the first CDC interface replaces the SDK's stdio_usb as the console
+ * and the second one carries the same messages as the ESP link, so the device can be driven without the ESP or a
+ * network. USB is reliable, so there are no sequence numbers or link acknowledgements, only the framing of
+ * UART_COMMS.md. Replies use the framing of the last message received from the laptop. Like pico_stdio_usb, a timer
+ * raises a low priority interrupt every USB_TASK_INTERVAL_US that runs the TinyUSB task, so enumeration and the
+ * console keep working while the main loop sleeps or blocks. A mutex keeps that interrupt, the console and the link
+ * from entering TinyUSB at the same time.
+ */
+class UsbLink {
+  public:
+    UsbLink();
+    UsbLink(const UsbLink &) = delete; // There is one USB port
+    void poll();
+    bool receive(msg::Record &rec);
+    bool send(const msg::Record &rec);
+    bool connected() const;
+    uint32_t dropped() const;
+
+  private:
+    void deliver(std::string_view frame, bool binary);
+
+    msg::FrameParser framer;
+    SpscQueue<msg::Record, USB_LINK_QUEUE_SIZE> queue;
+    bool binary = false;       // Laptop used binary frames last
+    uint32_t drop_count = 0;   // Received messages that were invalid or didn't fit in the queue
+};
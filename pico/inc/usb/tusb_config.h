@@ -0,0 +1,25 @@
+#pragma once
+
+/*
+ * TinyUSB configuration for the Pico: a composite device with two CDC interfaces. Interface 0 carries the console
+ * (stdio, see usb-link.hpp) and interface 1 the message link to a laptop.
+ */
+
+#ifndef CFG_TUSB_MCU
+#error CFG_TUSB_MCU must be defined
+#endif
+
+#define CFG_TUSB_RHPORT0_MODE OPT_MODE_DEVICE
+#define CFG_TUSB_OS           OPT_OS_PICO
+
+#define CFG_TUD_ENDPOINT0_SIZE 64
+
+#define CFG_TUD_CDC    2
+#define CFG_TUD_MSC    0
+#define CFG_TUD_HID    0
+#define CFG_TUD_MIDI   0
+#define CFG_TUD_VENDOR 0
+
+#define CFG_TUD_CDC_RX_BUFSIZE 512 // Holds a few messages of a burst from the laptop
+#define CFG_TUD_CDC_TX_BUFSIZE 512
+#define CFG_TUD_CDC_EP_BUFSIZE 64 // Full speed bulk endpoint size
@@ -0,0 +1,81 @@
+/**
+ * @file command-scheduler.cpp
+ * @brief Implementation of the CommandScheduler class for ordering commands by execution time.
+ */
+
+#include "command-scheduler.hpp"
+
+#include "date_utils.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Heap comparator that puts the earliest command on top.
+ *
+ * @param a First command.
+ * @param b Second command.
+ * @return bool True if a should execute after b.
+ */
+static bool later(const ScheduledCommand &a, const ScheduledCommand &b) {
+    if (a.epoch != b.epoch) return a.epoch > b.epoch;
+    return static_cast<int32_t>(a.sequence - b.sequence) > 0;
+}
+
+/**
+ * @brief Inserts a command, using its datetime as the execution time.
+ *
+ * @param command The command to insert.
+ * @return bool True if the command was inserted, False if the scheduler is full.
+ */
+bool CommandScheduler::insert(const Command &command) { return insert(command, datetime_to_epoch(command.time)); }
+
+/**
+ * @brief Inserts a command with an explicit execution time.
+ *
+ * @param command The command to insert.
+ * @param epoch Execution time in seconds since the Unix epoch.
+ * @return bool True if the command was inserted, False if the scheduler is full.
+ */
+bool CommandScheduler::insert(const Command &command, int64_t epoch) {
+    if (count >= heap.size()) return false;
+    heap[count++] = ScheduledCommand{.epoch = epoch, .sequence = next_sequence++, .command = command};
+    std::push_heap(heap.begin(), heap.begin() + count, later);
+    return true;
+}
+
+/**
+ * @brief Returns the command that executes first.
+ * @note The scheduler must not be empty.
+ *
+ * @return const ScheduledCommand& The earliest command.
+ */
+const ScheduledCommand &CommandScheduler::top() const { return heap[0]; }
+
+/**
+ * @brief Removes and returns the command that executes first.
+ * @note The scheduler must not be empty.
+ *
+ * @return Command The earliest command.
+ */
+Command CommandScheduler::pop() {
+    std::pop_heap(heap.begin(), heap.begin() + count, later);
+    return heap[--count].command;
+}
+
+/**
+ * @brief Removes the first command if its execution time is before a given time.
+ * @details Call it in a loop to remove all expired commands one at a time.
+ *
+ * @param oldest_allowed A command with an epoch below this value is removed.
+ * @param expired Reference to store the removed command.
+ * @return bool True if a command was removed, False if the first command hasn't expired or there is none.
+ */
+bool CommandScheduler::pop_expired(int64_t oldest_allowed, Command &expired) {
+    if (count == 0 || heap[0].epoch >= oldest_allowed) return false;
+    expired = pop();
+    return true;
+}
+
+bool CommandScheduler::empty() const { return count == 0; }
+
+size_t CommandScheduler::size() const { return count; }
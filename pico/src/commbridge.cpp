@@ -6,6 +6,7 @@
 #include "commbridge.hpp"
 
 #include "debug.hpp"
+#include "schema.hpp"
 
 using msg::Message;
 
@@ -15,119 +16,267 @@ using msg::Message;
  * @param uart Shared pointer to a PicoUart instance.
  * @param queue Shared pointer to a queue for storing messages.
  */
-CommBridge::CommBridge(std::shared_ptr<PicoUart> uart, std::shared_ptr<std::queue<Message>> queue)
-    : uart(uart), queue(queue) {}
+CommBridge::CommBridge(std::shared_ptr<PicoUart> uart, std::shared_ptr<MessageQueue> queue)
+    : uart(uart), queue(queue) {
+    link_tx.set_stats(&link_stats);
+}
 
 /**
- * @brief Reads characters from the UART and appends them to a string buffer.
+ * @brief Sends a Message to the UART after formatting it.
  *
- * @param str Reference to the string where read characters are appended.
- * @return int The number of characters read.
+ * @param msg The message to be sent.
+ * @note Helper function for send(const msg::Record &rec).
  */
-int CommBridge::read(std::string &str) {
-    uint8_t rbuffer[RBUFFER_SIZE] = {0};
-    int count = 0;
+void CommBridge::send(const Message &msg) {
+    msg::Record rec;
+    if (!msg::to_record(msg, rec)) {
+        DEBUG("Message too long to send, type:", static_cast<int>(msg.type));
+        return;
+    }
+    send(rec);
+}
 
-    while (int len = uart->read(rbuffer, sizeof(rbuffer))) {
-        if (rbuffer[0] != 0) {
-            str += (char *)rbuffer;
-            count += len;
+/**
+ * @brief Sends a Record to the UART.
+ * @details When the ESP supports sequenced messages the record goes through the link window and is retransmitted
+ * until the ESP acknowledges it. DEVICE_STATUS messages restart the link and are never sequenced. A record that
+ * doesn't fit in the window is sent unsequenced, Controller::send_process checks can_send() first so only responses
+ * take that path.
+ *
+ * @param rec The record to be sent.
+ */
+void CommBridge::send(const msg::Record &rec) {
+    if (sequencing() && rec.type != msg::DEVICE_STATUS && rec.type != msg::LINK_ACK) {
+        if (const msg::Record *sequenced = link_tx.send(rec, to_ms_since_boot(get_absolute_time()))) {
+            write(*sequenced);
+            return;
         }
-        std::fill_n(rbuffer, sizeof(rbuffer), 0);
-        sleep_ms(RWAIT_MS);
     }
-
-    return count;
+    write(rec);
 }
 
 /**
- * @brief Sends a Message to the UART after formatting it.
+ * @brief Formats a record and writes it to the UART.
+ * @details Uses a binary frame if the ESP supports it and the record can be represented in binary, ASCII otherwise.
+ * Unsequenced messages other than responses are answered with a RESPONSE, the time is kept for the RTT statistics.
  *
- * @param msg The message to be sent.
- * @note Helper function for send(const std::string &str).
+ * @param rec The record to be written.
+ * @note Helper function for send(std::string_view str).
  */
-void CommBridge::send(const Message &msg) {
-    std::string formatted_msg = "";
-    convert_to_string(msg, formatted_msg);
-
-    send(formatted_msg);
+void CommBridge::write(const msg::Record &rec) {
+    char buffer[MSG_MAX_LENGTH];
+    size_t len = binary_framing() ? msg::encode_binary(rec, buffer, sizeof(buffer)) : 0;
+    if (len == 0) { len = msg::encode(rec, buffer, sizeof(buffer)); }
+    if (len > 0) {
+        if (!send(std::string_view(buffer, len))) { return; }
+        link_stats.count(msg::LinkStats::SENT, rec.type);
+        if (rec.seq < 0 && rec.type != msg::RESPONSE && rec.type != msg::LINK_ACK) {
+            awaiting = rec.type;
+            awaiting_since_ms = to_ms_since_boot(get_absolute_time());
+        }
+    } else {
+        DEBUG("Message too long to send, type:", static_cast<int>(rec.type));
+    }
 }
 
 /**
- * @brief Sends a string to the UART.
+ * @brief Sends a string to the UART as one frame.
+ * @details The frame is queued whole or not at all. If the UART still has a frame pending this waits up to
+ * UART_WRITE_TIMEOUT_MS for it to move into the transmit buffer. Controller::send_process checks can_send() first,
+ * so normally only responses and link acknowledgements wait here.
  *
  * @param str The string to be sent.
+ * @return bool True if the frame was queued, False if it was dropped.
  */
-void CommBridge::send(const std::string &str) {
-    DEBUG("Sending: ", str);
-    uart->send(str.c_str());
+bool CommBridge::send(std::string_view str) {
+    if (!str.empty() && str[0] == MSG_BINARY_DELIMITER) {
+        DEBUG("Sending binary frame of", str.size(), "bytes");
+    } else {
+        DEBUG("Sending: ", str);
+    }
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(str.data());
+    uint64_t start = time_us_64();
+    while (!uart->write_frame(data, str.size())) {
+        if (str.size() > UART_TX_BUFFER_SIZE || time_us_64() - start > UART_WRITE_TIMEOUT_MS * 1000) {
+            DEBUG("UART transmit buffer busy, dropped frame of", str.size(), "bytes");
+            return false;
+        }
+        tight_loop_contents();
+    }
     last_sent_time = get_absolute_time();
+    return true;
 }
 
 /**
- * @brief Parses messages from a string and pushes them to a queue for further processing.
+ * @brief Parses received bytes and pushes complete messages to a queue for further processing.
+ * @details Bytes are fed to the framing state machine one at a time, so a partial message is kept until the rest of it
+ * is received. ASCII messages are validated with the CRC computed while they arrived. Both formats are always
+ * accepted.
  *
- * @param str Reference to the string containing the raw message data.
+ * @param data The received bytes.
  * @return int The number of messages parsed successfully.
  */
-int CommBridge::parse(std::string &str) {
+int CommBridge::parse(std::span<const uint8_t> data) {
     int parse_count = 0;
-    do {
-        // Find the first $ in the string unless there is a partial message is in string_buffer
-        if (string_buffer.empty()) {
-            size_t pos;
-            if (pos = str.find("$"); pos == std::string::npos) { return 0; } // Return if no $ is found
-            str.erase(0, pos);                                               // Erase everything before the $
+    for (uint8_t c : data) {
+        switch (framer.feed(c)) {
+            case msg::FrameParser::ASCII: {
+                msg::View view;
+                msg::Record rec;
+                if (msg::decode(framer.frame(), view, framer.payload_crc()) != 0) {
+                    link_stats.count(msg::LinkStats::CRC_FAILED, msg::UNASSIGNED);
+                } else if (msg::to_record(view, rec)) {
+                    parse_count += deliver(rec);
+                }
+                break;
+            }
+            case msg::FrameParser::BINARY:
+                parse_count += push_binary(framer.frame());
+                break;
+            case msg::FrameParser::NONE:
+                break;
         }
+    }
 
-        // Check whether the message is complete
-        // If it's not complete, add the entire string to string_buffer
-        if (size_t pos = str.find(";"); pos == std::string::npos) {
-            string_buffer += str;
-            str.clear();
-        } else { // Message is complete
-            string_buffer += str.substr(0, pos);
-            str.erase(0, pos + 1);
-
-            Message msg;
-            // Try to convert the string to a message and push it to the queue
-            if (convert_to_message(string_buffer, msg) == 0) {
-                queue->push(msg);
-                parse_count++;
-            }
+    return parse_count;
+}
+
+/**
+ * @brief Decodes a binary frame and pushes it to the queue.
+ *
+ * @param frame The COBS encoded frame without the delimiters.
+ * @return int The number of messages queued.
+ */
+int CommBridge::push_binary(std::string_view frame) {
+    msg::Record rec;
+    if (int rc = msg::decode_binary(frame, rec); rc != 0) {
+        DEBUG("Invalid binary frame:", rc);
+        link_stats.count(msg::LinkStats::CRC_FAILED, msg::UNASSIGNED);
+        return 0;
+    }
+    return deliver(rec);
+}
 
-            string_buffer.clear();
+/**
+ * @brief Passes a decoded message to the link layer or the queue.
+ * @details LINK_ACK messages are consumed by the link. Sequenced messages are buffered until they can be released in
+ * order and are acknowledged on the next service_link(). Unsequenced messages go straight to the queue.
+ *
+ * @param rec The decoded message.
+ * @return int The number of messages queued.
+ */
+int CommBridge::deliver(const msg::Record &rec) {
+    link_stats.count(msg::LinkStats::RECEIVED, rec.type);
+    if (rec.type == msg::RESPONSE && rec.seq < 0) { on_response(rec); }
+    if (rec.type == msg::LINK_ACK) {
+        if (msg::LinkAck ack; msg::decode(rec, ack)) {
+            link_tx.on_ack(ack.cumulative, ack.sack, to_ms_since_boot(get_absolute_time()));
         }
-    } while (!str.empty());
+        return 0;
+    }
+    if (rec.seq >= 0) {
+        link_rx.accept(rec); // Duplicates are acknowledged again, the previous LINK_ACK may have been lost
+        ack_pending = true;
+        return release();
+    }
+    if (!queue->push(rec)) {
+        DEBUG("Receive queue full, dropped message of type", static_cast<int>(rec.type));
+        return 0;
+    }
+    link_stats.level(msg::LinkStats::RX_QUEUE, queue->size());
+    return 1;
+}
 
-    return parse_count;
+/**
+ * @brief Takes the RTT sample and counts the NACK for the message a RESPONSE answers.
+ *
+ * @param rec The received RESPONSE.
+ */
+void CommBridge::on_response(const msg::Record &rec) {
+    if (awaiting == msg::UNASSIGNED) { return; }
+    msg::Response response;
+    if (!msg::decode(rec, response)) { return; }
+
+    link_stats.rtt(to_ms_since_boot(get_absolute_time()) - awaiting_since_ms);
+    if (!response.ack) { link_stats.count(msg::LinkStats::NACKED, awaiting); }
+    awaiting = msg::UNASSIGNED;
 }
 
 /**
- * @brief Reads characters from the UART and parses them until the timeout is reached.
+ * @brief Moves in-order sequenced messages from the link to the queue.
+ * @details Messages stay in the link while the queue is full. They aren't acknowledged until released, so the ESP
+ * keeps retransmitting instead of the message being dropped.
+ *
+ * @return int The number of messages queued.
+ */
+int CommBridge::release() {
+    int count = 0;
+    while (const msg::Record *rec = link_rx.front()) {
+        if (queue->size() >= queue->capacity() || !queue->push(*rec)) { break; }
+        link_rx.pop();
+        count++;
+    }
+    if (count > 0) { link_stats.level(msg::LinkStats::RX_QUEUE, queue->size()); }
+    return count;
+}
+
+/**
+ * @brief Sends pending link acknowledgements and retransmits frames the ESP hasn't acknowledged in time.
+ */
+void CommBridge::service_link() {
+    if (ack_pending) {
+        msg::Record ack;
+        if (msg::to_record(msg::LinkAck{link_rx.cumulative(), link_rx.sack()}, ack)) { write(ack); }
+        ack_pending = false;
+    }
+    if (!sequencing()) { return; }
+
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    while (const msg::Record *rec = link_tx.poll(now)) {
+        DEBUG("Retransmitting sequence number", rec->seq);
+        write(*rec);
+    }
+}
+
+/**
+ * @brief Parses characters straight from the UART receive buffer until the timeout is reached.
+ * @details The receive buffer is parsed in place and released region by region. Nothing sleeps in the read path, a
+ * message is handed to the queue as soon as its last byte has been received.
  *
  * @param timeout_ms Timeout duration in milliseconds.
  * @param reset_on_activity If true, resets the timeout on activity detection.
  * @return int The number of messages parsed.
  */
 int CommBridge::read_and_parse(const uint16_t timeout_ms, bool reset_on_activity) {
-    std::string str;
     bool done = false;
+    int released = release(); // Messages held back while the queue was full
     int result = 0;
     uint64_t time = time_us_64();
 
     while (!done && time_us_64() - time < timeout_ms * 1000) {
-        int count = read(str);
+        size_t count = 0;
+        for (std::span<const uint8_t> region = uart->peek(); !region.empty(); region = uart->peek()) {
+            result += parse(region);
+            uart->consume(region.size());
+            count += region.size();
+        }
         if (count > 0) {
-            DEBUG(str);
-            result = parse(str);
+            DEBUG("Received", count, "bytes");
             if (reset_on_activity) { time = time_us_64(); }
         }
         if (result >= 0) { done = true; }
     }
+    if (uint32_t overflows = uart->overflows(); overflows != rx_overflows) {
+        DEBUG("UART receive buffer overflowed, bytes lost:", overflows - rx_overflows);
+        rx_overflows = overflows;
+    }
+    link_stats.level(msg::LinkStats::RX_BUFFER, uart->rx_high_water());
+    link_stats.level(msg::LinkStats::TX_BUFFER, uart->tx_high_water());
+    service_link();
 
-    return result;
+    return result + released;
 }
+
 /**
  * @brief Checks if enough time has passed since the last message was sent.
  * This is used to determine if enough time has passed to send a message without receiving a reply from the ESP32.
@@ -140,3 +289,66 @@ bool CommBridge::ready_to_send() {
     if (get_absolute_time() - last_sent_time > 20 * 1000000) return true; // 20 seconds waited
     return false;
 }
+
+/**
+ * @brief Checks whether another message can be sent without waiting.
+ * @details The UART must have room for a frame. Sequenced messages are also limited by the link window. Without
+ * sequencing the ESP handles one message at a time and the caller paces itself on responses.
+ *
+ * @return bool True if the UART accepts a frame and the link window has room or the link isn't sequenced.
+ */
+bool CommBridge::can_send() const { return uart->tx_ready() && (!sequencing() || link_tx.can_send()); }
+
+/**
+ * @brief Stores the capabilities the ESP advertised in its DEVICE_STATUS message and restarts the link.
+ *
+ * @param capabilities Bitmask of msg::Capability values, CAP_NONE for an ESP that doesn't advertise any.
+ */
+void CommBridge::set_peer_capabilities(int capabilities) {
+    peer_capabilities = capabilities;
+    // DEVICE_STATUS is sent when the ESP starts, both ends restart their sequence numbers from zero
+    link_tx.reset();
+    link_rx.reset();
+    ack_pending = false;
+}
+
+/**
+ * @brief Allows or forbids sending binary frames.
+ * @details Forbidding binary frames keeps the link readable on a terminal for debugging. Received binary frames are
+ * still accepted.
+ *
+ * @param allow True to send binary frames when the ESP supports them.
+ */
+void CommBridge::allow_binary(bool allow) { binary_allowed = allow; }
+
+/**
+ * @brief Returns the capabilities to advertise in DEVICE_STATUS messages.
+ *
+ * @return int Bitmask of msg::Capability values.
+ */
+int CommBridge::capabilities() const {
+    return msg::CAP_SEQUENCED | (binary_allowed ? msg::CAP_BINARY_FRAMING : msg::CAP_NONE);
+}
+
+/**
+ * @brief Checks whether messages are sent as binary frames.
+ *
+ * @return bool True if binary framing is allowed and supported by the ESP.
+ */
+bool CommBridge::binary_framing() const { return binary_allowed && (peer_capabilities & msg::CAP_BINARY_FRAMING); }
+
+/**
+ * @brief Checks whether messages are sent through the sliding-window link.
+ *
+ * @return bool True if the ESP acknowledges sequenced messages.
+ */
+bool CommBridge::sequencing() const { return peer_capabilities & msg::CAP_SEQUENCED; }
+
+
+/**
+ * @brief Returns the link statistics.
+ * @details Buffer high-water marks are updated on every read_and_parse().
+ *
+ * @return const msg::LinkStats& Counters since boot.
+ */
+const msg::LinkStats &CommBridge::stats() const { return link_stats; }
\ No newline at end of file
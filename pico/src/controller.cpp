@@ -4,30 +4,17 @@
 #include "date_utils.hpp"
 #include "debug.hpp"
 #include "message.hpp"
+#include "schema.hpp"
 
 #include <algorithm>
 #include <cctype>
+#include <cmath>
+#include <sstream>
 #include <hardware/timer.h>
 #include <pico/stdio.h>
 #include <pico/time.h>
 #include <pico/types.h>
 
-/**
- * @brief Compares two commands based on their time.
- *
- * @param a First command.
- * @param b Second command.
- * @return bool True if a is less than b, False otherwise.
- */
-bool compare_time(const Command &a, const Command &b) {
-    if (a.time.year != b.time.year) return a.time.year < b.time.year;
-    if (a.time.month != b.time.month) return a.time.month < b.time.month;
-    if (a.time.day != b.time.day) return a.time.day < b.time.day;
-    if (a.time.hour != b.time.hour) return a.time.hour < b.time.hour;
-    if (a.time.min != b.time.min) return a.time.min < b.time.min;
-    return a.time.sec < b.time.sec;
-}
-
 /**
  * @brief Constructor for the Controller class.
  *
@@ -38,28 +25,27 @@ bool compare_time(const Command &a, const Command &b) {
  * @param motor_controller Pointer to the MotorControl object.
  * @param storage Pointer to the Storage object.
  * @param msg_queue Pointer to the message queue.
+ * @param usb Pointer to the USB message link, nullptr without one.
  */
 Controller::Controller(std::shared_ptr<Clock> clock, std::shared_ptr<GPS> gps, std::shared_ptr<Compass> compass,
                        std::shared_ptr<CommBridge> commbridge, std::shared_ptr<MotorControl> motor_controller,
-                       std::shared_ptr<Storage> storage, std::shared_ptr<std::queue<msg::Message>> msg_queue)
+                       std::shared_ptr<Storage> storage, std::shared_ptr<MessageQueue> msg_queue,
+                       std::shared_ptr<UsbLink> usb)
     : clock(clock), gps(gps), compass(compass), commbridge(commbridge), mctrl(motor_controller), storage(storage),
-      msg_queue(msg_queue) {}
+      msg_queue(msg_queue), usb(usb) {}
 
 /**
  * @brief Main function for the Controller class.
  * @details Handles the main control flow of the Pico.
  */
 void Controller::run() {
-    if (input_detected()) {
-        config_mode();
-        DEBUG("Exited config mode: init");
-    }
+    config_poll();
     if (!initialized) {
         DEBUG("Not yet initialized");
         if (init()) {
             initialized = true;
             gps->set_mode(GPS::Mode::STANDBY);
-            send(msg::device_status(true));
+            send(msg::device_status(true, commbridge->capabilities()));
             DEBUG("Initialized");
         } else {
             DEBUG("Failed to initialize");
@@ -69,24 +55,28 @@ void Controller::run() {
 
     DEBUG("Starting main loop");
     while (true) {
-        if (input_received || input_detected()) {
-            config_mode();
-            DEBUG("Exited config mode: main loop");
-        }
+        config_poll();
         sanitize_commands();
 
+        if (state != traced_state) {
+            tracer.record(TRACE_STATE_CHANGE, state, traced_state);
+            traced_state = state;
+        }
+
         switch (state) {
             case COMM_READ:
                 double_check = false;
                 commbridge->read_and_parse(1000, true);
+                usb_process();
+                gps_process();
             case COMM_SEND:
                 send_process();
             case CHECK_QUEUES:
-                if (msg_queue->size() > 0)
+                if (!msg_queue->empty())
                     state = COMM_PROCESS;
-                else if (instr_msg_queue.size() > 0)
+                else if (!instr_msg_queue.empty())
                     state = INSTR_PROCESS;
-                else if (check_motor)
+                else if (check_motor || waiting_for_shutter)
                     state = MOTOR_WAIT;
                 else if (waiting_for_camera)
                     state = COMM_READ;
@@ -115,14 +105,21 @@ void Controller::run() {
                 motor_control();
                 break;
             case MOTOR_WAIT:
-                if (mctrl->isRunning())
-                    state = COMM_READ;
-                else {
-                    state = COMM_READ;
+                state = COMM_READ;
+                if (mctrl->isRunning()) break;
+                if (check_motor) {
                     check_motor = false;
-                    send(msg::picture(current_command.id));
-                    waiting_for_camera = true;
+                    waiting_for_shutter = true;
+                    tracer.record(TRACE_MOTOR_STOP, 0, 0, current_command.id);
                 }
+                // Arrived early, hold position so the picture is taken at the planned time
+                if (clock->get_epoch() < shutter_epoch - ESP_SETTLE_TIME_S) break;
+                waiting_for_shutter = false;
+                picture_epoch = clock->get_epoch();
+                send(msg::picture(current_command.id));
+                picture_id = current_command.id;
+                picture_pending = true;
+                waiting_for_camera = true;
                 break;
             case TRACE:
                 trace();
@@ -138,7 +135,10 @@ void Controller::run() {
                 } else {
                     wait_for_event(get_absolute_time(), 100000); // 100ms
                     if (clock->is_alarm_ringing()) {
+                        tracer.record(TRACE_ALARM_FIRE, 0, 0, 0, clock->alarm_fired_at());
                         clock->clear_alarm();
+                        armed_epoch = -1;
+                        command_triggered = true;
                         state = MOTOR_CALIBRATE;
                     } else {
                         state = COMM_READ;
@@ -154,21 +154,63 @@ void Controller::run() {
 }
 
 /**
- * @brief Sanitizes the commands queue.
- * @details Checks if the first command is too old and removes it if it is.
+ * @brief Sanitizes the command scheduler.
+ * @details Discards every command that is too old and arms the RTC alarm for the next command. The alarm is only
+ * re-armed when the next command changes.
  */
 void Controller::sanitize_commands() {
-    if (commands.size() <= 0) return;
+    if (commands.empty()) return;
     if (now_commands > 0) return;
-    std::sort(commands.begin(), commands.end(), compare_time);
-    Command front = commands.front();
-    if (calculate_sec_difference(front.time, clock->get_datetime()) > 1) {
+    if (command_triggered) return; // Alarm fired and the next command is being executed
+
+    Command expired;
+    while (commands.pop_expired(clock->get_epoch() - 1, expired)) {
         DEBUG("Command was too old, discarding");
-        send(msg::cmd_status(front.id, -2, 0));
-        commands.erase(commands.begin());
-    } else {
-        clock->add_alarm(front.time);
+        send(msg::cmd_status(expired.id, -2, 0));
     }
+
+    if (!commands.empty() && commands.top().epoch != armed_epoch) {
+        // Wake up early enough to calibrate and slew before the capture time
+        const ScheduledCommand &next = commands.top();
+        int64_t wakeup = next.epoch - capture_lead(next.command);
+        int64_t now = clock->get_epoch();
+        if (wakeup <= now) wakeup = now + 2; // RTC alarm doesn't fire for a time that has passed
+        clock->add_alarm(epoch_to_datetime(wakeup));
+        armed_epoch = next.epoch;
+        DEBUG("Alarm set", next.epoch - wakeup, "seconds before command");
+    }
+}
+
+/**
+ * @brief Estimates how many seconds before its capture time a command needs to be started.
+ * @details Sum of the last measured calibration time, the estimated slew time from the calibration position and the
+ * ESP settle delay.
+ *
+ * @param command The command.
+ * @return int64_t Lead time in seconds.
+ */
+int64_t Controller::capture_lead(const Command &command) const {
+    double seconds = mctrl->calibration_time_ms() / 1000.0 + mctrl->estimate_slew_time(command.coords);
+    return static_cast<int64_t>(std::ceil(seconds)) + ESP_SETTLE_TIME_S;
+}
+
+/**
+ * @brief Plans the capture time of current_command and recomputes its coordinates for that time.
+ * @details The picture can't be taken before the motors have slewed and the ESP has settled, so the planned capture
+ * time is the later of the requested time and the earliest achievable time.
+ *
+ * @param now Current unix time.
+ */
+void Controller::aim_for_shutter(int64_t now) {
+    int64_t earliest = now + static_cast<int64_t>(std::ceil(mctrl->estimate_slew_time(current_command.coords))) +
+                       ESP_SETTLE_TIME_S;
+    shutter_epoch = std::max(target_epoch, earliest);
+    if (current_command.object_id < SUN || current_command.object_id > NEPTUNE) return;
+
+    Celestial celestial(static_cast<Planets>(current_command.object_id));
+    celestial.set_observer_coordinates(gps->get_coordinates());
+    azimuthal_coordinates coords = celestial.get_coordinates(epoch_to_datetime(shutter_epoch));
+    if (coords.altitude >= 0) current_command.coords = coords;
 }
 
 /**
@@ -183,15 +225,24 @@ bool Controller::init() {
 #ifdef GPS_COORDS // For testing purposes
     gps->set_coordinates(60.258656, 24.843641);
 #endif
-    if (!gps->get_coordinates().status) {
+    if (!fix_loaded) load_fix();
+    // The GPS is also needed for the time until a preferred source has set the clock
+    bool need_gps = !gps->get_coordinates().status ||
+                    (clock->get_source() != TimeSource::GPS && clock->accepts(TimeSource::GPS));
+    if (need_gps) {
         if (gps->get_mode() != GPS::Mode::FULL_ON) gps->set_mode(GPS::Mode::FULL_ON);
     }
-    if (!clock->is_synced()) {
-        if (commbridge->ready_to_send()) { commbridge->send(msg::datetime_request()); }
+    if (!clock->is_synced() && clock->accepts(TimeSource::ESP)) {
+        if (commbridge->ready_to_send()) { transmit(msg::datetime_request()); }
     }
 
     if (commbridge->read_and_parse(1000, true) > 0) { comm_process(); }
-    if (!gps->get_coordinates().status) gps->locate_position(2);
+    // A stored fix and time from the ESP are enough, the GPS confirms the position in the background later
+    if (need_gps && !(gps->get_coordinates().status && clock->is_synced())) gps->locate_position(2);
+    if (gps->fixes() != seen_fixes) save_fix();
+    if (time_t utc; gps->get_utc(utc) && clock->get_source() != TimeSource::GPS) {
+        clock->update(utc, TimeSource::GPS);
+    }
 
     if (gps->get_coordinates().status && clock->is_synced()) { result = true; }
     DEBUG("GPS fix status:", gps->get_coordinates().status);
@@ -210,47 +261,72 @@ void Controller::comm_process() {
     state = SLEEP;
     if (commbridge->ready_to_send() && waiting_for_response) {
         DEBUG("ESP didn't respond to message of type:", static_cast<int>(last_sent));
-        send(msg::diagnostics(2, "ESP didn't respond to message"));
+        report(2, "ESP didn't respond to message");
         waiting_for_response = false;
         if (last_sent == msg::PICTURE) { state = MOTOR_OFF; }
     }
-    while (msg_queue->size() > 0) {
+    while (const msg::Record *front = msg_queue->front()) {
         DEBUG(msg_queue->size());
-        msg::Message msg = msg_queue->front();
+        const msg::Record &msg = *front;
         DEBUG("Last sent is:", static_cast<int>(last_sent));
+        tracer.record(TRACE_MSG_RECV, msg.type, msg.type == msg::RESPONSE && msg.field(0) == "1");
+        if (shell_state == SHELL_WAIT_RESPONSE) config_response(msg);
         waiting_for_response = false;
         switch (msg.type) {
-            case msg::RESPONSE: // Received response ACK/NACK from ESP
-                if (msg.content[0] == "1") {
+            case msg::RESPONSE: { // Received response ACK/NACK from ESP
+                // The ESP handles its lanes by priority, RESPONSEs don't come in the order the messages were sent.
+                // Only the RESPONSE to a PICTURE carries an image id.
+                msg::Response response;
+                bool for_picture = picture_pending && msg::decode(msg, response) && response.image_id == picture_id;
+                if (msg.field(0) == "1") {
                     DEBUG("Received ack");
-                    if (last_sent == msg::PICTURE) { state = MOTOR_OFF; }
+                    if (for_picture) {
+                        picture_pending = false;
+                        state = MOTOR_OFF;
+                        // The ESP takes the picture ESP_SETTLE_TIME_S after receiving the PICTURE message
+                        int64_t achieved = picture_epoch + ESP_SETTLE_TIME_S;
+                        report(1, "Command " + std::to_string(current_command.id) + " captured at " +
+                                      std::to_string(achieved) + ", " + std::to_string(achieved - target_epoch) +
+                                      " s off target");
+                    }
                 } else {
                     DEBUG("Received nack");
-                    if (last_sent == msg::PICTURE) { state = COMM_READ; }
+                    if (for_picture) { // The ESP couldn't take the picture
+                        picture_pending = false;
+                        state = MOTOR_OFF;
+                        report(2, "ESP failed to take picture");
+                    }
                 }
                 break;
+            }
             case msg::DATETIME:
                 DEBUG("Received datetime");
-                clock->update(msg.content[0]);
+                if (msg::Datetime datetime; msg::decode(msg, datetime)) {
+                    clock->update(datetime.value, TimeSource::ESP);
+                }
                 send(msg::response(true));
                 break;
             case msg::DEVICE_STATUS: // Send ACK or DEVICE_STATUS response back to ESP
                 DEBUG("Received ESP init");
-                if (msg.content[0] == "1") {
-                    esp_initialized = true;
-                } else {
-                    esp_initialized = false;
+                // The ESP restarted, a PICTURE sent before won't be answered
+                if (picture_pending) {
+                    picture_pending = false;
+                    state = MOTOR_OFF;
+                }
+                if (msg::DeviceStatus status; msg::decode(msg, status)) {
+                    esp_initialized = status.ok;
+                    // The optional capabilities advertise the link features of the ESP, older firmware omits them
+                    commbridge->set_peer_capabilities(status.capabilities.value_or(msg::CAP_NONE));
                 }
                 if (last_sent == msg::DEVICE_STATUS) {
                     send(msg::response(true));
                 } else {
-                    send(msg::device_status(true));
+                    send(msg::device_status(true, commbridge->capabilities()));
                 }
                 break;
             case msg::INSTRUCTIONS: // Store/Process instructions
                 DEBUG("Received instructions");
-                instr_msg_queue.push(msg);
-                send(msg::response(true));
+                send(msg::response(instr_msg_queue.push(msg)));
                 break;
             default:
                 DEBUG("Unexpected message type: ", msg.type);
@@ -261,79 +337,261 @@ void Controller::comm_process() {
     }
 }
 
+/**
+ * @brief Uses the GPS fix stored in EEPROM until the GPS has a fix of its own.
+ * @details The device doesn't move between nights, so the stored fix lets init() finish without waiting for the GPS.
+ * A background fix is started right after init() to confirm it.
+ */
+void Controller::load_fix() {
+    fix_loaded = true;
+    if (gps->get_coordinates().status || !storage->load_fix(stored_fix)) return;
+    fix_stored = true;
+    gps->set_coordinates(stored_fix.latitude, stored_fix.longitude);
+    refix_at_us = time_us_64();
+    DEBUG("Using stored GPS fix from", stored_fix.time, "quality", stored_fix.quality);
+}
+
+/**
+ * @brief Stores a new GPS fix in EEPROM if it differs from the stored one.
+ * @details The fix is only written if it is more than GPS_FIX_MOVED_M from the stored one or the stored one is older
+ * than GPS_FIX_MAX_AGE_S, so confirming the position doesn't wear the EEPROM.
+ */
+void Controller::save_fix() {
+    seen_fixes = gps->fixes();
+    GpsFix fix = gps->get_fix();
+    fix.time = clock->is_synced() ? clock->get_epoch() : 0;
+    if (fix_stored) {
+        // Equirectangular approximation, good enough for distances this short
+        const double radius = 6371000.0;
+        double lat = (fix.latitude - stored_fix.latitude) * M_PI / 180.0;
+        double lon = (fix.longitude - stored_fix.longitude) * M_PI / 180.0 * cos(fix.latitude * M_PI / 180.0);
+        double distance = radius * sqrt(lat * lat + lon * lon);
+        bool fresh = fix.time >= stored_fix.time && fix.time - stored_fix.time < GPS_FIX_MAX_AGE_S;
+        if (distance < GPS_FIX_MOVED_M && fresh) return;
+    }
+    if (!storage->store_fix(fix)) {
+        DEBUG("Failed to store GPS fix");
+        return;
+    }
+    stored_fix = fix;
+    fix_stored = true;
+    DEBUG("Stored GPS fix", fix.latitude, fix.longitude);
+}
+
+/**
+ * @brief Runs the background GPS fix.
+ * @details Every GPS_REFIX_PERIOD_S the GPS is woken up and its output is parsed on each pass of the main loop until
+ * it reports a fix or GPS_REFIX_TIMEOUT_S has passed, then it goes back to standby. A new fix updates the stored one
+ * and disciplines the clock if the GPS is an accepted time source.
+ */
+void Controller::gps_process() {
+    uint64_t now = time_us_64();
+    if (!refixing) {
+        if (now < refix_at_us) return;
+        DEBUG("Starting background GPS fix");
+        refixing = true;
+        refix_started_us = now;
+        seen_fixes = gps->fixes();
+        gps->set_mode(GPS::Mode::FULL_ON);
+        return;
+    }
+
+    gps->poll();
+    if (gps->fixes() != seen_fixes) {
+        save_fix();
+        if (time_t utc; gps->get_utc(utc) && std::abs(utc - clock->get_epoch()) > 1) {
+            clock->update(utc, TimeSource::GPS);
+        }
+    } else if (now - refix_started_us < GPS_REFIX_TIMEOUT_S * 1000000ull) {
+        return;
+    } else {
+        report(2, "GPS background fix timed out");
+    }
+    refixing = false;
+    refix_at_us = now + GPS_REFIX_PERIOD_S * 1000000ull;
+    gps->set_mode(GPS::Mode::STANDBY);
+}
+
+/**
+ * @brief Processes messages from the USB link.
+ * @details The laptop gets the same handling as the ESP for instructions and datetime, every message is answered with
+ * a RESPONSE right away. CMD_STATUS and DIAGNOSTICS are mirrored to the laptop by send().
+ */
+void Controller::usb_process() {
+    if (!usb) return;
+    usb->poll();
+    msg::Record msg;
+    while (usb->receive(msg)) {
+        tracer.record(TRACE_MSG_RECV, msg.type, 0);
+        bool ack = false;
+        switch (msg.type) {
+            case msg::INSTRUCTIONS:
+                DEBUG("Received instructions over USB");
+                ack = instr_msg_queue.push(msg);
+                break;
+            case msg::DATETIME:
+                if (msg::Datetime datetime; msg::decode(msg, datetime) && datetime.value > 1) {
+                    clock->update(datetime.value);
+                    ack = true;
+                }
+                break;
+            default:
+                DEBUG("Unexpected message type over USB: ", msg.type);
+                break;
+        }
+        msg::Record response;
+        if (msg::to_record(msg::Response{ack}, response)) { usb->send(response); }
+    }
+}
+
 /**
  * @brief Processes instructions from the instruction queue.
  * @details Checks if an instruction is ready to be processed and tries to process it.
  */
 void Controller::instr_process() {
     DEBUG("Processing instructions");
-    msg::Message instr = instr_msg_queue.front();
+    msg::Record instr = *instr_msg_queue.front();
     instr_msg_queue.pop();
     double_check = true;
-    bool error = false;
     state = SLEEP;
-    Planets planet = MOON;
-    if (instr.content.size() == 3 && instr.type == msg::INSTRUCTIONS) {
-        int planet_num;
-        if (str_to_int(instr.content[0], planet_num)) {
-            if (planet_num >= 1 && planet_num <= 9)
-                planet = (Planets)planet_num;
-            else
-                error = true;
-        } else
-            error = true;
-
-        int id;
-        if (!str_to_int(instr.content[1], id)) error = true;
-
-        int position;
-        if (str_to_int(instr.content[2], position)) {
-            if (position < 1 || position > 4) error = true;
-        } else
-            error = true;
-
-        if (!error) {
-            Celestial celestial(planet);
-            Interest_point interest = static_cast<Interest_point>(position);
-            celestial.set_observer_coordinates(gps->get_coordinates());
-            Command command = celestial.get_interest_point_command(interest, clock->get_datetime());
-            command.id = id;
-            if (interest == NOW) {
-                command.time = clock->get_datetime(); // we only add coordinates in the above function
-                now_commands++;
+    if (instr.type != msg::INSTRUCTIONS) return;
+
+    // The schema limits the object to a planet and the position to ASCENDING..NOW
+    msg::Instructions instructions;
+    if (!msg::decode(instr, instructions)) {
+        DEBUG("Error in instruction.");
+        int id = 0;
+        instr.field_to_int(1, id); // Best effort, the image id may be the invalid field
+        send(msg::cmd_status(id, -1, 0));
+        return;
+    }
+
+    int32_t id = instructions.image_id;
+    Planets planet = static_cast<Planets>(instructions.object);
+    Interest_point interest = static_cast<Interest_point>(instructions.position);
+    Celestial celestial(planet);
+    celestial.set_observer_coordinates(gps->get_coordinates());
+    Command command = celestial.get_interest_point_command(interest, clock->get_datetime());
+    command.id = id;
+    command.object_id = planet;
+    if (interest == NOW) {
+        command.time = clock->get_datetime(); // we only add coordinates in the above function
+        now_commands++;
+    }
+    if (command.coords.altitude < 0 || command.time.year < 2000) {
+        DEBUG("Instruction not possible");
+        DEBUG("command altitude:", command.coords.altitude * 180 / M_PI, "year:", command.time.year);
+        send(msg::cmd_status(id, -2, 0));
+        return;
+    }
+
+    if (!commands.insert(command)) {
+        DEBUG("Command scheduler is full");
+        if (interest == NOW) now_commands--;
+        send(msg::cmd_status(id, -2, 0));
+        return;
+    }
+    send(msg::cmd_status(id, 2, datetime_to_epoch(command.time)));
+    DEBUG("Next command: ", (int)commands.top().command.time.year, (int)commands.top().command.time.month,
+          (int)commands.top().command.time.day, (int)commands.top().command.time.hour,
+          (int)commands.top().command.time.min);
+}
+
+/**
+ * @brief Polls the console and advances the config shell.
+ * @details Called on every iteration of the main loop. Only the characters already available on stdio are consumed,
+ * so scheduled commands and ESP traffic keep being serviced while the config shell is in use. The shell is entered on
+ * the first key press and exited with "exit" or after 60 seconds without input.
+ */
+void Controller::config_poll() {
+    const uint64_t TIMEOUT = 60000000; // 60 seconds
+
+    if (shell_state == SHELL_OFF) {
+        if (console.available()) {
+            console.clear();
+            config_enter();
+        }
+        return;
+    }
+
+    LineEditor::Result result = console.poll();
+    uint64_t now = time_us_64();
+    if (result != LineEditor::IDLE) shell_activity = now;
+
+    switch (shell_state) {
+        case SHELL_COMMAND:
+            if (result == LineEditor::LINE_READY) {
+                std::string line = console.line();
+                console.clear();
+                config_command(line);
             }
-            if (command.coords.altitude < 0 || command.time.year < 2000) {
-                DEBUG("Instruction not possible");
-                DEBUG("command altitude:", command.coords.altitude * 180 / M_PI, "year:", command.time.year);
-                send(msg::cmd_status(id, -2, 0));
+            break;
+        case SHELL_PASSWORD:
+            if (result == LineEditor::LINE_READY) {
+                std::string password = console.line();
+                console.clear();
+                console.set_hidden(false);
+                transmit(msg::wifi(wifi_ssid, password));
+                std::fill(password.begin(), password.end(), '*');
+                std::cout << "Sent wifi credentials: " << wifi_ssid << " " << password << std::endl;
+                config_wait_for_response();
+            }
+            break;
+        case SHELL_WAIT_RESPONSE:
+            if (result != LineEditor::IDLE) {
+                console.clear();
+                std::cout << "Stopped waiting for response" << std::endl;
+                shell_state = SHELL_COMMAND;
+                config_prompt();
+            } else if (now - shell_wait_start > TIMEOUT) {
+                std::cout << "No response from ESP" << std::endl;
+                shell_state = SHELL_COMMAND;
+                config_prompt();
+            }
+            return; // Waiting for the ESP does not count as inactivity
+        case SHELL_CALIBRATE_COMPASS:
+            if (result != LineEditor::IDLE) {
+                console.clear();
+                compass->cancelCalibration();
+                std::cout << "Stopped compass calibration" << std::endl;
+                shell_state = SHELL_COMMAND;
+                config_prompt();
                 return;
             }
+            switch (compass->pollCalibration()) {
+                case Compass::CalibrationStatus::RUNNING:
+                    return; // Calibration has its own timeout
+                case Compass::CalibrationStatus::DONE:
+                    std::cout << "Compass calibrated, heading is " << compass->getHeading() << std::endl;
+                    break;
+                default:
+                    std::cout << "Compass calibration failed, "
+                              << (compass->isCalibrated() ? "kept the previous one" : "not calibrated") << std::endl;
+                    break;
+            }
+            shell_activity = now;
+            shell_state = SHELL_COMMAND;
+            config_prompt();
+            break;
+        default:
+            break;
+    }
 
-            send(msg::cmd_status(id, 2, datetime_to_epoch(command.time)));
-            commands.push_back(command);
-            std::sort(commands.begin(), commands.end(), compare_time);
-            DEBUG("Next command: ", (int)commands.front().time.year, (int)commands.front().time.month,
-                  (int)commands.front().time.day, (int)commands.front().time.hour, (int)commands.front().time.min);
-            if (commands.size() > 0 && interest != NOW) clock->add_alarm(commands.front().time);
-        } else {
-            DEBUG("Error in instruction.");
-            send(msg::cmd_status(id, -1, 0));
-        }
+    if (shell_state != SHELL_OFF && now - shell_activity > TIMEOUT) {
+        std::cout << std::endl << "--Timeout--" << std::endl;
+        config_exit();
     }
 }
 
 /**
  * @brief Enters config mode.
- * @details This function starts the config mode, which allows the user to send various commands to the Pico and ESP.
- * @note This function is blocking and only returns when the user exits the config mode or the timeout is reached.
+ * @details Prints the banner and the first prompt. Commands are read and executed by config_poll().
  */
-void Controller::config_mode() {
-    const int64_t TIMEOUT = 60000000; // 60 seconds
-
+void Controller::config_enter() {
     DEBUG("Stdio input detected. Entering config mode...");
-    input_received = false;
-    std::string input_buffer = "";
-    bool exit = false;
+    shell_state = SHELL_COMMAND;
+    shell_activity = time_us_64();
+    console.set_hidden(false);
 
     std::cout << "Stargazer config mode - type \"help\" for available commands";
     if (waiting_for_response && waiting_for_camera) {
@@ -342,256 +600,292 @@ void Controller::config_mode() {
                   << "! Please avoid using send commands (wifi|server|token|debug_picture|debug_send_msg)"
                   << " while waiting for response" << std::endl;
     }
-    while (!exit) {
-        std::cout << std::endl << "> ";
-        std::cout.flush();
+    config_prompt();
+}
 
-        int rc = input(input_buffer, TIMEOUT);
-        if (rc == -1) {
-            exit = true;
-            std::cout << "Exiting config mode" << std::endl;
-        }
+/**
+ * @brief Exits config mode.
+ */
+void Controller::config_exit() {
+    std::cout << "Exiting config mode" << std::endl;
+    console.clear();
+    console.set_hidden(false);
+    shell_state = SHELL_OFF;
+    DEBUG("Exited config mode");
+}
+
+/**
+ * @brief Prints the config mode prompt.
+ */
+void Controller::config_prompt() {
+    std::cout << std::endl << "> ";
+    std::cout.flush();
+}
 
-        if (rc > 0) {
-            std::stringstream ss(input_buffer);
-            std::string token;
-            ss >> token;
-            if (token == "help") {
-                std::cout << "Available commands:" << std::endl
-                          << "help - print this help message" << std::endl
-                          << "exit - exit config mode" << std::endl
-                          << "heading - set compass heading of the device" << std::endl
-                          << "time [unixtime] - view or set current time" << std::endl
-                          << "coord [<lat> <lon>] - view or set current coordinates" << std::endl
-                          << "instruction <object_id> <command_id> <position_id> - add an instruction to the queue"
-                          << std::endl
-                          << "wifi <ssid> - set wifi details. You will be prompted for the password" << std::endl
-                          << "server <host> <port> - set the server details" << std::endl
-                          << "token <token> - set the server api token" << std::endl
+/**
+ * @brief Executes a single config mode command.
+ * @details Commands that need more input or a response from the ESP switch the shell state and return immediately.
+ *
+ * @param line The command line entered by the user.
+ */
+void Controller::config_command(const std::string &line) {
+    if (line.empty()) {
+        config_prompt();
+        return;
+    }
+
+    std::stringstream ss(line);
+    std::string token;
+    ss >> token;
+    if (token == "help") {
+        std::cout << "Available commands:" << std::endl
+                  << "help - print this help message" << std::endl
+                  << "exit - exit config mode" << std::endl
+                  << "heading - set compass heading of the device" << std::endl
+                  << "compass_calibrate - rotate the device in all directions to calibrate the compass" << std::endl
+                  << "time [unixtime] - view or set current time" << std::endl
+                  << "time_source [gps_first|esp_first|gps_only|esp_only] - view or set the preferred time source"
+                  << std::endl
+                  << "coord [<lat> <lon>] - view or set current coordinates" << std::endl
+                  << "instruction <object_id> <command_id> <position_id> - add an instruction to the queue"
+                  << std::endl
+                  << "wifi <ssid> - set wifi details. You will be prompted for the password" << std::endl
+                  << "server <host> <port> - set the server details" << std::endl
+                  << "token <token> - set the server api token" << std::endl
+                  << "framing [ascii|binary] - view or set the framing used on the ESP link" << std::endl
+                  << "link_stats - print the ESP link statistics" << std::endl
+                  << "trace_dump - print the event trace for python/trace_decoder.py" << std::endl
+                  << "trace_clear - clear the event trace" << std::endl
 #ifdef ENABLE_DEBUG
-                          << "debug_command <year> <month> <day> <hour> <min> <alt> <azi> - add a command directly "
-                             "to the queue"
-                          << std::endl
-                          << "debug_picture <image_id> - send a take picture message to the ESP" << std::endl
-                          << "debug_rec_msg <message_str> - add a message to the receive queue" << std::endl
-                          << "debug_send_msg <message_type> <message_content_1> ... - send a message to the ESP"
-                          << std::endl
-                          << "debug_trace <planet_id> - trace a planet" << std::endl
+                  << "debug_command <year> <month> <day> <hour> <min> <alt> <azi> - add a command directly "
+                     "to the queue"
+                  << std::endl
+                  << "debug_picture <image_id> - send a take picture message to the ESP" << std::endl
+                  << "debug_rec_msg <message_str> - add a message to the receive queue" << std::endl
+                  << "debug_send_msg <message_type> <message_content_1> ... - send a message to the ESP"
+                  << std::endl
+                  << "debug_trace <planet_id> - trace a planet" << std::endl
 #endif
-                    ;
-            } else if (token == "exit") {
-                exit = true;
-                std::cout << "Exiting config mode" << std::endl;
-            } else if (token == "heading") {
-                float heading = 0;
-                if (ss >> heading) { mctrl->setHeading(heading); }
-                std::cout << "Heading set to: " << heading << std::endl;
-            } else if (token == "time") {
-                time_t timestamp = 0;
-                if (ss >> timestamp) {
-                    clock->update(timestamp);
-                    datetime_t now = clock->get_datetime();
-                    std::cout << "Time set to " << now.year << "-" << +now.month << "-" << +now.day << " " << +now.hour
-                              << ":" << +now.min << std::endl;
-                } else {
-                    datetime_t now = clock->get_datetime();
-                    std::cout << "Time is " << now.year << "-" << +now.month << "-" << +now.day << " " << +now.hour
-                              << ":" << +now.min << std::endl;
-                }
-            } else if (token == "coord") {
-                double lat, lon;
-                if (ss >> lat >> lon) {
-                    gps->set_coordinates(lat, lon);
-                    std::cout << "Coordinates set to " << lat << ", " << lon << std::endl;
-                } else {
-                    Coordinates coords = gps->get_coordinates();
-                    if (!coords.status) {
-                        std::cout << "Coordinates are not available" << std::endl;
-                    } else {
-                        std::cout << "Coordinates are " << coords.latitude << ", " << coords.longitude << std::endl;
-                    }
-                }
-            } else if (token == "instruction") {
-                int object = 0, command = 0, position = 0;
-                if (ss >> object >> command >> position) {
-                    msg::Message instruction = {
-                        .type = msg::INSTRUCTIONS,
-                        .content = {std::to_string(object), std::to_string(command), std::to_string(position)}};
-                    instr_msg_queue.push(instruction);
-                    std::cout << "Instruction added to queue: " << object << ", " << command << ", " << position
-                              << std::endl;
-                } else {
-                    std::cout << "Invalid instruction" << std::endl;
-                }
-            } else if (token == "wifi") {
-                std::string ssid;
-                if (ss >> ssid) {
-                    std::cout << "Enter the password for " << ssid << ": ";
-                    std::cout.flush();
-                    std::string password = "";
-                    int rc = input(password, TIMEOUT, true);
-                    if (rc >= 0) {
-                        commbridge->send(msg::wifi(ssid, password));
-                        std::fill(password.begin(), password.end(), '*');
-                        std::cout << "Sent wifi credentials: " << ssid << " " << password << std::endl;
-                        if (!config_wait_for_response()) std::cout << "No response from ESP" << std::endl;
-                    }
-                }
-            } else if (token == "server") {
-                std::string address;
-                int port = 0;
-                if (ss >> address) {
-                    if (!(ss >> port)) { std::cout << "No port specified" << std::endl; }
-                    commbridge->send(msg::server(address, port));
-                    std::cout << "Sent server details: " << address << " " << port << std::endl;
-                    if (!config_wait_for_response()) std::cout << "No response from ESP" << std::endl;
-                } else {
-                    std::cout << "No address specified" << std::endl;
-                }
-            } else if (token == "token") {
-                std::string token;
-                if (ss >> token) {
-                    commbridge->send(msg::api(token));
-                    std::cout << "Sent api token: " << token << std::endl;
-                    if (!config_wait_for_response()) std::cout << "No response from ESP" << std::endl;
-                } else {
-                    std::cout << "No api token specified" << std::endl;
-                }
+            ;
+    } else if (token == "exit") {
+        config_exit();
+    } else if (token == "heading") {
+        float heading = 0;
+        if (ss >> heading) { mctrl->setHeading(heading); }
+        std::cout << "Heading set to: " << heading << std::endl;
+    } else if (token == "compass_calibrate") {
+        std::cout << "Rotate the device slowly in all directions until calibration is done" << std::endl
+                  << "Press any key to stop" << std::endl;
+        compass->startCalibration();
+        shell_state = SHELL_CALIBRATE_COMPASS;
+    } else if (token == "time") {
+        time_t timestamp = 0;
+        if (ss >> timestamp) {
+            clock->update(timestamp);
+            datetime_t now = clock->get_datetime();
+            std::cout << "Time set to " << now.year << "-" << +now.month << "-" << +now.day << " " << +now.hour
+                      << ":" << +now.min << std::endl;
+        } else {
+            datetime_t now = clock->get_datetime();
+            std::cout << "Time is " << now.year << "-" << +now.month << "-" << +now.day << " " << +now.hour
+                      << ":" << +now.min << std::endl;
+        }
+    } else if (token == "time_source") {
+        static const char *const names[] = {"gps_first", "esp_first", "gps_only", "esp_only"};
+        std::string name;
+        if (ss >> name) {
+            auto it = std::find(std::begin(names), std::end(names), name);
+            if (it != std::end(names)) {
+                clock->set_priority(static_cast<TimePriority>(it - std::begin(names)));
+                std::cout << "Time source set to " << name << std::endl;
+            } else {
+                std::cout << "Unknown time source: " << name << std::endl;
             }
-#ifdef ENABLE_DEBUG
-            else if (token == "debug_command") {
-                int year = 0;
-                int month = 0, day = 0, hour = 0, min = 0;
-                double alt = 0.0, azi = 0.0;
-                if (ss >> year >> month >> day >> hour >> min >> alt >> azi) {
-                    Command command = {
-                        .coords = {alt * M_PI / 180.0, azi * M_PI / 180.0},
-                        .time = {.year = (int16_t)year,
-                                 .month = (int8_t)month,
-                                 .day = (int8_t)day,
-                                 .hour = (int8_t)hour,
-                                 .min = (int8_t)min,
-                                 .sec = 0},
-                    };
-
-                    commands.push_back(command);
-                    std::cout << "Command added to queue: " << year << ", " << month << ", " << day << ", " << hour
-                              << ", " << min << ", " << alt << ", " << azi << std::endl;
-                } else {
-                    std::cout << "Invalid command" << std::endl;
-                }
-            } else if (token == "debug_picture") {
-                int image_id = 0;
-                if (ss >> image_id) {
-                    commbridge->send(msg::picture(image_id));
-                    std::cout << "Sent picture request: " << image_id << std::endl;
-                    if (!config_wait_for_response()) std::cout << "No response from ESP" << std::endl;
-                } else {
-                    std::cout << "No image id specified" << std::endl;
-                }
-            } else if (token == "debug_rec_msg") {
-                std::string msg_str;
-                msg::Message msg;
-                if (ss >> msg_str) {
-                    if (size_t pos = msg_str.find(';'); pos != std::string::npos) { msg_str.erase(pos); }
-                    if (msg::convert_to_message(msg_str, msg) == 0) {
-                        msg_queue->push(msg);
-                        std::cout << "Message added to receive queue: " << msg_str << std::endl;
-                    } else {
-                        std::cout << "Invalid message (" << rc << "): " << msg_str << std::endl;
-                    }
-                } else {
-                    std::cout << "No message specified" << std::endl;
-                }
-            } else if (token == "debug_send_msg") {
-                msg::Message msg;
-                std::string type_str;
-                if (ss >> type_str) {
-                    if (msg.type = msg::verify_message_type(type_str); msg.type != msg::MessageType::UNASSIGNED) {
-                        std::vector<std::string> content;
-                        std::string content_str;
-                        while (ss >> content_str) {
-                            content.push_back(content_str);
-                        }
-
-                        if (content.size() > 0) {
-                            msg.content = content;
-                            commbridge->send(msg);
-                            std::cout << "Sent message with type " << type_str << std::endl;
-                            if (!config_wait_for_response()) std::cout << "No response from ESP" << std::endl;
-                        } else {
-                            std::cout << "No content specified" << std::endl;
-                        }
-                    } else {
-                        std::cout << "Invalid message type" << std::endl;
-                    }
-                }
-            } else if (token == "debug_trace") {
-                int planet;
-                if (ss >> planet) {
-                    state = TRACE;
-                    trace_object = {static_cast<Planets>(planet)};
-
-                    DEBUG("Trace starting after exiting config mode. Trace object:");
-                    trace_object.print_planet();
-                }
+        } else {
+            static const char *const sources[] = {"not set", "manual", "ESP", "GPS"};
+            std::cout << "Time source is " << names[static_cast<int>(clock->get_priority())] << ", time was set by "
+                      << sources[static_cast<int>(clock->get_source())] << std::endl;
+        }
+    } else if (token == "coord") {
+        double lat, lon;
+        if (ss >> lat >> lon) {
+            gps->set_coordinates(lat, lon);
+            std::cout << "Coordinates set to " << lat << ", " << lon << std::endl;
+        } else {
+            Coordinates coords = gps->get_coordinates();
+            if (!coords.status) {
+                std::cout << "Coordinates are not available" << std::endl;
+            } else {
+                std::cout << "Coordinates are " << coords.latitude << ", " << coords.longitude << std::endl;
             }
-#endif
-            else {
-                std::cout << "Invalid command: \"" << token << "\"" << std::endl;
+        }
+    } else if (token == "instruction") {
+        int object = 0, command = 0, position = 0;
+        if (ss >> object >> command >> position) {
+            msg::Record instruction;
+            if (msg::to_record(msg::instructions(object, command, position), instruction) &&
+                instr_msg_queue.push(instruction)) {
+                std::cout << "Instruction added to queue: " << object << ", " << command << ", " << position
+                          << std::endl;
+            } else {
+                std::cout << "Instruction queue is full" << std::endl;
             }
+        } else {
+            std::cout << "Invalid instruction" << std::endl;
         }
-
-        input_buffer.clear();
+    } else if (token == "wifi") {
+        std::string ssid;
+        if (ss >> ssid) {
+            std::cout << "Enter the password for " << ssid << ": ";
+            std::cout.flush();
+            wifi_ssid = ssid;
+            console.set_hidden(true);
+            shell_state = SHELL_PASSWORD;
+        }
+    } else if (token == "server") {
+        std::string address;
+        int port = 0;
+        if (ss >> address) {
+            if (!(ss >> port)) { std::cout << "No port specified" << std::endl; }
+            transmit(msg::server(address, port));
+            std::cout << "Sent server details: " << address << " " << port << std::endl;
+            config_wait_for_response();
+        } else {
+            std::cout << "No address specified" << std::endl;
+        }
+    } else if (token == "token") {
+        std::string token;
+        if (ss >> token) {
+            transmit(msg::api(token));
+            std::cout << "Sent api token: " << token << std::endl;
+            config_wait_for_response();
+        } else {
+            std::cout << "No api token specified" << std::endl;
+        }
+    } else if (token == "framing") {
+        std::string framing;
+        if (ss >> framing) {
+            if (framing == "ascii" || framing == "binary") {
+                commbridge->allow_binary(framing == "binary");
+                // Renegotiate so the ESP switches too
+                send(msg::device_status(true, commbridge->capabilities()));
+                config_wait_for_response();
+            } else {
+                std::cout << "Unknown framing: " << framing << std::endl;
+            }
+        } else {
+            std::cout << "Framing is " << (commbridge->binary_framing() ? "binary" : "ascii") << std::endl;
+        }
+    } else if (token == "link_stats") {
+        const msg::LinkStats &stats = commbridge->stats();
+        std::cout << "type sent received crc_failed nacked retransmitted" << std::endl;
+        for (int type = msg::UNASSIGNED; type <= msg::LINK_ACK; ++type) {
+            std::cout << type;
+            for (int counter = 0; counter < msg::LinkStats::COUNTER_COUNT; ++counter) {
+                auto id = static_cast<msg::LinkStats::Counter>(counter);
+                std::cout << " " << stats.get(id, static_cast<msg::MessageType>(type));
+            }
+            std::cout << std::endl;
+        }
+        std::cout << "ACK RTT min/avg/max: " << stats.rtt_min() << "/" << stats.rtt_avg() << "/" << stats.rtt_max()
+                  << " ms over " << stats.rtt_samples() << " samples" << std::endl
+                  << "High-water marks: rx buffer " << stats.high_water(msg::LinkStats::RX_BUFFER)
+                  << " bytes, tx buffer " << stats.high_water(msg::LinkStats::TX_BUFFER) << " bytes, receive queue "
+                  << stats.high_water(msg::LinkStats::RX_QUEUE) << " messages" << std::endl;
+    } else if (token == "trace_dump") {
+        tracer.dump(std::cout);
+    } else if (token == "trace_clear") {
+        tracer.clear();
+        std::cout << "Trace cleared" << std::endl;
     }
-}
+#ifdef ENABLE_DEBUG
+    else if (token == "debug_command") {
+        int year = 0;
+        int month = 0, day = 0, hour = 0, min = 0;
+        double alt = 0.0, azi = 0.0;
+        if (ss >> year >> month >> day >> hour >> min >> alt >> azi) {
+            Command command = {
+                .coords = {alt * M_PI / 180.0, azi * M_PI / 180.0},
+                .time = {.year = (int16_t)year,
+                         .month = (int8_t)month,
+                         .day = (int8_t)day,
+                         .hour = (int8_t)hour,
+                         .min = (int8_t)min,
+                         .sec = 0},
+            };
 
-/**
- * @brief Get input from the user.
- *
- * @param buffer The buffer to store the input.
- * @param timeout The timeout in microseconds.
- * @param hidden If true, the input is hidden.
- * @return int The number of characters read.
- */
-int Controller::input(std::string &buffer, uint32_t timeout, bool hidden) {
-    char last_c = '\0';
-    bool newline = false;
-    int count = 0;
-
-    while (!newline) {
-        int ch = stdio_getchar_timeout_us(timeout);
-        if (ch == PICO_ERROR_TIMEOUT) {
-            count = -1;
-            newline = true;
-            std::cout << std::endl << "--Timeout--" << std::endl;
+            if (commands.insert(command)) {
+                std::cout << "Command added to queue: " << year << ", " << month << ", " << day << ", "
+                          << hour << ", " << min << ", " << alt << ", " << azi << std::endl;
+            } else {
+                std::cout << "Command queue is full" << std::endl;
+            }
         } else {
-            char c = static_cast<char>(ch);
-            if ((c == '\r' || c == '\n') && last_c != '\r' && last_c != '\n') {
-                last_c = c;
-                newline = true;
-                std::cout << std::endl;
-            } else if (c == '\b') {
-                if (buffer.size() > 0) {
-                    buffer.pop_back();
-                    std::cout << '\b' << ' ' << '\b';
-                    std::cout.flush();
+            std::cout << "Invalid command" << std::endl;
+        }
+    } else if (token == "debug_picture") {
+        int image_id = 0;
+        if (ss >> image_id) {
+            transmit(msg::picture(image_id));
+            std::cout << "Sent picture request: " << image_id << std::endl;
+            config_wait_for_response();
+        } else {
+            std::cout << "No image id specified" << std::endl;
+        }
+    } else if (token == "debug_rec_msg") {
+        std::string msg_str;
+        msg::Message msg;
+        msg::Record rec;
+        if (ss >> msg_str) {
+            if (size_t pos = msg_str.find(';'); pos != std::string::npos) { msg_str.erase(pos); }
+            int rc = msg::convert_to_message(msg_str, msg);
+            if (rc == 0 && msg::to_record(msg, rec) && msg_queue->push(rec)) {
+                std::cout << "Message added to receive queue: " << msg_str << std::endl;
+            } else {
+                std::cout << "Invalid message (" << rc << "): " << msg_str << std::endl;
+            }
+        } else {
+            std::cout << "No message specified" << std::endl;
+        }
+    } else if (token == "debug_send_msg") {
+        msg::Message msg;
+        std::string type_str;
+        if (ss >> type_str) {
+            if (msg.type = msg::verify_message_type(type_str); msg.type != msg::MessageType::UNASSIGNED) {
+                std::vector<std::string> content;
+                std::string content_str;
+                while (ss >> content_str) {
+                    content.push_back(content_str);
                 }
-            } else if (std::isprint(c)) {
-                last_c = c;
-                buffer += c;
-                count++;
-                if (!hidden) {
-                    std::cout << c;
+
+                if (content.size() > 0) {
+                    msg.content = content;
+                    transmit(msg);
+                    std::cout << "Sent message with type " << type_str << std::endl;
+                    config_wait_for_response();
                 } else {
-                    std::cout << '*';
+                    std::cout << "No content specified" << std::endl;
                 }
-                std::cout.flush();
+            } else {
+                std::cout << "Invalid message type" << std::endl;
             }
         }
+    } else if (token == "debug_trace") {
+        int planet;
+        if (ss >> planet) {
+            state = TRACE;
+            trace_object = {static_cast<Planets>(planet)};
+
+            DEBUG("Trace starting. Trace object:");
+            trace_object.print_planet();
+        }
+    }
+#endif
+    else {
+        std::cout << "Invalid command: \"" << token << "\"" << std::endl;
     }
 
-    return count;
+    if (shell_state == SHELL_COMMAND) config_prompt();
 }
 
 /**
@@ -601,26 +895,12 @@ int Controller::input(std::string &buffer, uint32_t timeout, bool hidden) {
  * @param max_sleep_time The maximum sleep time in microseconds.
  */
 void Controller::wait_for_event(absolute_time_t abs_time, int max_sleep_time) {
-    while (!clock->is_alarm_ringing() && !input_detected() &&
+    while (!clock->is_alarm_ringing() && !console.available() &&
            absolute_time_diff_us(abs_time, get_absolute_time()) < max_sleep_time) {
         sleep_ms(50);
     }
 }
 
-/**
- * @brief Check stdio for input.
- *
- * @return bool True if input has been detected. False otherwise.
- */
-bool Controller::input_detected() {
-    const uint32_t INITIAL_TIMEOUT = 5000;
-    if (stdio_getchar_timeout_us(INITIAL_TIMEOUT) != PICO_ERROR_TIMEOUT) {
-        input_received = true;
-        return true;
-    }
-    return false;
-}
-
 /**
  * @brief Enter trace mode.
  * @details This function starts the trace mode in which the Pico traces the orbit of a celestial body.
@@ -678,22 +958,29 @@ void Controller::trace() {
 }
 
 /**
- * @brief Wait for a response from the ESP.
- *
- * @return bool True if a response has been received. False otherwise.
+ * @brief Starts waiting for a response from the ESP.
+ * @details The response is reported by comm_process() when it arrives. The wait can be skipped with any key and
+ * times out after 60 seconds.
  */
-bool Controller::config_wait_for_response() {
+void Controller::config_wait_for_response() {
     std::cout << "Waiting for response from ESP..." << std::endl << "Press any key to skip" << std::endl;
-    uint64_t time = time_us_64();
-    while (time_us_64() - time < 60000000) {
-        if (input_detected()) { return false; }
-        commbridge->read_and_parse(1000, true);
-        if (msg_queue->size() > 0) {
-            comm_process();
-            return true;
-        }
+    shell_state = SHELL_WAIT_RESPONSE;
+    shell_wait_start = time_us_64();
+}
+
+/**
+ * @brief Reports a message received while the config shell is waiting for a response from the ESP.
+ *
+ * @param msg The received message.
+ */
+void Controller::config_response(const msg::Record &msg) {
+    if (msg.type == msg::RESPONSE) {
+        std::cout << "ESP responded with " << (msg.field(0) == "1" ? "ACK" : "NACK") << std::endl;
+    } else {
+        std::cout << "ESP sent message of type " << static_cast<int>(msg.type) << std::endl;
     }
-    return false;
+    shell_state = SHELL_COMMAND;
+    config_prompt();
 }
 
 /**
@@ -703,32 +990,39 @@ bool Controller::config_wait_for_response() {
 void Controller::motor_control() {
     if (now_commands > 0) now_commands--;
     state = SLEEP;
-    if (commands.size() > 0) {
-        int sec_difference = calculate_sec_difference(commands.front().time, clock->get_datetime());
+    command_triggered = false;
+    if (!commands.empty()) {
+        int64_t now = clock->get_epoch();
+        int64_t sec_difference = now - commands.top().epoch;
         if (sec_difference < -(60 * 5)) {
-            clock->add_alarm(commands.front().time);
+            armed_epoch = -1; // Alarm is re-armed by sanitize_commands
             mctrl->off();
             state = SLEEP;
             return;
         } else if (sec_difference > (60 * 5)) {
             DEBUG("Time difference of command and current time was too large (>5 minutes).");
-            send(msg::cmd_status(current_command.id, -3, datetime_to_epoch(clock->get_datetime())));
-            commands.front().time = clock->get_datetime();
+            Command late = commands.pop();
+            send(msg::cmd_status(late.id, -3, now));
+            late.time = clock->get_datetime();
+            commands.insert(late, now);
             mctrl->off();
             state = COMM_READ;
             return;
         } else {
-            current_command = commands.front();
-            commands.erase(commands.begin());
+            target_epoch = commands.top().epoch;
+            current_command = commands.pop();
+            aim_for_shutter(now);
+            DEBUG("Capture planned", shutter_epoch - target_epoch, "seconds after target");
             DEBUG("turning to altitude:", current_command.coords.altitude * 180 / M_PI,
                   "azimuth:", current_command.coords.azimuth * 180 / M_PI);
             mctrl->turn_to_coordinates(current_command.coords);
+            tracer.record(TRACE_MOTOR_START, 0, 0, current_command.id);
             check_motor = true;
             state = MOTOR_WAIT;
         }
     } else {
         DEBUG("Tried to initiate picture taking with empty command vector.");
-        send(msg::diagnostics(2, "Device tried to take picture with no command"));
+        report(2, "Device tried to take picture with no command");
         mctrl->off();
         state = COMM_READ;
     }
@@ -737,26 +1031,83 @@ void Controller::motor_control() {
 /**
  * @brief Send a message to the ESP.
  * @details This function checks if the message is a response and sends it directly to the ESP. Otherwise, it adds the
- * message to the send message queue.
+ * message to the lane of its type in the send message queue, so picture triggers and datetime requests don't wait
+ * behind diagnostics. Command status and diagnostics are also sent to a laptop on the USB link.
  * @param mesg The message to be sent.
  */
 void Controller::send(const msg::Message mesg) {
     if (mesg.type == msg::RESPONSE) {
-        commbridge->send(mesg);
+        transmit(mesg);
+        return;
+    }
+    msg::Record rec;
+    if (!msg::to_record(mesg, rec)) {
+        DEBUG("Message too large for send queue, type:", static_cast<int>(mesg.type));
         return;
     }
-    send_msg_queue.push(mesg);
+    if (usb && (rec.type == msg::CMD_STATUS || rec.type == msg::DIAGNOSTICS) && usb->connected()) { usb->send(rec); }
+    if (!send_msg_queue.push(rec, msg::lane_of(rec.type))) {
+        DEBUG("Send queue full, dropped message of type:", static_cast<int>(mesg.type));
+    }
+}
+
+/**
+ * @brief Transmit a message to the ESP immediately and record it in the trace.
+ *
+ * @param mesg The message to be transmitted.
+ */
+void Controller::transmit(const msg::Message &mesg) {
+    tracer.record(TRACE_MSG_SEND, mesg.type);
+    commbridge->send(mesg);
 }
 
+/**
+ * @brief Transmit a queued message record to the ESP immediately and record it in the trace.
+ *
+ * @param rec The message record to be transmitted.
+ */
+void Controller::transmit(const msg::Record &rec) {
+    tracer.record(TRACE_MSG_SEND, rec.type);
+    commbridge->send(rec);
+}
+
+/**
+ * @brief Reports a diagnostic to the ESP.
+ * @details The diagnostic is collected by the DiagnosticsAggregator and sent in a batch by send_process(), repeats
+ * of it only add to its count.
+ *
+ * @param status Status of the diagnostic: 1 info, 2 warning, 3 error.
+ * @param text The diagnostic.
+ */
+void Controller::report(uint8_t status, std::string_view text) { diagnostics.report(status, text, clock->get_epoch()); }
+
 /**
  * @brief Process the send message queue.
- * @details This function checks if there are any messages in the send message queue and sends them to the ESP
- * unless the Pico is waiting for a response from the ESP.
+ * @details This function sends messages from the send message queue to the ESP unless the Pico is waiting for a
+ * response from the ESP. Messages are taken in lane order, see LaneScheduler. With a sequenced link messages go out
+ * back to back until the link window is full, the link retransmits them until the ESP acknowledges them. A
+ * PICTURE that the ESP doesn't answer in PICTURE_RESPONSE_TIMEOUT_S is given up. Batched diagnostics that are due are
+ * queued first.
  */
 void Controller::send_process() {
-    if (send_msg_queue.size() <= 0) return;
+    if (int64_t now = clock->get_epoch(); diagnostics.due(now)) {
+        msg::Message batch;
+        if (diagnostics.flush(batch, now)) { send(batch); }
+    }
+    if (picture_pending && clock->get_epoch() - picture_epoch > PICTURE_RESPONSE_TIMEOUT_S) {
+        // The PICTURE or its RESPONSE was lost
+        DEBUG("ESP didn't respond to PICTURE");
+        report(2, "ESP didn't respond to PICTURE");
+        picture_pending = false;
+        waiting_for_camera = false;
+        mctrl->off();
+    }
     if (waiting_for_response) return;
-    commbridge->send(send_msg_queue.front());
-    last_sent = send_msg_queue.front().type;
-    send_msg_queue.pop();
+    while (const msg::Record *front = send_msg_queue.front()) {
+        if (!commbridge->can_send()) return;
+        transmit(*front);
+        last_sent = front->type;
+        send_msg_queue.pop();
+        if (last_sent == msg::PICTURE || !commbridge->sequencing()) return;
+    }
 }
@@ -10,153 +10,280 @@
 #define MODE_REG     0x02
 #define DATA_REG     0x03
 
+#define MODE_CONTINUOUS 0x00
+#define OVERFLOW_VALUE  -4096 // Output of a saturated axis
+
 // Conversion from raw value to microteslas (uT)
 #define TO_UT (100.0 / 1090.0)
 
 /**
  * @brief Constructor for Compass class, initializes I2C communication.
  *
- * Sets up I2C pins, configures pull-ups, and initializes compass registers.
+ * Sets up I2C pins, configures pull-ups, puts the compass into continuous-measurement mode and starts sampling it.
+ * A calibration stored in EEPROM is loaded, without one the raw values are used until the compass is calibrated.
  *
  * @param I2C_PORT_VAL Pointer to the I2C instance.
  * @param SCL_PIN_VAL GPIO pin number for SCL.
  * @param SDL_PIN_VAL GPIO pin number for SDA.
+ * @param storage_val Pointer to the Storage the calibration is kept in, nullptr to keep it in RAM only.
  */
-Compass::Compass(i2c_inst_t *I2C_PORT_VAL, uint SCL_PIN_VAL, uint SDL_PIN_VAL)
-    : I2C_PORT(I2C_PORT_VAL), SCL_PIN(SCL_PIN_VAL), SDA_PIN(SDL_PIN_VAL) {
+Compass::Compass(i2c_inst_t *I2C_PORT_VAL, uint SCL_PIN_VAL, uint SDL_PIN_VAL, std::shared_ptr<Storage> storage_val)
+    : I2C_PORT(I2C_PORT_VAL), SCL_PIN(SCL_PIN_VAL), SDA_PIN(SDL_PIN_VAL), storage(storage_val) {
     i2c_init(I2C_PORT, 400000); // 400 kHz
     gpio_set_function(SDA_PIN, GPIO_FUNC_I2C);
     gpio_set_function(SCL_PIN, GPIO_FUNC_I2C);
     gpio_pull_up(SDA_PIN);
     gpio_pull_up(SCL_PIN);
 
-    xRawValueOffset = 0;
-    yRawValueOffset = 0;
-    zRawValueOffset = 0;
+    calibration = {.offset = {0, 0, 0}, .matrix = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}};
+    if (storage && storage->load_calibration(calibration)) {
+        calibrated = true;
+        DEBUG("Loaded compass calibration");
+    }
 
     uint8_t config_a[2] = {CONFIG_A, 0x70}; // Configuration for CONFIG_A
     uint8_t config_b[2] = {CONFIG_B, 0xa0}; // Configuration for CONFIG_B
 
+    uint8_t mode[2] = {MODE_REG, MODE_CONTINUOUS};
+    uint8_t data_reg = DATA_REG;
+
     i2c_write_blocking(I2C_PORT, COMPASS_ADDR, config_a, 2, false);
     i2c_write_blocking(I2C_PORT, COMPASS_ADDR, config_b, 2, false);
+    i2c_write_blocking(I2C_PORT, COMPASS_ADDR, mode, 2, false);
+    // The register pointer returns to the first data register after the last one is read, so it is only set once
+    i2c_write_blocking(I2C_PORT, COMPASS_ADDR, &data_reg, 1, false);
+
+    if (!add_repeating_timer_ms(COMPASS_SAMPLE_PERIOD_MS, sampleCallback, this, &timer)) {
+        DEBUG("Can't start compass sampling");
+    }
 }
 
 /**
- * @brief Reads raw x, y, and z values from the compass sensor.
+ * @brief Destructor for Compass class, stops the sampling timer.
+ */
+Compass::~Compass() { cancel_repeating_timer(&timer); }
+
+/**
+ * @brief Reads a measurement into the sample ring.
  *
- * Communicates with the compass over I2C to retrieve 6 bytes of data
- * representing the raw magnetic field strengths.
+ * Runs in the timer interrupt. A read takes about 200 us at 400 kHz. Failed reads and saturated measurements are
+ * counted and skipped.
  *
- * @param x Reference to store the x-axis raw value.
- * @param y Reference to store the y-axis raw value.
- * @param z Reference to store the z-axis raw value.
+ * @param timer The repeating timer, its user data is the Compass.
+ * @return bool Always true to keep the timer running.
  */
-void Compass::readRawData(int16_t &x, int16_t &y, int16_t &z) {
-    uint8_t buf[2] = {MODE_REG, CONFIG_B};
+bool Compass::sampleCallback(repeating_timer_t *timer) {
+    Compass *compass = static_cast<Compass *>(timer->user_data);
     uint8_t data[6];
-    int ret = i2c_write_timeout_us(I2C_PORT, COMPASS_ADDR, buf, 2, false, 10000);
-    if (ret == PICO_ERROR_TIMEOUT || ret == PICO_ERROR_GENERIC) {
-        DEBUG("Can't read compass");
-        return;
-    }
-    sleep_ms(10);
-
-    // Request data
-    buf[0] = DATA_REG;
-    ret = i2c_write_timeout_us(I2C_PORT, COMPASS_ADDR, buf, 1, false, 10000);
-    if (ret == PICO_ERROR_TIMEOUT || ret == PICO_ERROR_GENERIC) {
-        DEBUG("Can't read compass");
-        return;
+    if (i2c_read_timeout_us(compass->I2C_PORT, COMPASS_ADDR, data, 6, false, 1000) != 6) {
+        compass->readErrors = compass->readErrors + 1;
+        return true;
     }
-    sleep_ms(10);
-    ret = i2c_read_timeout_us(I2C_PORT, COMPASS_ADDR, data, 6, false, 10000);
-    if (ret == PICO_ERROR_TIMEOUT || ret == PICO_ERROR_GENERIC) {
-        DEBUG("Can't read compass");
-        return;
+
+    // Combine high and low bytes, the registers are in the order x, z, y
+    CompassSample sample = {.x = static_cast<int16_t>(data[0] << 8 | data[1]),
+                            .y = static_cast<int16_t>(data[4] << 8 | data[5]),
+                            .z = static_cast<int16_t>(data[2] << 8 | data[3])};
+    if (sample.x == OVERFLOW_VALUE || sample.y == OVERFLOW_VALUE || sample.z == OVERFLOW_VALUE) {
+        compass->readErrors = compass->readErrors + 1;
+        return true;
     }
 
-    // Combine high and low bytes
-    x = ((int16_t)data[0] << 8) | data[1];
-    z = ((int16_t)data[2] << 8) | data[3];
-    y = ((int16_t)data[4] << 8) | data[5];
+    compass->samples[compass->sampleHead] = sample;
+    compass->sampleHead = (compass->sampleHead + 1) % COMPASS_SAMPLES;
+    if (compass->sampleCount < COMPASS_SAMPLES) compass->sampleCount = compass->sampleCount + 1;
+    return true;
 }
 
 /**
- * @brief Calibrates the compass by determining offsets for x, y, and z axes.
+ * @brief Copies the sample ring, newest sample first.
  *
- * The function repeatedly measures raw values and determines the min/max
- * values to calculate offsets, ensuring more accurate readings.
+ * @param out Array of COMPASS_SAMPLES samples to store the copy.
+ * @return int Number of samples copied.
  */
-void Compass::calibrate() {
-    CalibrationMaxValue maxValue = {0, 0, 0};
-    CalibrationMinValue minValue = {0, 0, 0};
-
-    int xCount = 0;
-    int yCount = 0;
-    int zCount = 0;
-    bool xRotationFlag = false;
-    bool yRotationFlag = false;
-    bool zRotationFlag = false;
+int Compass::copySamples(CompassSample *out) {
+    uint32_t irq_state = save_and_disable_interrupts();
+    int count = sampleCount;
+    for (int i = 0; i < count; ++i) {
+        out[i] = samples[(sampleHead + COMPASS_SAMPLES - 1 - i) % COMPASS_SAMPLES];
+    }
+    restore_interrupts(irq_state);
+    return count;
+}
 
-    int16_t x, y, z;
+/**
+ * @brief Returns the latest raw x, y, and z values from the compass sensor.
+ *
+ * Takes the newest sample of the ring without waiting for the sensor.
+ *
+ * @param x Reference to store the x-axis raw value.
+ * @param y Reference to store the y-axis raw value.
+ * @param z Reference to store the z-axis raw value.
+ * @return bool True if a sample was available.
+ */
+bool Compass::readRawData(int16_t &x, int16_t &y, int16_t &z) {
+    CompassSample latest[COMPASS_SAMPLES];
+    if (copySamples(latest) == 0) {
+        DEBUG("Can't read compass, errors:", readErrors);
+        return false;
+    }
+    x = latest[0].x;
+    y = latest[0].y;
+    z = latest[0].z;
+    return true;
+}
 
+/**
+ * @brief Starts calibrating the compass with an ellipsoid fit.
+ *
+ * The compass must be rotated through all orientations until each axis has swung past zero three times. Samples are
+ * collected by pollCalibration() while it is rotated and an ellipsoid is fitted to them. Its center is the hard-iron
+ * offset and the matrix that maps it back to a sphere corrects the soft-iron distortion. The result is stored in
+ * EEPROM.
+ */
+void Compass::startCalibration() {
     DEBUG("Calibrate the compass");
+    calibrationCount = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        axisCrossings[axis] = 0;
+        nearZero[axis] = false;
+    }
+    calibrationStart = time_us_64();
+    lastCalibrationPoll = 0;
+    calibrating = true;
+}
 
-    while (xCount < 3 || yCount < 3 || zCount < 3) {
-        readRawData(x, y, z);
-        if ((std::fabs(x) > 600) || (std::fabs(y) > 600) || (std::fabs(z) > 600)) continue;
+/**
+ * @brief Advances a calibration started with startCalibration().
+ *
+ * Takes at most one sample per COMPASS_SAMPLE_PERIOD_MS and returns right away, so it can be called on every pass of
+ * the main loop. The fit runs once the compass has been rotated enough.
+ *
+ * @return CalibrationStatus RUNNING until the calibration ends, then DONE or FAILED once and IDLE afterwards. The
+ * previous calibration is kept on failure.
+ */
+Compass::CalibrationStatus Compass::pollCalibration() {
+    if (!calibrating) return CalibrationStatus::IDLE;
 
-        if (minValue.X > x) minValue.X = x;
-        else if (maxValue.X < x) maxValue.X = x;
+    uint64_t now = time_us_64();
+    if (now - calibrationStart > COMPASS_CALIBRATION_TIMEOUT_S * 1000000ull) {
+        DEBUG("Compass calibration timed out");
+        calibrating = false;
+        return CalibrationStatus::FAILED;
+    }
+    if (now - lastCalibrationPoll < COMPASS_SAMPLE_PERIOD_MS * 1000ull) return CalibrationStatus::RUNNING;
+    lastCalibrationPoll = now;
+
+    int16_t x, y, z;
+    if (readRawData(x, y, z)) collectCalibrationSample(x, y, z);
+    if (!rotatedEnough()) return CalibrationStatus::RUNNING;
+    calibrating = false;
 
-        if (minValue.Y > y) minValue.Y = y;
-        else if (maxValue.Y < y) maxValue.Y = y;
+    CompassCalibration result;
+    if (!fit_ellipsoid(calibrationPoints, calibrationCount, result)) {
+        DEBUG("Compass calibration failed, the samples don't form an ellipsoid");
+        return CalibrationStatus::FAILED;
+    }
 
-        if (minValue.Z > z) minValue.Z = z;
-        else if (maxValue.Z < z) maxValue.Z = z;
+    calibration = result;
+    calibrated = true;
+    if (storage && !storage->store_calibration(result)) { DEBUG("Failed to store compass calibration"); }
 
-        if (xRotationFlag) {
-            if (std::fabs(x) > 50) { xRotationFlag = false; xCount++; }
-        } else if (std::fabs(x) < 40) { xRotationFlag = true; }
+    DEBUG("Calibration done");
+    return CalibrationStatus::DONE;
+}
 
-        if (yRotationFlag) {
-            if (std::fabs(y) > 50) { yRotationFlag = false; yCount++; }
-        } else if (std::fabs(y) < 40) { yRotationFlag = true; }
+/**
+ * @brief Stops a calibration in progress, the previous calibration is kept.
+ */
+void Compass::cancelCalibration() { calibrating = false; }
 
-        if (zRotationFlag) {
-            if (std::fabs(z) > 50) { zRotationFlag = false; zCount++; }
-        } else if (std::fabs(z) < 40) { zRotationFlag = true; }
+/**
+ * @brief Adds a raw sample to the calibration and counts the zero crossings of each axis.
+ *
+ * Samples closer than COMPASS_CALIBRATION_SPACING to the previous one are only used to count the crossings.
+ *
+ * @param x Raw x-axis value.
+ * @param y Raw y-axis value.
+ * @param z Raw z-axis value.
+ */
+void Compass::collectCalibrationSample(int16_t x, int16_t y, int16_t z) {
+    if ((std::abs(x) > 600) || (std::abs(y) > 600) || (std::abs(z) > 600)) return;
 
-        sleep_ms(30);
+    const CompassSample *last = calibrationCount > 0 ? &calibrationPoints[calibrationCount - 1] : nullptr;
+    if (last == nullptr || std::hypot(x - last->x, y - last->y, z - last->z) >= COMPASS_CALIBRATION_SPACING) {
+        // When full, every other sample makes room so the collection still covers the whole rotation
+        if (calibrationCount == COMPASS_CALIBRATION_SAMPLES) {
+            for (int i = 0; i < calibrationCount / 2; ++i) {
+                calibrationPoints[i] = calibrationPoints[2 * i];
+            }
+            calibrationCount /= 2;
+        }
+        calibrationPoints[calibrationCount++] = {x, y, z};
     }
 
-    xRawValueOffset = (maxValue.X + minValue.X) / 2;
-    yRawValueOffset = (maxValue.Y + minValue.Y) / 2;
-    zRawValueOffset = (maxValue.Z + minValue.Z) / 2;
+    const int16_t values[3] = {x, y, z};
+    for (int axis = 0; axis < 3; ++axis) {
+        if (nearZero[axis]) {
+            if (std::abs(values[axis]) > 50) {
+                nearZero[axis] = false;
+                axisCrossings[axis]++;
+            }
+        } else if (std::abs(values[axis]) < 40) {
+            nearZero[axis] = true;
+        }
+    }
+}
 
-    DEBUG("Calibration done");
+/**
+ * @brief Checks whether enough samples were collected for the fit.
+ *
+ * @return bool True if each axis swung past zero three times and half of the sample buffer is filled.
+ */
+bool Compass::rotatedEnough() const {
+    for (int crossings : axisCrossings) {
+        if (crossings < 3) return false;
+    }
+    return calibrationCount >= COMPASS_CALIBRATION_SAMPLES / 2;
 }
 
+/**
+ * @brief Checks whether the compass has a calibration.
+ *
+ * @return bool True if a calibration was loaded or a calibration succeeded.
+ */
+bool Compass::isCalibrated() const { return calibrated; }
+
 /**
  * @brief Computes and returns the compass heading in degrees.
  *
- * Uses the raw x and y values to determine the direction the compass is pointing,
- * factoring in a declination angle specific to the location.
+ * The samples are corrected with the calibration and the heading is the circular mean of their headings, so the wrap
+ * at north doesn't skew it, factoring in a declination angle specific to the location. Doesn't block.
  *
- * @return float The heading in degrees (0-360).
+ * @return float The heading in degrees (0-360), NAN if the compass hasn't been sampled yet.
  */
 float Compass::getHeading() {
-    int16_t x, y, z;
-    readRawData(x, y, z);
-
-    x -= xRawValueOffset;
-    y -= yRawValueOffset;
-    z -= zRawValueOffset;
+    CompassSample ring[COMPASS_SAMPLES];
+    int count = copySamples(ring);
+    if (count == 0) {
+        DEBUG("Can't read compass, errors:", readErrors);
+        return NAN;
+    }
 
-    float x_uT = x * TO_UT;
-    float y_uT = y * TO_UT;
+    float sinSum = 0;
+    float cosSum = 0;
+    for (int i = 0; i < count; ++i) {
+        float raw[3] = {ring[i].x - calibration.offset[0], ring[i].y - calibration.offset[1],
+                        ring[i].z - calibration.offset[2]};
+        const float(&m)[3][3] = calibration.matrix;
+        float x_uT = (m[0][0] * raw[0] + m[0][1] * raw[1] + m[0][2] * raw[2]) * TO_UT;
+        float y_uT = (m[1][0] * raw[0] + m[1][1] * raw[1] + m[1][2] * raw[2]) * TO_UT;
+        float angle = atan2(y_uT, x_uT);
+        sinSum += sin(angle);
+        cosSum += cos(angle);
+    }
 
-    float heading = atan2(y_uT, x_uT);
+    float heading = atan2(sinSum, cosSum);
     float declinationAngle = 0.18;
     heading += declinationAngle;
 
@@ -3,7 +3,10 @@
 #define BAUD_RATE          1000000
 #define WRITE_CYCLE_MAX_MS 10
 #define EEPROM_SIZE        32768
+#define EEPROM_PAGE_SIZE   64
 #define START_ADDR         0
+#define FIX_ADDR           (EEPROM_SIZE - EEPROM_PAGE_SIZE)     // Last page holds the GPS fix
+#define CALIBRATION_ADDR   (EEPROM_SIZE - 2 * EEPROM_PAGE_SIZE) // Compass calibration, commands use the pages before
 
 #include "debug.hpp"
 
@@ -39,7 +42,7 @@ bool Storage::store_command(Command &command) {
         sleep_ms(10);
         if (buffer[sizeof(Command)] != 1) { break; }
         page += 64;
-        if (page == EEPROM_SIZE) { return false; }
+        if (page == CALIBRATION_ADDR) { return false; }
     }
 
     return write(command, page);
@@ -77,7 +80,7 @@ bool Storage::get_command(Command &command, uint64_t id) {
         }
 
         page += 64;
-        if (page == EEPROM_SIZE) { return false; }
+        if (page == CALIBRATION_ADDR) { return false; }
     }
     return false;
 }
@@ -104,6 +107,114 @@ bool Storage::write(Command &command, uint addr) {
     return write_page(addr, buffer, sizeof(buffer));
 }
 
+/**
+ * @brief Writes data to one EEPROM page.
+ *
+ * @param address The EEPROM address to write to.
+ * @param data The data to write.
+ * @param size Number of bytes to write.
+ *
+ * @return bool Returns true if the data was written, false if it would cross a page boundary.
+ */
+bool Storage::write_page(uint16_t address, const uint8_t *data, size_t size) {
+    if (address % EEPROM_PAGE_SIZE + size > EEPROM_PAGE_SIZE) { return false; }
+    eeprom_write_page(i2c, address, const_cast<uint8_t *>(data), size);
+    return true;
+}
+
+/**
+ * @brief Stores the last good GPS fix.
+ *
+ * The fix is kept in the last EEPROM page, the previous fix is overwritten.
+ *
+ * @param fix The fix to store.
+ *
+ * @return bool Returns true if the fix was written.
+ */
+bool Storage::store_fix(const GpsFix &fix) {
+    return write_record(FIX_ADDR, reinterpret_cast<const uint8_t *>(&fix), sizeof(GpsFix));
+}
+
+/**
+ * @brief Loads the stored GPS fix.
+ *
+ * @param fix The fix object to store the retrieved data.
+ *
+ * @return bool Returns true if a fix is stored and its checksum matches, false otherwise.
+ */
+bool Storage::load_fix(GpsFix &fix) { return read_record(FIX_ADDR, reinterpret_cast<uint8_t *>(&fix), sizeof(GpsFix)); }
+
+/**
+ * @brief Stores the compass calibration.
+ *
+ * @param calibration The calibration to store.
+ *
+ * @return bool Returns true if the calibration was written.
+ */
+bool Storage::store_calibration(const CompassCalibration &calibration) {
+    return write_record(CALIBRATION_ADDR, reinterpret_cast<const uint8_t *>(&calibration), sizeof(CompassCalibration));
+}
+
+/**
+ * @brief Loads the stored compass calibration.
+ *
+ * @param calibration The calibration object to store the retrieved data.
+ *
+ * @return bool Returns true if a calibration is stored and its checksum matches, false otherwise.
+ */
+bool Storage::load_calibration(CompassCalibration &calibration) {
+    return read_record(CALIBRATION_ADDR, reinterpret_cast<uint8_t *>(&calibration), sizeof(CompassCalibration));
+}
+
+/**
+ * @brief Writes a record to one EEPROM page.
+ *
+ * The record is followed by a valid flag and a CRC16 checksum, like a stored command.
+ *
+ * @param addr The EEPROM address of the page.
+ * @param data The record to write.
+ * @param size Size of the record, at most a page minus 3 bytes.
+ *
+ * @return bool Returns true if the record was written.
+ */
+bool Storage::write_record(uint16_t addr, const uint8_t *data, size_t size) {
+    uint8_t buffer[EEPROM_PAGE_SIZE];
+    if (size + 3 > sizeof(buffer)) { return false; }
+    memcpy(buffer, data, size);
+    buffer[size] = 1;
+
+    uint16_t crc = crc16(buffer, size);
+    buffer[size + 1] = crc >> 8;
+    buffer[size + 2] = crc & 0xFF;
+
+    return write_page(addr, buffer, size + 3);
+}
+
+/**
+ * @brief Reads a record written by write_record().
+ *
+ * @param addr The EEPROM address of the page.
+ * @param data Buffer to store the record.
+ * @param size Size of the record.
+ *
+ * @return bool Returns true if a record is stored and its checksum matches, false otherwise.
+ */
+bool Storage::read_record(uint16_t addr, uint8_t *data, size_t size) {
+    uint8_t buffer[EEPROM_PAGE_SIZE];
+    if (size + 3 > sizeof(buffer)) { return false; }
+    eeprom_read_page(i2c, addr, buffer, size + 3);
+
+    if (buffer[size] != 1) { return false; }
+    uint16_t stored_crc = (buffer[size + 1] << 8) | buffer[size + 2];
+    if (stored_crc != crc16(buffer, size)) {
+        DEBUG("Checksum of the record at", addr, "doesn't match");
+        return false;
+    }
+
+    memcpy(data, buffer, size);
+    return true;
+}
+
 /**
  * @brief Clears the entire EEPROM memory.
  *
@@ -0,0 +1,158 @@
+/**
+ * @file ellipsoid-fit.cpp
+ * @brief Implementation of the ellipsoid fit used to calibrate the compass.
+ */
+
+#include "ellipsoid-fit.hpp"
+
+#include <cmath>
+#include <utility>
+
+/**
+ * @brief Fits an ellipsoid to raw samples.
+ *
+ * Solves ax^2 + by^2 + cz^2 + 2fyz + 2gxz + 2hxy + 2px + 2qy + 2rz = 1 in the least squares sense. With the quadric
+ * matrix A and the linear terms v the center is -A^-1 v. A scaled by the value of the equation at the center maps the
+ * ellipsoid to a unit sphere, its symmetric square root is the soft-iron matrix. The matrix is scaled by the mean
+ * radius so corrected samples keep their magnitude. The samples are centered before the fit for numerical stability.
+ *
+ * @param points The samples.
+ * @param count Number of samples, at least 9 are needed.
+ * @param result Reference to store the calibration.
+ * @return bool True if the fit is an ellipsoid, false if it is degenerate.
+ */
+bool fit_ellipsoid(const CompassSample *points, int count, CompassCalibration &result) {
+    if (count < 9) return false;
+
+    double mean[3] = {0, 0, 0};
+    for (int i = 0; i < count; ++i) {
+        mean[0] += points[i].x;
+        mean[1] += points[i].y;
+        mean[2] += points[i].z;
+    }
+    for (double &m : mean) {
+        m /= count;
+    }
+
+    // Normal equations of the least squares problem, the last column is the right hand side
+    double n[9][10] = {};
+    for (int i = 0; i < count; ++i) {
+        double x = points[i].x - mean[0], y = points[i].y - mean[1], z = points[i].z - mean[2];
+        double row[9] = {x * x, y * y, z * z, 2 * y * z, 2 * x * z, 2 * x * y, 2 * x, 2 * y, 2 * z};
+        for (int r = 0; r < 9; ++r) {
+            for (int c = 0; c < 9; ++c) {
+                n[r][c] += row[r] * row[c];
+            }
+            n[r][9] += row[r];
+        }
+    }
+
+    // Gaussian elimination with partial pivoting
+    for (int col = 0; col < 9; ++col) {
+        int pivot = col;
+        for (int r = col + 1; r < 9; ++r) {
+            if (std::fabs(n[r][col]) > std::fabs(n[pivot][col])) pivot = r;
+        }
+        if (std::fabs(n[pivot][col]) < 1e-12) return false;
+        for (int c = 0; c < 10; ++c) {
+            std::swap(n[col][c], n[pivot][c]);
+        }
+        for (int r = 0; r < 9; ++r) {
+            if (r == col) continue;
+            double factor = n[r][col] / n[col][col];
+            for (int c = col; c < 10; ++c) {
+                n[r][c] -= factor * n[col][c];
+            }
+        }
+    }
+    double k[9];
+    for (int i = 0; i < 9; ++i) {
+        k[i] = n[i][9] / n[i][i];
+    }
+
+    double a[3][3] = {{k[0], k[5], k[4]}, {k[5], k[1], k[3]}, {k[4], k[3], k[2]}};
+    double v[3] = {k[6], k[7], k[8]};
+
+    // Center: solve a * center = -v with Cramer's rule
+    double det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) - a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+                 a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+    if (std::fabs(det) < 1e-30) return false;
+    double center[3];
+    for (int i = 0; i < 3; ++i) {
+        double m[3][3];
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) {
+                m[r][c] = c == i ? -v[r] : a[r][c];
+            }
+        }
+        center[i] = (m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                     m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                     m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0])) /
+                    det;
+    }
+
+    // (p - center)^T a (p - center) = 1 + center^T a center
+    double scale = 1;
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            scale += center[r] * a[r][c] * center[c];
+        }
+    }
+    if (scale <= 0) return false;
+
+    // Eigen decomposition of the normalized matrix with Jacobi rotations
+    double e[3][3], vec[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            e[r][c] = a[r][c] / scale;
+        }
+    }
+    for (int sweep = 0; sweep < 50; ++sweep) {
+        double off = e[0][1] * e[0][1] + e[0][2] * e[0][2] + e[1][2] * e[1][2];
+        if (off < 1e-30) break;
+        for (int p = 0; p < 2; ++p) {
+            for (int q = p + 1; q < 3; ++q) {
+                if (e[p][q] == 0) continue;
+                double theta = (e[q][q] - e[p][p]) / (2 * e[p][q]);
+                double t = (theta >= 0 ? 1 : -1) / (std::fabs(theta) + std::sqrt(theta * theta + 1));
+                double c = 1 / std::sqrt(t * t + 1), s = t * c;
+                for (int i = 0; i < 3; ++i) {
+                    double eip = e[i][p], eiq = e[i][q];
+                    e[i][p] = c * eip - s * eiq;
+                    e[i][q] = s * eip + c * eiq;
+                }
+                for (int i = 0; i < 3; ++i) {
+                    double epi = e[p][i], eqi = e[q][i];
+                    e[p][i] = c * epi - s * eqi;
+                    e[q][i] = s * epi + c * eqi;
+                }
+                for (int i = 0; i < 3; ++i) {
+                    double vip = vec[i][p], viq = vec[i][q];
+                    vec[i][p] = c * vip - s * viq;
+                    vec[i][q] = s * vip + c * viq;
+                }
+            }
+        }
+    }
+
+    // Square root of the matrix, scaled by the geometric mean of the radii
+    double root[3];
+    double radius = 1;
+    for (int i = 0; i < 3; ++i) {
+        if (e[i][i] <= 0) return false; // Not an ellipsoid
+        root[i] = std::sqrt(e[i][i]);
+        radius /= root[i];
+    }
+    radius = std::cbrt(radius);
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            double sum = 0;
+            for (int i = 0; i < 3; ++i) {
+                sum += vec[r][i] * root[i] * vec[c][i];
+            }
+            result.matrix[r][c] = static_cast<float>(sum * radius);
+        }
+        result.offset[r] = static_cast<float>(center[r] + mean[r]);
+    }
+    return true;
+}
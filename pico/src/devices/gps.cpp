@@ -1,5 +1,7 @@
 #include "gps.hpp"
 
+#include "convert.hpp"
+#include "date_utils.hpp"
 #include "debug.hpp"
 
 /**
@@ -19,21 +21,17 @@ GPS::GPS(std::shared_ptr<PicoUart> uart, bool gpgga_on, bool gpgll_on) : gpgga(g
 
 /**
  * @brief Attempts to locate the GPS position.
+ * @details Received bytes are parsed straight from the UART receive buffer.
  * @param timeout_s Timeout in seconds.
  * @return Status of GPS fix (1 if successful, 0 otherwise).
  */
 int GPS::locate_position(uint16_t timeout_s) {
     uint64_t time = time_us_64();
     int empty_reads = 0;
-    uint8_t read_buffer[256] = {0};
 
     do {
-        uart->read(read_buffer, sizeof(read_buffer));
-        if (read_buffer[0] != 0) {
-            std::string str_buffer((char *)read_buffer);
-            parse_output(std::move(str_buffer));
+        if (poll() > 0) {
             empty_reads = 0;
-            std::fill_n(read_buffer, sizeof(read_buffer), 0);
         } else {
             empty_reads++;
             if (empty_reads % 10 == 0) { DEBUG("Reading nothing from GPS, is it connected?"); }
@@ -45,64 +43,46 @@ int GPS::locate_position(uint16_t timeout_s) {
 }
 
 /**
- * @brief Tries to parse an NMEA message from the GPS output.
- * @param output The raw GPS output.
- * @return 0 when done.
- * @note All messages are stored in gps_sentence variable. Incomplete messages can be continued in the next call.
+ * @brief Parses the GPS output received so far without waiting for more.
+ * @return Number of bytes parsed.
  */
-int GPS::parse_output(std::string output) {
-    while (!output.empty()) {
-        switch (sentence_state) {
-            case SentenceState::EMPTY:
-                if (size_t pos = output.find("$"); pos != std::string::npos) { output.erase(0, pos); }
+size_t GPS::poll() {
+    size_t count = 0;
+    for (std::span<const uint8_t> region = uart->peek(); !region.empty(); region = uart->peek()) {
+        parse_output(region);
+        uart->consume(region.size());
+        count += region.size();
+    }
+    return count;
+}
 
-                if (size_t pos = output.find("\n"); pos != std::string::npos) {
-                    gps_sentence = output.substr(0, pos);
-                    gps_sentence.erase(std::remove_if(gps_sentence.begin(), gps_sentence.end(), ::isspace),
-                                       gps_sentence.end());
-                    output.erase(0, pos + 1);
-                    sentence_state = SentenceState::COMPLETE;
-                    break;
-                } else {
-                    gps_sentence = output;
-                    output.clear();
-                    sentence_state = SentenceState::INCOMPLETE;
-                    break;
-                }
-            case SentenceState::INCOMPLETE:
-                if (size_t pos = output.find("\n"); pos != std::string::npos) {
-                    gps_sentence += output.substr(0, pos);
-                    gps_sentence.erase(std::remove_if(gps_sentence.begin(), gps_sentence.end(), ::isspace),
-                                       gps_sentence.end());
-                    output.erase(0, pos + 1);
-                    sentence_state = SentenceState::COMPLETE;
-                } else {
-                    gps_sentence += output;
-                    output.clear();
-                    break;
-                }
-            case SentenceState::COMPLETE:
-                if (gpgga && gps_sentence.find("$GPGGA") != std::string::npos) {
-                    DEBUG(gps_sentence);
-                    if (parse_gpgga() == 0) { status = true; }
-                } else if (gpgll && gps_sentence.find("$GPGLL") != std::string::npos) {
-                    DEBUG(gps_sentence);
-                    if (parse_gpgll() == 0) { status = true; }
-                } else if (gps_sentence.find("$PMTK") != std::string::npos) {
-                    DEBUG(gps_sentence);
-                } else if (gps_sentence.find("$PQ") != std::string::npos) {
-                    DEBUG(gps_sentence);
+/**
+ * @brief Feeds GPS output to the NMEA parser.
+ * @param output The received bytes.
+ * @return The number of sentences that updated the position.
+ * @note A partial sentence is kept by the parser and continued in the next call.
+ */
+int GPS::parse_output(std::span<const uint8_t> output) {
+    int fixes = 0;
+    for (uint8_t c : output) {
+        switch (nmea.feed(c)) {
+            case NmeaParser::SENTENCE:
+                if (parse_sentence() == 0) {
+                    status = true;
+                    if (quality == 0) { quality = 1; }
+                    fix_count++;
+                    fixes++;
                 }
-                gps_sentence.clear();
-                sentence_state = SentenceState::EMPTY;
                 break;
-            default:
-                DEBUG("Unknown sentence state");
+            case NmeaParser::INVALID:
+                DEBUG("Invalid NMEA sentence, rejected so far:", nmea.errors());
+                break;
+            case NmeaParser::NONE:
                 break;
         }
     }
 
-    return 0;
+    return fixes;
 }
 
 /**
@@ -111,6 +91,31 @@ int GPS::parse_output(std::string output) {
  */
 Coordinates GPS::get_coordinates() const { return Coordinates{latitude, longitude, status}; }
 
+/**
+ * @brief Retrieves the last position with its quality.
+ * @return GpsFix with the time left at 0, the GPS only knows the time of fixes from GPRMC sentences.
+ */
+GpsFix GPS::get_fix() const { return GpsFix{latitude, longitude, 0, quality, satellites}; }
+
+/**
+ * @brief Returns the number of sentences that updated the position since boot.
+ * @return Fix count, a change means a new fix.
+ */
+uint32_t GPS::fixes() const { return fix_count; }
+
+/**
+ * @brief Retrieves the current UTC time from the last GPRMC sentence.
+ * @details The time of the sentence is advanced by the time since it was received. The GPS sends the sentence within
+ * a second of the time in it, so the result is accurate to about a second.
+ * @param timestamp Reference to store the Unix timestamp.
+ * @return True if a GPRMC sentence with a valid fix has been received.
+ */
+bool GPS::get_utc(time_t &timestamp) const {
+    if (utc == 0) return false;
+    timestamp = utc + static_cast<time_t>((time_us_64() - utc_us) / 1000000);
+    return true;
+}
+
 /**
  * @brief Sets the GPS mode.
  * @param mode The desired GPS mode.
@@ -136,6 +141,7 @@ GPS::Mode GPS::get_mode() const { return current_mode; }
 
 /**
  * @brief Sets the GPS coordinates.
+ * @details Used for coordinates that don't come from the GPS, the quality is reset until the next fix.
  * @param lat The latitude.
  * @param lon The longitude.
  */
@@ -143,152 +149,107 @@ void GPS::set_coordinates(double lat, double lon) {
     latitude = lat;
     longitude = lon;
     status = true;
+    quality = 0;
+    satellites = 0;
 }
 
 /**
- * @brief Parses GPGGA sentence.
- * @return 0 on success, error code otherwise.
+ * @brief Handles the sentence received by the NMEA parser.
+ * @details GPGGA and GPGLL sentences update the position if they are enabled and report a valid fix. GPRMC sentences
+ * with a valid fix update the UTC time and the position.
+ * @return 0 if the position was updated, error code otherwise.
  */
-int GPS::parse_gpgga() {
-    std::stringstream ss(gps_sentence);
-    std::string token;
-    std::getline(ss, token, ','); // Message ID
-    if (token != "$GPGGA") {
-        DEBUG("Not a GPGGA sentence");
-        return 1;
-    }
-
-    std::getline(ss, token, ','); // UTC time - not used for anything
-
-    std::string nmea_latitude;
-    std::getline(ss, nmea_latitude, ',');
-    if (nmea_latitude.empty()) {
-        DEBUG("Missing latitude");
-        return 2;
-    }
-    std::string ns_indicator;
-    std::getline(ss, ns_indicator, ',');
-    if (ns_indicator.empty()) {
-        DEBUG("Missing NS indicator");
-        return 2;
-    }
-    if (nmea_to_decimal_deg(nmea_latitude, ns_indicator) != 0) {
-        DEBUG("Couldn't convert latitude to decimal degrees");
-        return 2;
+int GPS::parse_sentence() {
+    std::string_view address = nmea.field(0);
+    if (gpgga && address == "GPGGA") {
+        // Time, latitude, N/S, longitude, E/W, fix quality, ...
+        uint32_t fix_quality = 0, used = 0;
+        if (!to_int(nmea.field(6), fix_quality) || fix_quality == 0) {
+            DEBUG("GPGGA without a fix");
+            return 1;
+        }
+        if (int rc = parse_position(2); rc != 0) return rc;
+        quality = static_cast<uint8_t>(fix_quality);
+        satellites = to_int(nmea.field(7), used) ? static_cast<uint8_t>(used) : 0;
+        return 0;
     }
-
-    std::string nmea_longitude;
-    std::getline(ss, nmea_longitude, ',');
-    if (nmea_longitude.empty()) {
-        DEBUG("Missing longitude");
-        return 3;
+    if (gpgll && address == "GPGLL") {
+        // Latitude, N/S, longitude, E/W, time, status
+        if (nmea.field(6) != "A") {
+            DEBUG("GPGLL without a fix");
+            return 1;
+        }
+        return parse_position(1);
     }
-    std::string ew_indicator;
-    std::getline(ss, ew_indicator, ',');
-    if (ew_indicator.empty()) {
-        DEBUG("Missing EW indicator");
-        return 3;
+    if (address == "GPRMC") {
+        // Time, status, latitude, N/S, longitude, E/W, speed, course, date, ...
+        if (nmea.field(2) != "A") {
+            DEBUG("GPRMC without a fix");
+            return 1;
+        }
+        if (parse_utc(nmea.field(1), nmea.field(9)) != 0) {
+            DEBUG("Invalid GPRMC time");
+            return 4;
+        }
+        return parse_position(3);
     }
-    if (nmea_to_decimal_deg(nmea_longitude, ew_indicator) != 0) {
-        DEBUG("Couldn't convert longitude to decimal degrees");
-        return 3;
-    };
-
-    // GPGGA also has a bunch of other stuff we don't need
-    // std::getline(ss, token, ','); // Quality
-    // std::getline(ss, token, ','); // Number of satellites
-    // std::getline(ss, token, ','); // Horizontal dilution of precision
-    // std::getline(ss, token, ','); // Altitude
-    // std::getline(ss, token, ','); // Altitude units
-    // std::getline(ss, token, ','); // Undulation
-    // std::getline(ss, token, ','); // Undulation units
-    // std::getline(ss, token, ','); // Age of differential GPS data
-    // std::getline(ss, token, ','); // Differential reference station ID and checksum
-
-    return 0;
+    if (address.starts_with("PMTK") || address.starts_with("PQ")) { DEBUG("GPS response:", address, nmea.field(1)); }
+    return 1;
 }
 
 /**
- * @brief Parses GPGLL sentence.
- * @return 0 on success, error code otherwise.
+ * @brief Updates the position from the coordinate fields of the sentence.
+ * @param index Index of the latitude field, followed by N/S, longitude and E/W.
+ * @return 0 on success, 2 for an invalid latitude and 3 for an invalid longitude.
  */
-int GPS::parse_gpgll() {
-    std::stringstream ss(gps_sentence);
-    std::string token;
-    std::getline(ss, token, ','); // Message ID
-    if (token != "$GPGLL") {
-        DEBUG("Not a GPGLL sentence");
-        return 1;
-    }
-
-    std::string nmea_latitude;
-    std::getline(ss, nmea_latitude, ',');
-    if (nmea_latitude.empty()) {
-        DEBUG("Missing latitude");
-        return 2;
-    }
-    std::string ns_indicator;
-    std::getline(ss, ns_indicator, ',');
-    if (ns_indicator.empty()) {
-        DEBUG("Missing NS indicator");
-        return 2;
-    }
-    if (nmea_to_decimal_deg(nmea_latitude, ns_indicator) != 0) {
-        DEBUG("Couldn't convert latitude to decimal degrees");
+int GPS::parse_position(size_t index) {
+    int32_t lat, lon;
+    if (!nmea_to_fixed(nmea.field(index), nmea.field(index + 1), lat) ||
+        (nmea.field(index + 1) != "N" && nmea.field(index + 1) != "S")) {
+        DEBUG("Invalid latitude");
         return 2;
     }
-
-    std::string nmea_longitude;
-    std::getline(ss, nmea_longitude, ',');
-    if (nmea_longitude.empty()) {
-        DEBUG("Missing longitude");
-        return 3;
-    }
-    std::string ew_indicator;
-    std::getline(ss, ew_indicator, ',');
-    if (ew_indicator.empty()) {
-        DEBUG("Missing EW indicator");
+    if (!nmea_to_fixed(nmea.field(index + 2), nmea.field(index + 3), lon) ||
+        (nmea.field(index + 3) != "E" && nmea.field(index + 3) != "W")) {
+        DEBUG("Invalid longitude");
         return 3;
     }
-    if (nmea_to_decimal_deg(nmea_longitude, ew_indicator) != 0) {
-        DEBUG("Couldn't convert longitude to decimal degrees");
-        return 3;
-    };
 
+    latitude = lat / 1e7;
+    longitude = lon / 1e7;
     return 0;
 }
 
 /**
- * @brief Converts NMEA coordinate format to decimal degrees.
- * @param value NMEA coordinate value.
- * @param direction Direction indicator (N, S, E, W).
- * @return 0 on success, error code otherwise.
+ * @brief Updates the UTC time from the time and date fields of a GPRMC sentence.
+ * @param time UTC time as "hhmmss" with optional decimals, which are ignored.
+ * @param date UTC date as "ddmmyy".
+ * @return 0 on success, 1 if the fields are invalid.
  */
-int GPS::nmea_to_decimal_deg(const std::string &value, const std::string &direction) {
-    if (value.empty() || direction.empty()) { return 1; }
-
-    size_t deg_len = value.find('.') - 2;
-    if (deg_len != 2 && deg_len != 3) {
-        DEBUG("Invalid value for lon/lat");
-        return 2;
-    }
-
-    double degrees = std::stod(value.substr(0, deg_len));
-    double minutes = std::stod(value.substr(deg_len));
-
-    double decimal_degrees = degrees + (minutes / 60.0);
-
-    if (direction == "S" || direction == "W") { decimal_degrees *= -1; }
+int GPS::parse_utc(std::string_view time, std::string_view date) {
+    auto pair = [](std::string_view str, size_t pos) {
+        char high = str[pos], low = str[pos + 1];
+        if (high < '0' || high > '9' || low < '0' || low > '9') return -1;
+        return (high - '0') * 10 + (low - '0');
+    };
+    if (time.size() < 6 || date.size() != 6 || (time.size() > 6 && time[6] != '.')) return 1;
 
-    if (direction == "N" || direction == "S") {
-        latitude = decimal_degrees;
-    } else if (direction == "E" || direction == "W") {
-        longitude = decimal_degrees;
-    } else {
-        DEBUG("Invalid direction");
-        return 3;
+    int hour = pair(time, 0), min = pair(time, 2), sec = pair(time, 4);
+    int day = pair(date, 0), month = pair(date, 2), year = pair(date, 4);
+    if (hour < 0 || hour > 23 || min < 0 || min > 59 || sec < 0 || sec > 60 || day < 1 || day > 31 || month < 1 ||
+        month > 12 || year < 0) {
+        return 1;
     }
 
+    datetime_t datetime = {.year = static_cast<int16_t>(2000 + year),
+                           .month = static_cast<int8_t>(month),
+                           .day = static_cast<int8_t>(day),
+                           .dotw = 0,
+                           .hour = static_cast<int8_t>(hour),
+                           .min = static_cast<int8_t>(min),
+                           .sec = static_cast<int8_t>(sec)};
+    utc = datetime_to_epoch(datetime);
+    utc_us = time_us_64();
     return 0;
 }
 
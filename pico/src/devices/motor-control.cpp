@@ -1,15 +1,29 @@
 #include "motor-control.hpp"
 
-#define NATURAL_SPEED 3
+#define NATURAL_SPEED 3            // Speed at the start and the end of a move, the motors don't stall from it
+#define SLEW_SPEED    RPM_SLEW_MAX // Speed ramped up to in the middle of a move
+
+#define MAX_SPEED_RATIO (RPM_SLEW_MAX / NATURAL_SPEED) // The horizontal motor can't go faster than this
 
 // these are used for calibration
 static MotorControl *motorcontrol;
 
+// Speed of the horizontal motor relative to the vertical one, so both motors arrive at the same time. When only the
+// horizontal motor moves it runs at its top speed, when it doesn't move its speed doesn't matter.
+static double speed_ratio(double horizontal_distance, double vertical_distance) {
+    horizontal_distance = fabs(horizontal_distance);
+    vertical_distance = fabs(vertical_distance);
+    if (horizontal_distance == 0) return 1;
+    if (vertical_distance == 0) return MAX_SPEED_RATIO;
+    return std::min(horizontal_distance / vertical_distance, MAX_SPEED_RATIO);
+}
+
 MotorControl::MotorControl(std::shared_ptr<StepperMotor> horizontal, std::shared_ptr<StepperMotor> vertical,
                            int optopin_horizontal, int optopin_vertical)
     : motor_horizontal(horizontal), motor_vertical(vertical), opto_horizontal(optopin_horizontal),
       opto_vertical(optopin_vertical), horizontal_calibrated(false), vertical_calibrated(false),
-      horizontal_calibrating(false), vertical_calibrating(false), handler_attached(false), heading_correction(M_PI_2) {
+      horizontal_calibrating(false), vertical_calibrating(false), handler_attached(false), heading_correction(M_PI_2),
+      calibration_start(0), calibration_duration_ms(CALIBRATION_TIME_DEFAULT_MS) {
     init_optoforks();
     motorcontrol = this;
     motor_horizontal->init(pio0, 5, CLOCKWISE);
@@ -22,30 +36,38 @@ void MotorControl::setHeading(double heading) {
 }
 
 bool MotorControl::turn_to_coordinates(azimuthal_coordinates coords) {
-    if (coords.altitude < MIN_ANGLE || coords.altitude > MAX_ANGLE) {
+    if (!to_motor_coordinates(coords)) {
         DEBUG("Altitude below horizon, can't turn the motor");
         return false;
     }
-    coords.azimuth = normalize_radians(coords.azimuth + heading_correction);
-
-    if (coords.azimuth > MAX_ANGLE) {
-        coords.azimuth -= MAX_ANGLE;
-        if (coords.altitude < (M_PI / 2))
-            coords.altitude += M_PI - 2 * coords.altitude;
-        else
-            coords.altitude -= M_PI + 2 * coords.altitude;
-    }
     DEBUG("Motor azimuth:", coords.azimuth * 180 / M_PI, "altitude:", coords.altitude * 180 / M_PI);
-    double ratio = fabs(motor_horizontal->get_position() - coords.azimuth) /
-                   fabs(motor_vertical->get_position() - coords.altitude);
+    double ratio = speed_ratio(motor_horizontal->get_position() - coords.azimuth,
+                               motor_vertical->get_position() - coords.altitude);
     double horizontal_speed = NATURAL_SPEED * ratio;
     motor_vertical->setSpeed(NATURAL_SPEED);
     motor_horizontal->setSpeed(horizontal_speed);
-    motor_horizontal->turn_to(coords.azimuth);
-    motor_vertical->turn_to(coords.altitude);
+    motor_horizontal->turn_to(coords.azimuth, SLEW_SPEED * ratio);
+    motor_vertical->turn_to(coords.altitude, SLEW_SPEED);
     return true;
 }
 
+// Estimates in seconds how long turn_to_coordinates takes to reach the coordinates.
+// Motors that are not calibrated are assumed to start from the calibration position.
+double MotorControl::estimate_slew_time(azimuthal_coordinates coords) const {
+    if (!to_motor_coordinates(coords)) return 0;
+    double horizontal_from = isCalibrated() ? motor_horizontal->get_position() : 0;
+    double vertical_from = isCalibrated() ? motor_vertical->get_position() : 0;
+    double ratio = speed_ratio(horizontal_from - coords.azimuth, vertical_from - coords.altitude);
+    double horizontal_time = motor_horizontal->estimate_time_to(horizontal_from, coords.azimuth,
+                                                                NATURAL_SPEED * ratio, SLEW_SPEED * ratio);
+    double vertical_time =
+        motor_vertical->estimate_time_to(vertical_from, coords.altitude, NATURAL_SPEED, SLEW_SPEED);
+    return std::max(horizontal_time, vertical_time);
+}
+
+// Duration of the last completed calibration
+uint32_t MotorControl::calibration_time_ms(void) const { return calibration_duration_ms; }
+
 void MotorControl::off(void) {
     horizontal_calibrated = false;
     vertical_calibrated = false;
@@ -55,6 +77,21 @@ void MotorControl::off(void) {
 
 //// PRIVATE ////
 
+// converts sky coordinates to motor angles, returns false if the coordinates can't be reached
+bool MotorControl::to_motor_coordinates(azimuthal_coordinates &coords) const {
+    if (coords.altitude < MIN_ANGLE || coords.altitude > MAX_ANGLE) return false;
+    coords.azimuth = normalize_radians(coords.azimuth + heading_correction);
+
+    if (coords.azimuth > MAX_ANGLE) {
+        coords.azimuth -= MAX_ANGLE;
+        if (coords.altitude < (M_PI / 2))
+            coords.altitude += M_PI - 2 * coords.altitude;
+        else
+            coords.altitude -= M_PI + 2 * coords.altitude;
+    }
+    return true;
+}
+
 void MotorControl::init_optoforks(void) {
     if (opto_horizontal) {
         gpio_set_dir(opto_horizontal, GPIO_IN);
@@ -110,6 +147,7 @@ void MotorControl::calibrate(void) {
     motor_horizontal->stop();
     motor_vertical->stop();
     DEBUG("Calibration started.");
+    calibration_start = time_us_64();
 
     motor_horizontal->setSpeed(15);
     motor_vertical->setSpeed(15);
@@ -166,4 +204,8 @@ void MotorControl::calibration_handler(Axis axis, bool rise) {
             }
         }
     }
+    if (isCalibrated() && calibration_start) {
+        calibration_duration_ms = (time_us_64() - calibration_start) / 1000;
+        calibration_start = 0;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,153 @@
+/**
+ * @file nmea.cpp
+ * @brief Implementation of the NmeaParser class and the conversion of NMEA coordinates.
+ */
+
+#include "nmea.hpp"
+
+/**
+ * @brief Converts a hexadecimal digit.
+ *
+ * @param c The digit, upper or lower case.
+ * @return int The value of the digit, -1 if c isn't a hexadecimal digit.
+ */
+static int hex_value(uint8_t c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+/**
+ * @brief Feeds a received byte to the state machine.
+ * @details A '$' always starts a new sentence, abandoning a partial one.
+ *
+ * @param c The received byte.
+ * @return Result SENTENCE when c completed a valid sentence, INVALID when a sentence was rejected, NONE otherwise.
+ */
+NmeaParser::Result NmeaParser::feed(uint8_t c) {
+    if (c == '$') {
+        Result result = state == IDLE ? NONE : reject();
+        state = IN_BODY;
+        checksum = 0;
+        expected = 0;
+        digits = 0;
+        length = 0;
+        count = 1;
+        starts[0] = 0;
+        return result;
+    }
+
+    switch (state) {
+        case IDLE:
+            return NONE; // Skip everything up to the next '$', including line ends
+        case IN_BODY:
+            if (c == '*') {
+                state = IN_CHECKSUM;
+                return NONE;
+            }
+            if (c < ' ' || c > '~' || length == sizeof(buffer)) return reject();
+            checksum ^= c;
+            if (c == ',' && count < NMEA_MAX_FIELDS) { starts[count++] = length + 1; }
+            buffer[length++] = c;
+            return NONE;
+        case IN_CHECKSUM: {
+            int value = hex_value(c);
+            if (value < 0) return reject();
+            expected = expected << 4 | value;
+            if (++digits < 2) return NONE;
+            if (expected != checksum) return reject();
+            state = IDLE;
+            return SENTENCE;
+        }
+    }
+    return NONE;
+}
+
+/**
+ * @brief Returns a field of the last sentence.
+ * @details Field 0 is the address, for example "GPGGA". The checksum isn't a field.
+ *
+ * @param index Index of the field.
+ * @return std::string_view The field, empty if the sentence has fewer fields.
+ */
+std::string_view NmeaParser::field(size_t index) const {
+    if (index >= count) return {};
+    size_t end = starts[index];
+    if (index + 1 < count) {
+        end = starts[index + 1] - 1;
+    } else {
+        while (end < length && buffer[end] != ',') end++; // Fields after NMEA_MAX_FIELDS aren't indexed
+    }
+    return std::string_view(buffer + starts[index], end - starts[index]);
+}
+
+/**
+ * @brief Abandons a partially received sentence.
+ */
+void NmeaParser::reset() { state = IDLE; }
+
+/**
+ * @brief Rejects the sentence being received.
+ *
+ * @return Result Always INVALID.
+ */
+NmeaParser::Result NmeaParser::reject() {
+    state = IDLE;
+    error_count++;
+    return INVALID;
+}
+
+/**
+ * @brief Parses a run of decimal digits.
+ *
+ * @param digits The digits, must not be empty.
+ * @param result Reference to store the value.
+ * @return bool True if all characters are digits and the value fits in 32 bits.
+ */
+static bool parse_digits(std::string_view digits, uint32_t &result) {
+    if (digits.empty() || digits.size() > 9) return false;
+    result = 0;
+    for (char c : digits) {
+        if (c < '0' || c > '9') return false;
+        result = result * 10 + (c - '0');
+    }
+    return true;
+}
+
+/**
+ * @brief Converts an NMEA coordinate to fixed-point degrees.
+ * @details The coordinate is "ddmm.mmmm" for a latitude and "dddmm.mmmm" for a longitude. Up to five decimals of the
+ * minutes are used, which is below a millimeter. Only integer math is used.
+ *
+ * @param value NMEA coordinate value.
+ * @param hemisphere Hemisphere indicator: N, S, E or W.
+ * @param result Reference to store the coordinate in units of 1e-7 degrees, negative in the south and the west.
+ * @return bool True if the coordinate is valid for the hemisphere.
+ */
+bool nmea_to_fixed(std::string_view value, std::string_view hemisphere, int32_t &result) {
+    if (hemisphere.size() != 1) return false;
+    const char direction = hemisphere[0];
+    const bool latitude = direction == 'N' || direction == 'S';
+    if (!latitude && direction != 'E' && direction != 'W') return false;
+
+    size_t dot = value.find('.');
+    if (dot != (latitude ? 4 : 5)) return false;
+    std::string_view fraction = value.substr(dot + 1, 5);
+    uint32_t degrees, minutes, decimals = 0;
+    if (!parse_digits(value.substr(0, dot - 2), degrees) || !parse_digits(value.substr(dot - 2, 2), minutes) ||
+        (!fraction.empty() && !parse_digits(fraction, decimals))) {
+        return false;
+    }
+    for (size_t i = fraction.size(); i < 5; ++i) {
+        decimals *= 10;
+    }
+    const uint32_t limit = latitude ? 90 : 180;
+    if (minutes >= 60 || degrees > limit || (degrees == limit && (minutes > 0 || decimals > 0))) return false;
+
+    // Minutes in units of 1e-5, a degree is 60 * 1e5 of them and 1e7 units of the result
+    uint64_t minutes_e5 = minutes * 100000ull + decimals;
+    int64_t fixed = degrees * 10000000ll + static_cast<int64_t>((minutes_e5 * 10 + 3) / 6);
+    result = static_cast<int32_t>(direction == 'S' || direction == 'W' ? -fixed : fixed);
+    return true;
+}
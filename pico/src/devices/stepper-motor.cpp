@@ -9,7 +9,7 @@ int modulo(int x, int y) {
 
 StepperMotor::StepperMotor(const std::vector<uint> &stepper_pins)
     : pins(stepper_pins), direction(true), pioInstance(nullptr), programOffset(0), stateMachine(0), speed(0),
-      sequenceCounter(0), stepCounter(0), stepMax(4097), stepMemory(0) {
+      sequenceCounter(0), stepCounter(0), stepMax(4097), stepMemory(0), ramp{}, ramping(false) {
     // need 4 pins
     if (pins.size() != 4) panic("Need 4 pins to operate stepper motor. number of pins got: %d", pins.size());
     // Three first stepper pins must be less than 6 apart
@@ -39,8 +39,8 @@ void StepperMotor::pioInit(void) {
     pio_sm_init(pioInstance, stateMachine, programOffset, &conf);
 }
 
-float StepperMotor::calculateClkDiv(float rpm) const {
-    if (rpm > RPM_MAX) rpm = RPM_MAX;
+float StepperMotor::calculateClkDiv(float rpm, float max_rpm) const {
+    if (rpm > max_rpm) rpm = max_rpm;
     if (rpm < RPM_MIN) rpm = RPM_MIN;
     return (SYS_CLK_KHZ * 1000) / (16000 / (((1 / rpm) * 60 * 1000) / 4096));
 }
@@ -96,6 +96,7 @@ void StepperMotor::morph_pio_pin_definitions(void) {
 }
 
 void StepperMotor::turnSteps(uint16_t steps) {
+    cancelRamp();
     uint32_t word = ((programOffset + stepper_clockwise_offset_loop + 3 * sequenceCounter) << 16) | (steps);
     pio_sm_put_blocking(pioInstance, stateMachine, word);
 
@@ -105,8 +106,82 @@ void StepperMotor::turnSteps(uint16_t steps) {
     stepMemory = (stepMemory << 16) | stepsToAdd;
 }
 
-// this will stop the motor and turn to an angle instantly
-void StepperMotor::turn_to(double radians) {
+// Turns with a trapezoidal velocity profile: accelerates from the speed set with setSpeed to peak_rpm, cruises and
+// decelerates back so the last steps are taken at the set speed again. The PIO program still runs the whole move from
+// one FIFO word, a timer updates the clock divider every RAMP_TICK_MS. The profile follows the steps of this move, so
+// a move that would queue behind another one runs at the set speed instead.
+void StepperMotor::turnSteps(uint16_t steps, float peak_rpm) {
+    if (steps == 0 || !(peak_rpm > speed) || isRunning()) {
+        turnSteps(steps);
+        return;
+    }
+    turnSteps(steps);
+    ramp = planRamp(steps, speed, peak_rpm);
+    ramping = add_repeating_timer_ms(RAMP_TICK_MS, rampCallback, this, &rampTimer);
+}
+
+// Plans the profile of a ramped move. Moves too short to reach the peak speed get a triangular profile.
+StepperMotor::Ramp StepperMotor::planRamp(uint16_t steps, float start_rpm, float peak_rpm) {
+    const float stepsPerRpm = 4096 / 60.0f;
+    start_rpm = std::clamp<float>(start_rpm, RPM_MIN, RPM_MAX);
+    peak_rpm = std::clamp<float>(peak_rpm, start_rpm, RPM_SLEW_MAX);
+
+    Ramp plan;
+    plan.steps = steps;
+    plan.startSpeed = start_rpm * stepsPerRpm;
+    plan.peakSpeed = peak_rpm * stepsPerRpm;
+    plan.accel = RAMP_ACCEL * stepsPerRpm;
+    plan.accelTime = (plan.peakSpeed - plan.startSpeed) / plan.accel;
+    float accelSteps = (plan.startSpeed + plan.peakSpeed) / 2 * plan.accelTime;
+    if (2 * accelSteps > steps) {
+        plan.peakSpeed = sqrtf(plan.startSpeed * plan.startSpeed + plan.accel * steps);
+        plan.accelTime = (plan.peakSpeed - plan.startSpeed) / plan.accel;
+        accelSteps = steps / 2.0f;
+    }
+    plan.cruiseTime = (steps - 2 * accelSteps) / plan.peakSpeed;
+    plan.totalTime = 2 * plan.accelTime + plan.cruiseTime;
+    plan.speed = plan.startSpeed;
+    return plan;
+}
+
+// Runs in the timer interrupt during a ramped move. The speed follows the steps the PIO has taken and has left,
+// v^2 = v0^2 + 2a * steps, so a late tick can't leave the motor at the peak speed at the end of the move or crawling
+// before it. The steps left are counted from where the motor is at the end of the next tick, so the deceleration
+// doesn't lag behind. The set speed is restored when the move ends.
+bool StepperMotor::rampCallback(repeating_timer_t *timer) {
+    StepperMotor *motor = static_cast<StepperMotor *>(timer->user_data);
+    Ramp &plan = motor->ramp;
+    const float stepsPerRpm = 4096 / 60.0f;
+    // The state machine is in the loop until the move ends, read_steps_left() doesn't need to load X
+    int stepsLeft = motor->isRunning() ? abs(motor->read_steps_left()) : 0;
+
+    if (stepsLeft == 0) {
+        pio_sm_set_clkdiv(motor->pioInstance, motor->stateMachine, motor->calculateClkDiv(motor->speed));
+        motor->ramping = false;
+        return false;
+    }
+    float stepsTaken = std::max(0, plan.steps - stepsLeft);
+    float stepsToEnd = std::max(0.0f, stepsLeft - plan.speed * RAMP_TICK_MS / 1000.0f);
+    float v0Squared = plan.startSpeed * plan.startSpeed;
+    float accelSpeed = sqrtf(v0Squared + 2 * plan.accel * stepsTaken);
+    float decelSpeed = sqrtf(v0Squared + 2 * plan.accel * stepsToEnd);
+    plan.speed = std::min({accelSpeed, decelSpeed, plan.peakSpeed});
+
+    float div = motor->calculateClkDiv(plan.speed / stepsPerRpm, RPM_SLEW_MAX);
+    pio_sm_set_clkdiv(motor->pioInstance, motor->stateMachine, div);
+    return true;
+}
+
+// Stops the ramp timer and restores the set speed
+void StepperMotor::cancelRamp() {
+    if (!ramping) return;
+    cancel_repeating_timer(&rampTimer);
+    ramping = false;
+    pio_sm_set_clkdiv(pioInstance, stateMachine, calculateClkDiv(speed));
+}
+
+// this will stop the motor and turn to an angle instantly, ramping up to peak_rpm if it is above the set speed
+void StepperMotor::turn_to(double radians, float peak_rpm) {
     stop();
     double current = get_position();
     double normalized = normalize_radians(radians);
@@ -117,22 +192,23 @@ void StepperMotor::turn_to(double radians) {
         setDirection(ANTICLOCKWISE);
     else
         setDirection(CLOCKWISE);
-    turnSteps(radians_to_steps(fabs(distance)));
+    turnSteps(radians_to_steps(fabs(distance)), peak_rpm);
 }
 
 void StepperMotor::turnOneRevolution() { turnSteps(stepMax); }
 
+// The divider can be changed while the state machine runs, the next step is taken at the new speed
 void StepperMotor::setSpeed(float rpm) {
-    pio_sm_set_enabled(pioInstance, stateMachine, false);
+    cancelRamp();
     speed = rpm;
     float div = calculateClkDiv(rpm);
     pio_sm_set_clkdiv(pioInstance, stateMachine, div);
-    pio_sm_set_enabled(pioInstance, stateMachine, true);
 }
 
 void StepperMotor::resetStepCounter(void) { stepCounter = 0; }
 
 void StepperMotor::stop() {
+    cancelRamp();
     pio_sm_set_enabled(pioInstance, stateMachine, false);
 
     sequenceCounter = modulo(getCurrentStep() + 1, 8);
@@ -240,3 +316,16 @@ uint16_t StepperMotor::getMaxSteps() const { return stepMax; }
 int16_t StepperMotor::getStepCount() const { return stepCounter; }
 
 bool StepperMotor::getDirection() const { return direction; }
+
+// estimates how many seconds turn_to takes to move between two angles at the given speed, ramping up to peak_rpm if
+// it is above the speed
+double StepperMotor::estimate_time_to(double from, double to, float rpm, float peak_rpm) const {
+    if (!(rpm <= RPM_MAX)) rpm = RPM_MAX; // also catches NaN from a zero length move
+    if (rpm < RPM_MIN) rpm = RPM_MIN;
+    double distance = normalize_radians(to) - normalize_radians(from);
+    if (distance < -M_PI) { distance += 2 * M_PI; }
+    if (distance > M_PI) { distance -= 2 * M_PI; }
+    double steps = round((fabs(distance) * (double)stepMax) / (2.0 * M_PI));
+    if (peak_rpm > rpm && steps > 0) return planRamp(static_cast<uint16_t>(steps), rpm, peak_rpm).totalTime;
+    return steps * 60.0 / (rpm * 4096.0);
+}
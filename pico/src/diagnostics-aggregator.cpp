@@ -0,0 +1,121 @@
+/**
+ * @file diagnostics-aggregator.cpp
+ * @brief Implementation of the DiagnosticsAggregator class for batching diagnostics sent to the ESP.
+ */
+
+#include "diagnostics-aggregator.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+/**
+ * @brief Adds a diagnostic, or counts another occurrence of a pending one.
+ *
+ * @param status Status of the diagnostic: 1 info, 2 warning, 3 error.
+ * @param text The diagnostic, cut to DIAG_TEXT_LENGTH characters.
+ * @param now Current epoch.
+ */
+void DiagnosticsAggregator::report(uint8_t status, std::string_view text, int64_t now) {
+    text = text.substr(0, DIAG_TEXT_LENGTH);
+    if (empty()) { pending_since = now; }
+    highest = std::max(highest, status);
+
+    for (uint8_t i = 0; i < count; ++i) {
+        Entry &entry = entries[i];
+        if (entry.status == status && std::string_view(entry.text, entry.length) == text) {
+            entry.occurrences++;
+            entry.last = now;
+            return;
+        }
+    }
+
+    Entry *slot = count < DIAG_AGGREGATOR_SIZE ? &entries[count++] : nullptr;
+    if (slot == nullptr) {
+        dropped++;
+        // Make room by dropping the oldest of the lowest status pending, if it is below the new one
+        Entry *lowest = std::min_element(entries, entries + count,
+                                         [](const Entry &a, const Entry &b) { return a.status < b.status; });
+        if (lowest->status >= status) return;
+        std::move(lowest + 1, entries + count, lowest);
+        slot = &entries[count - 1];
+    }
+
+    Entry &entry = *slot;
+    entry.status = status;
+    entry.length = text.size();
+    memcpy(entry.text, text.data(), text.size());
+    entry.occurrences = 1;
+    entry.first = now;
+    entry.last = now;
+}
+
+/**
+ * @brief Checks whether the pending diagnostics should be sent.
+ * @details They are due DIAG_FLUSH_PERIOD_S after the first one was reported, or right away if one of them has at
+ * least DIAG_URGENT_STATUS and no urgent batch was sent in the last DIAG_URGENT_HOLDOFF seconds. A clock that was set
+ * backwards makes them due as well.
+ *
+ * @param now Current epoch.
+ * @return bool True if flush() should be called.
+ */
+bool DiagnosticsAggregator::due(int64_t now) const {
+    if (empty()) return false;
+    if (highest >= DIAG_URGENT_STATUS && (now - last_urgent >= DIAG_URGENT_HOLDOFF || now < last_urgent)) return true;
+    return now - pending_since >= DIAG_FLUSH_PERIOD_S || now < pending_since;
+}
+
+/**
+ * @brief Packs pending diagnostics into one DIAGNOSTICS message.
+ * @details Entries are written as "<text> at <first epoch>" or "<text> x<count> at <first epoch>+<seconds to the
+ * last>s" and separated by " | ". The status of the batch is the highest status in it. Entries that don't fit in
+ * DIAG_BATCH_LENGTH characters stay pending.
+ *
+ * @param batch Reference to store the message.
+ * @param now Current epoch.
+ * @return bool True if a message was created, False if nothing was pending.
+ */
+bool DiagnosticsAggregator::flush(msg::Message &batch, int64_t now) {
+    if (empty()) return false;
+
+    std::string text;
+    uint8_t status = 0;
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < count; ++i) {
+        const Entry &entry = entries[i];
+        std::string part(entry.text, entry.length);
+        if (entry.occurrences > 1) {
+            part += " x" + std::to_string(entry.occurrences) + " at " + std::to_string(entry.first) + "+" +
+                    std::to_string(entry.last - entry.first) + "s";
+        } else {
+            part += " at " + std::to_string(entry.first);
+        }
+
+        if (!text.empty() && text.size() + 3 + part.size() > DIAG_BATCH_LENGTH) {
+            entries[kept++] = entry; // Sent with the next batch
+            continue;
+        }
+        if (!text.empty()) { text += " | "; }
+        text += part;
+        status = std::max(status, entry.status);
+    }
+    count = kept;
+
+    if (count == 0 && dropped > 0) {
+        std::string part = "+" + std::to_string(dropped) + " diagnostics dropped";
+        if (text.empty() || text.size() + 3 + part.size() <= DIAG_BATCH_LENGTH) {
+            text += text.empty() ? part : " | " + part;
+            status = std::max<uint8_t>(status, 2);
+            dropped = 0;
+        }
+    }
+
+    highest = 0;
+    for (uint8_t i = 0; i < count; ++i) {
+        highest = std::max(highest, entries[i].status);
+    }
+    if (status >= DIAG_URGENT_STATUS) { last_urgent = now; }
+
+    batch = msg::diagnostics(status, text);
+    return true;
+}
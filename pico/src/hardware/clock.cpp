@@ -33,10 +33,18 @@ void Clock::update(std::string &str) {
 /**
  * @brief Updates the RTC with a given timestamp.
  * @param timestamp Unix timestamp to set the clock.
+ * @param source Where the timestamp came from, see set_priority().
+ * @return True if the clock was set, false if the source isn't accepted or the RTC rejected the time.
  */
-void Clock::update(time_t timestamp) {
+bool Clock::update(time_t timestamp, TimeSource source) {
+    if (!accepts(source)) {
+        DEBUG("Ignored time from a lower priority source");
+        return false;
+    }
     synced = false;
+    this->source = source;
     last_timestamp = timestamp;
+    last_update_us = time_us_64();
 
     struct tm *timeinfo = gmtime(&timestamp);
 
@@ -58,8 +66,48 @@ void Clock::update(time_t timestamp) {
     } else {
         DEBUG("TIME NOT SYNCED");
     }
+    return synced;
+}
+
+/**
+ * @brief Checks whether time from a source would be used.
+ * @param source The source of the time.
+ * @return True if update() would set the clock from the source.
+ */
+bool Clock::accepts(TimeSource source) const {
+    switch (source) {
+        case TimeSource::ESP:
+            if (priority == TimePriority::GPS_ONLY) return false;
+            return priority != TimePriority::GPS_FIRST || this->source != TimeSource::GPS || !synced;
+        case TimeSource::GPS:
+            if (priority == TimePriority::ESP_ONLY) return false;
+            return priority != TimePriority::ESP_FIRST || this->source != TimeSource::ESP || !synced;
+        case TimeSource::MANUAL:
+            return true;
+        case TimeSource::NONE:
+            return false;
+    }
+    return false;
 }
 
+/**
+ * @brief Returns where the current time came from.
+ * @return Source of the last update.
+ */
+TimeSource Clock::get_source() const { return source; }
+
+/**
+ * @brief Sets which source is preferred.
+ * @param priority The new priority.
+ */
+void Clock::set_priority(TimePriority priority) { this->priority = priority; }
+
+/**
+ * @brief Returns which source is preferred.
+ * @return The current priority.
+ */
+TimePriority Clock::get_priority() const { return priority; }
+
 /**
  * @brief Retrieves the current datetime from the RTC.
  * @return Current datetime_t structure.
@@ -70,6 +118,16 @@ datetime_t Clock::get_datetime() const {
     return now;
 }
 
+/**
+ * @brief Retrieves the current time as seconds since the Unix epoch.
+ * @details Derived from the last synchronized timestamp and the microsecond timer, so no datetime conversion is
+ * needed.
+ * @return Current Unix timestamp.
+ */
+time_t Clock::get_epoch() const {
+    return last_timestamp + static_cast<time_t>((time_us_64() - last_update_us) / 1000000);
+}
+
 /**
  * @brief Checks if the RTC time has been successfully synchronized.
  * @return True if synchronized, otherwise false.
@@ -81,6 +139,7 @@ bool Clock::is_synced() const { return synced; }
  */
 void alarm_handler() {
     DEBUG("ALARM RINGING");
+    clock_inst->alarm_time_us = time_us_64();
     clock_inst->alarm_wakeup = true;
 }
 
@@ -96,6 +155,12 @@ void Clock::add_alarm(datetime_t datetime) { rtc_set_alarm(&datetime, &alarm_han
  */
 bool Clock::is_alarm_ringing() const { return alarm_wakeup; }
 
+/**
+ * @brief Returns the time the alarm last fired.
+ * @return Time in microseconds since boot, 0 if the alarm has not fired.
+ */
+uint64_t Clock::alarm_fired_at() const { return alarm_time_us; }
+
 /**
  * @brief Clears the active alarm.
  */
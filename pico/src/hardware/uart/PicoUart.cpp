@@ -4,13 +4,19 @@
  */
 
 #include "PicoUart.hpp"
+#include <algorithm>
 #include <cstring>
 #include <hardware/gpio.h>
+#include <hardware/sync.h>
 
 /** Static pointers to PicoUart instances for UART0 and UART1 */
 static PicoUart *pu0;
 static PicoUart *pu1;
 
+/** DMA receive rings for UART0 and UART1, the DMA ring wrap requires them to be aligned to their size */
+alignas(UART_DMA_RX_SIZE) static uint8_t rx_ring0[UART_DMA_RX_SIZE];
+alignas(UART_DMA_RX_SIZE) static uint8_t rx_ring1[UART_DMA_RX_SIZE];
+
 /**
  * @brief UART0 interrupt handler.
  * Calls the receive and transmit interrupt handlers for the PicoUart instance.
@@ -35,6 +41,22 @@ void pico_uart1_handler(void) {
         irq_set_enabled(UART1_IRQ, false);
 }
 
+/**
+ * @brief DMA_IRQ_0 handler shared by both UARTs.
+ * Releases the transmitted region of the transmit ring and starts the transfer of the next one.
+ */
+void pico_uart_dma_handler(void) {
+    for (PicoUart *pu : {pu0, pu1}) {
+        if (pu && pu->tx_dma >= 0 && dma_channel_get_irq0_status(pu->tx_dma)) {
+            dma_channel_acknowledge_irq0(pu->tx_dma);
+            pu->tx.consume(pu->tx_dma_len);
+            pu->tx_dma_len = 0;
+            pu->tx_resume();
+            pu->dma_tx_start();
+        }
+    }
+}
+
 /**
  * @brief Constructs a PicoUart object and initializes UART communication.
  *
@@ -43,11 +65,9 @@ void pico_uart1_handler(void) {
  * @param rx_pin GPIO pin for RX.
  * @param speed Baud rate.
  * @param stop Number of stop bits.
- * @param tx_size Size of the transmit buffer.
- * @param rx_size Size of the receive buffer.
+ * @param dma Use DMA for receiving and transmitting if DMA channels are available.
  */
-PicoUart::PicoUart(int uart_nr, int tx_pin, int rx_pin, int speed, int stop, int tx_size, int rx_size)
-    : tx(tx_size), rx(rx_size), speed{speed} {
+PicoUart::PicoUart(int uart_nr, int tx_pin, int rx_pin, int speed, int stop, bool dma) : speed{speed} {
     irqn = uart_nr == 0 ? UART0_IRQ : UART1_IRQ;
     uart = uart_nr == 0 ? uart0 : uart1;
     if (uart_nr == 0) {
@@ -68,6 +88,9 @@ PicoUart::PicoUart(int uart_nr, int tx_pin, int rx_pin, int speed, int stop, int
     gpio_set_function(tx_pin, GPIO_FUNC_UART);
     gpio_set_function(rx_pin, GPIO_FUNC_UART);
 
+    // In DMA mode the UART doesn't need interrupts at all
+    if (dma && dma_init(uart_nr)) return;
+
     irq_set_exclusive_handler(irqn, uart_nr == 0 ? pico_uart0_handler : pico_uart1_handler);
 
     // Now enable the UART to send interrupts - RX only
@@ -76,6 +99,52 @@ PicoUart::PicoUart(int uart_nr, int tx_pin, int rx_pin, int speed, int stop, int
     irq_set_enabled(irqn, true);
 }
 
+/**
+ * @brief Claims and starts the DMA channels.
+ * @details The receive channel runs continuously and wraps around the receive ring. The transmit channel is started
+ * by write() and raises DMA_IRQ_0 when a region of the transmit ring has been sent.
+ *
+ * @param uart_nr UART number (0 or 1).
+ * @return true if DMA mode is active, false if no DMA channels were available.
+ */
+bool PicoUart::dma_init(int uart_nr) {
+    rx_dma = dma_claim_unused_channel(false);
+    tx_dma = dma_claim_unused_channel(false);
+    if (rx_dma < 0 || tx_dma < 0) {
+        if (rx_dma >= 0) dma_channel_unclaim(rx_dma);
+        if (tx_dma >= 0) dma_channel_unclaim(tx_dma);
+        rx_dma = tx_dma = -1;
+        return false;
+    }
+
+    rx_ring = uart_nr == 0 ? rx_ring0 : rx_ring1;
+    dma_channel_config rx_config = dma_channel_get_default_config(rx_dma);
+    channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
+    channel_config_set_read_increment(&rx_config, false);
+    channel_config_set_write_increment(&rx_config, true);
+    channel_config_set_ring(&rx_config, true, UART_DMA_RX_RING_BITS);
+    channel_config_set_dreq(&rx_config, uart_get_dreq(uart, false));
+    dma_channel_configure(rx_dma, &rx_config, rx_ring, &uart_get_hw(uart)->dr, UART_DMA_RX_TRANSFERS, true);
+
+    dma_channel_config tx_config = dma_channel_get_default_config(tx_dma);
+    channel_config_set_transfer_data_size(&tx_config, DMA_SIZE_8);
+    channel_config_set_read_increment(&tx_config, true);
+    channel_config_set_write_increment(&tx_config, false);
+    channel_config_set_dreq(&tx_config, uart_get_dreq(uart, true));
+    dma_channel_configure(tx_dma, &tx_config, &uart_get_hw(uart)->dr, nullptr, 0, false);
+
+    // Both UARTs share the handler, install it once
+    static bool dma_irq_installed = false;
+    if (!dma_irq_installed) {
+        irq_add_shared_handler(DMA_IRQ_0, pico_uart_dma_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0, true);
+        dma_irq_installed = true;
+    }
+    dma_channel_set_irq0_enabled(tx_dma, true);
+
+    return true;
+}
+
 /**
  * @brief Reads data from the receive buffer.
  *
@@ -85,62 +154,127 @@ PicoUart::PicoUart(int uart_nr, int tx_pin, int rx_pin, int speed, int stop, int
  */
 int PicoUart::read(uint8_t *buffer, int size) {
     int count = 0;
-    while (count < size && !rx.empty()) {
-        *buffer++ = rx.get();
-        ++count;
+    while (count < size) {
+        std::span<const uint8_t> region = peek();
+        if (region.empty()) break;
+        const int chunk = std::min<int>(region.size(), size - count);
+        memcpy(buffer + count, region.data(), chunk);
+        consume(chunk);
+        count += chunk;
     }
     return count;
 }
 
+/**
+ * @brief Returns the contiguous received bytes at the read position without copying them.
+ * @details Process them in place and call consume(). The data may continue at the start of the buffer, call peek()
+ * again after consuming. In DMA mode a reader that has been lapped by the DMA loses everything up to the write
+ * pointer.
+ *
+ * @return std::span<const uint8_t> Readable region, empty if nothing has been received.
+ */
+std::span<const uint8_t> PicoUart::peek() {
+    if (!dma_enabled()) return rx.peek();
+
+    const uint32_t written = dma_rx_written();
+    const uint32_t available = written - rx_read;
+    if (available > UART_DMA_RX_SIZE) {
+        // The DMA lapped the reader and is overwriting the oldest bytes, drop everything up to the write pointer
+        overflow_count += available;
+        rx_read = written;
+        return {};
+    }
+    if (available > rx_high_water_mark) { rx_high_water_mark = available; }
+    const uint32_t pos = rx_read & (UART_DMA_RX_SIZE - 1);
+    return {rx_ring + pos, std::min<uint32_t>(available, UART_DMA_RX_SIZE - pos)};
+}
+
+/**
+ * @brief Releases bytes returned by peek().
+ *
+ * @param count Number of bytes processed, at most the size of the peeked region.
+ */
+void PicoUart::consume(size_t count) {
+    if (dma_enabled()) {
+        rx_read += count;
+    } else {
+        rx.consume(count);
+    }
+}
+
 /**
  * @brief Writes data to the transmit buffer and enables the transmit interrupt.
+ * @details In DMA mode a transfer is started instead if the DMA channel is idle. Data that doesn't fit is dropped,
+ * use write_frame() for data that must go out whole.
  *
  * @param buffer Pointer to the data to be written.
  * @param size Number of bytes to write.
- * @return Number of bytes actually written.
+ * @return Number of bytes actually written, 0 while a frame is pending.
  */
 int PicoUart::write(const uint8_t *buffer, int size) {
-    int count = 0;
+    if (!tx_ready()) return 0; // The pending frame goes first
     // write data to ring buffer
-    while (count < size && !tx.full()) {
-        tx.put(*buffer++);
-        ++count;
-    }
-    // disable interrupts on NVIC while managing transmit interrupts
-    irq_set_enabled(irqn, false);
-    // if transmit interrupt is not enabled we need to enable it and give fifo an initial filling
-    if (!(uart_get_hw(uart)->imsc & (1 << UART_UARTIMSC_TXIM_LSB))) {
-        // enable transmit interrupt
-        uart_set_irq_enables(uart, true, true);
-        // fifo requires initial filling
-        uart_irq_tx();
-    }
-    // enable interrupts on NVIC
-    irq_set_enabled(irqn, true);
-
+    int count = tx.write({buffer, static_cast<size_t>(size)});
+    tx_kick();
     return count;
 }
 
 /**
- * @brief Sends a C string to the UART.
+ * @brief Queues a frame for transmission as a whole.
+ * @details The frame is copied into the transmit buffer if it fits, otherwise into the pending slot from where the
+ * transmit interrupt moves it into the buffer once there is room. Nothing is queued while the pending slot is in use.
+ *
+ * @param buffer Pointer to the frame.
+ * @param size Length of the frame, at most UART_TX_BUFFER_SIZE.
+ * @return true if the whole frame was queued, false if nothing was queued.
+ */
+bool PicoUart::write_frame(const uint8_t *buffer, size_t size) {
+    if (size > UART_TX_BUFFER_SIZE || !tx_ready()) return false;
+
+    if (tx.capacity() - tx.size() >= size) {
+        tx.write({buffer, size});
+    } else {
+        memcpy(tx_pending, buffer, size);
+        tx_pending_len.store(size, std::memory_order_release);
+    }
+    tx_kick();
+    return true;
+}
+
+/**
+ * @brief Checks whether write_frame() accepts a frame.
+ *
+ * @return true if the pending slot is free.
+ */
+bool PicoUart::tx_ready() const { return tx_pending_len.load(std::memory_order_acquire) == 0; }
+
+/**
+ * @brief Checks whether all queued data has been handed to the UART.
+ * @details The last bytes may still be in the UART FIFO.
+ *
+ * @return true if the pending slot and the transmit buffer are empty.
+ */
+bool PicoUart::tx_done() const { return tx_ready() && tx.empty(); }
+
+/**
+ * @brief Sends a C string to the UART as one frame.
  *
  * @param str Pointer to the string to be sent.
- * @return Always returns 0.
+ * @return Number of bytes queued, 0 if the string couldn't be queued whole.
  */
 int PicoUart::send(const char *str) {
-    write(reinterpret_cast<const uint8_t *>(str), strlen(str));
-    return 0;
+    const size_t len = strlen(str);
+    return write_frame(reinterpret_cast<const uint8_t *>(str), len) ? len : 0;
 }
 
 /**
- * @brief Sends a std::string to the UART.
+ * @brief Sends a std::string to the UART as one frame.
  *
  * @param str The string to be sent.
- * @return Always returns 0.
+ * @return Number of bytes queued, 0 if the string couldn't be queued whole.
  */
 int PicoUart::send(const std::string &str) {
-    write(reinterpret_cast<const uint8_t *>(str.c_str()), str.length());
-    return 0;
+    return write_frame(reinterpret_cast<const uint8_t *>(str.c_str()), str.length()) ? str.length() : 0;
 }
 
 /**
@@ -149,11 +283,15 @@ int PicoUart::send(const std::string &str) {
  * @return Number of bytes removed from the buffer.
  */
 int PicoUart::flush() {
-    int count = 0;
-    while (!rx.empty()) {
-        (void)rx.get();
-        ++count;
+    if (dma_enabled()) {
+        const uint32_t written = dma_rx_written();
+        int count = written - rx_read;
+        rx_read = written;
+        return count;
     }
+
+    int count = rx.size();
+    rx.clear();
     return count;
 }
 
@@ -164,7 +302,7 @@ int PicoUart::flush() {
 void PicoUart::uart_irq_rx() {
     while (uart_is_readable(uart)) {
         uint8_t c = uart_getc(uart);
-        // ignoring return value for now
+        // Lost bytes are counted by the ring buffer
         rx.put(c);
     }
 }
@@ -175,8 +313,11 @@ void PicoUart::uart_irq_rx() {
  * Disables the transmit interrupt if the buffer is empty.
  */
 void PicoUart::uart_irq_tx() {
-    while (!tx.empty() && uart_is_writable(uart)) {
-        uart_get_hw(uart)->dr = tx.get();
+    uint8_t c;
+    tx_resume();
+    while (uart_is_writable(uart) && tx.get(c)) {
+        uart_get_hw(uart)->dr = c;
+        if (tx.empty()) tx_resume();
     }
 
     if (tx.empty()) {
@@ -184,3 +325,98 @@ void PicoUart::uart_irq_tx() {
         uart_set_irq_enables(uart, true, false);
     }
 }
+
+/**
+ * @brief Checks whether the UART is in DMA mode.
+ *
+ * @return true if DMA moves the data, false if the UART interrupt does.
+ */
+bool PicoUart::dma_enabled() const { return rx_dma >= 0; }
+
+/**
+ * @brief Returns the number of received bytes lost because the receive buffer was full.
+ *
+ * @return Number of lost bytes since the UART was initialized.
+ */
+uint32_t PicoUart::overflows() const { return dma_enabled() ? overflow_count : rx.overflows(); }
+
+/**
+ * @brief Returns the most received bytes that have been waiting to be read at once.
+ * @details In DMA mode the level is sampled when peek() is called.
+ *
+ * @return Number of bytes.
+ */
+uint32_t PicoUart::rx_high_water() const { return dma_enabled() ? rx_high_water_mark : rx.high_water(); }
+
+/**
+ * @brief Returns the most bytes that have been waiting in the transmit buffer at once.
+ *
+ * @return Number of bytes.
+ */
+uint32_t PicoUart::tx_high_water() const { return tx.high_water(); }
+
+/**
+ * @brief Returns the total number of bytes the receive DMA channel has written.
+ * @details The channel is restarted when its transfer count runs out. The UART FIFO holds received bytes meanwhile.
+ *
+ * @return Free-running byte count, compared against rx_read.
+ */
+uint32_t PicoUart::dma_rx_written() {
+    if (!dma_channel_is_busy(rx_dma)) {
+        rx_dma_base += UART_DMA_RX_TRANSFERS;
+        dma_channel_set_trans_count(rx_dma, UART_DMA_RX_TRANSFERS, true);
+    }
+    return rx_dma_base + (UART_DMA_RX_TRANSFERS - dma_channel_hw_addr(rx_dma)->transfer_count);
+}
+
+/**
+ * @brief Starts moving the transmit buffer to the UART.
+ * @details In DMA mode a transfer is started if the DMA channel is idle. In interrupt mode the transmit interrupt is
+ * enabled and the FIFO is given an initial filling.
+ */
+void PicoUart::tx_kick() {
+    if (dma_enabled()) {
+        // The DMA interrupt starts the next transfer when one is in progress
+        uint32_t irq_state = save_and_disable_interrupts();
+        tx_resume();
+        if (tx_dma_len == 0) dma_tx_start();
+        restore_interrupts(irq_state);
+        return;
+    }
+
+    // disable interrupts on NVIC while managing transmit interrupts
+    irq_set_enabled(irqn, false);
+    // if transmit interrupt is not enabled we need to enable it and give fifo an initial filling
+    if (!(uart_get_hw(uart)->imsc & (1 << UART_UARTIMSC_TXIM_LSB))) {
+        // enable transmit interrupt
+        uart_set_irq_enables(uart, true, true);
+        // fifo requires initial filling
+        uart_irq_tx();
+    }
+    // enable interrupts on NVIC
+    irq_set_enabled(irqn, true);
+}
+
+/**
+ * @brief Moves the pending frame into the transmit buffer once it fits.
+ * @details Called from the transmit interrupts, or with them disabled. While a frame is pending only this function
+ * writes to the transmit buffer.
+ */
+void PicoUart::tx_resume() {
+    const size_t len = tx_pending_len.load(std::memory_order_acquire);
+    if (len == 0 || tx.capacity() - tx.size() < len) return;
+    tx.write({tx_pending, len});
+    tx_pending_len.store(0, std::memory_order_release);
+}
+
+/**
+ * @brief Starts sending the contiguous region at the start of the transmit ring.
+ * @details Called with interrupts disabled or from the DMA interrupt, when no transfer is in progress. The region is
+ * released by the DMA interrupt once it has been sent.
+ */
+void PicoUart::dma_tx_start() {
+    std::span<const uint8_t> region = tx.peek();
+    if (region.empty()) return;
+    tx_dma_len = region.size();
+    dma_channel_transfer_from_buffer_now(tx_dma, region.data(), region.size());
+}
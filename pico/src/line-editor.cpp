@@ -0,0 +1,102 @@
+/**
+ * @file line-editor.cpp
+ * @brief Implementation of the LineEditor class for non-blocking console input.
+ */
+
+#include "line-editor.hpp"
+
+#include <cctype>
+#include <iostream>
+#include <pico/stdio.h>
+
+/**
+ * @brief Constructor for the LineEditor class.
+ */
+LineEditor::LineEditor() { buffer.reserve(LINE_EDITOR_MAX_LENGTH); }
+
+/**
+ * @brief Checks if console input is available without consuming it.
+ * @details A character read by this function is kept and handled by the next poll.
+ *
+ * @return bool True if a character is available, False otherwise.
+ */
+bool LineEditor::available() {
+    if (pending == PICO_ERROR_TIMEOUT) pending = stdio_getchar_timeout_us(0);
+    return pending != PICO_ERROR_TIMEOUT;
+}
+
+/**
+ * @brief Consumes the characters available on the console.
+ * @details Returns as soon as a line is complete, the console has no more input or max_chars characters have been
+ * handled. A completed line stays available through line() until clear() is called.
+ *
+ * @param max_chars Maximum number of characters to consume.
+ * @return Result IDLE if nothing was read, LINE_READY if a line was completed, ACTIVITY otherwise.
+ */
+LineEditor::Result LineEditor::poll(int max_chars) {
+    if (ready) return LINE_READY;
+
+    Result result = IDLE;
+    for (int i = 0; i < max_chars && available(); ++i) {
+        char c = static_cast<char>(pending);
+        pending = PICO_ERROR_TIMEOUT;
+        result = ACTIVITY;
+        if (feed(c)) {
+            ready = true;
+            result = LINE_READY;
+            break;
+        }
+    }
+    std::cout.flush();
+
+    return result;
+}
+
+/**
+ * @brief Returns the current line.
+ *
+ * @return const std::string& The line.
+ */
+const std::string &LineEditor::line() const { return buffer; }
+
+/**
+ * @brief Discards the current line and any character read by available().
+ */
+void LineEditor::clear() {
+    buffer.clear();
+    pending = PICO_ERROR_TIMEOUT;
+    ready = false;
+}
+
+/**
+ * @brief Sets whether typed characters are echoed as '*'.
+ *
+ * @param hidden True to hide the input.
+ */
+void LineEditor::set_hidden(bool hidden) { this->hidden = hidden; }
+
+/**
+ * @brief Handles a single character.
+ *
+ * @param c The character.
+ * @return bool True if the character completed a line, False otherwise.
+ */
+bool LineEditor::feed(char c) {
+    const char prev = last_c;
+    last_c = c;
+
+    if (c == '\r' || c == '\n') {
+        if (c == '\n' && prev == '\r') return false; // Second half of CRLF
+        std::cout << std::endl;
+        return true;
+    } else if (c == '\b' || c == 0x7F) {
+        if (buffer.size() > 0) {
+            buffer.pop_back();
+            std::cout << '\b' << ' ' << '\b';
+        }
+    } else if (std::isprint(static_cast<unsigned char>(c)) && buffer.size() < LINE_EDITOR_MAX_LENGTH) {
+        buffer += c;
+        std::cout << (hidden ? '*' : c);
+    }
+    return false;
+}
@@ -11,12 +11,13 @@
 #include "motor-control.hpp"
 #include "stepper-motor.hpp"
 #include "storage.hpp"
+#include "usb-link.hpp"
 
 #include <memory>
-#include <queue>
 
 int main() {
     stdio_init_all();
+    auto usb = std::make_shared<UsbLink>(); // Console and message link on the USB port
     sleep_ms(500);
     DEBUG("Boot");
 
@@ -30,11 +31,11 @@ int main() {
     DEBUG("Clock initialized");
     auto gps = std::make_shared<GPS>(uart_1, false, true);
     DEBUG("GPS initialized");
-    auto compass = std::make_shared<Compass>(i2c0, 17, 16);
-    DEBUG("Compass initialized");
     auto storage = std::make_shared<Storage>(i2c1, 26, 27);
+    auto compass = std::make_shared<Compass>(i2c0, 17, 16, storage);
+    DEBUG("Compass initialized");
 
-    auto queue = std::make_shared<std::queue<msg::Message>>();
+    auto queue = std::make_shared<MessageQueue>();
     DEBUG("Queue initialized");
     auto commbridge = std::make_shared<CommBridge>(uart_0, queue);
     DEBUG("CommBridge initialized");
@@ -53,7 +54,8 @@ int main() {
     auto mctrl = std::make_shared<MotorControl>(mh, mv, opto_horizontal, opto_vertical);
     DEBUG("MotorControl initialized");
 
-    Controller controller(clock, gps, compass, commbridge, mctrl, storage, queue);
+    // Its buffers are kept inline and don't fit in the 2 KB main stack
+    static Controller controller(clock, gps, compass, commbridge, mctrl, storage, queue, usb);
     DEBUG("Controller initialized");
     for (;;) {
         controller.run();
@@ -146,3 +146,19 @@ int calculate_sec_difference(const datetime_t &dt1, const datetime_t &dt2) {
 int64_t datetime_to_epoch(datetime_t date) {
     return datetime_to_epoch(date.year, date.month, date.day, date.hour, date.min, date.sec);
 }
+/**
+ * @brief Converts unix timestamp to datetime
+ * @param epoch Unix timestamp to convert
+ * @return Datetime object in UTC
+ */
+datetime_t epoch_to_datetime(int64_t epoch) {
+    time_t timestamp = static_cast<time_t>(epoch);
+    struct tm *timeinfo = gmtime(&timestamp);
+    return datetime_t{.year = static_cast<int16_t>(timeinfo->tm_year + 1900),
+                      .month = static_cast<int8_t>(timeinfo->tm_mon + 1),
+                      .day = static_cast<int8_t>(timeinfo->tm_mday),
+                      .dotw = static_cast<int8_t>(timeinfo->tm_wday),
+                      .hour = static_cast<int8_t>(timeinfo->tm_hour),
+                      .min = static_cast<int8_t>(timeinfo->tm_min),
+                      .sec = static_cast<int8_t>(timeinfo->tm_sec)};
+}
@@ -10,6 +10,7 @@
 #include "message.hpp"
 #include "motor-control.hpp"
 #include "stepper-motor.hpp"
+#include "usb-link.hpp"
 
 #include <memory>
 #include <queue>
@@ -17,6 +18,7 @@
 #include "debug.hpp"
 int main() {
     stdio_init_all();
+    UsbLink usb; // Console on the USB port
     sleep_ms(500);
 
     // std::cout << "abc" << std::endl;
@@ -0,0 +1,74 @@
+/**
+ * @file trace-recorder.cpp
+ * @brief Implementation of the TraceRecorder class for recording timestamped controller events.
+ */
+
+#include "trace-recorder.hpp"
+
+#include <cstring>
+
+/**
+ * @brief Records an event.
+ *
+ * @param type Type of the event.
+ * @param arg8 Event specific 8-bit argument.
+ * @param arg16 Event specific 16-bit argument.
+ * @param arg32 Event specific 32-bit argument.
+ * @param timestamp Time of the event in microseconds since boot. 0 uses the current time.
+ */
+void TraceRecorder::record(TraceEventType type, uint8_t arg8, uint16_t arg16, uint32_t arg32, uint64_t timestamp) {
+    TraceEvent &event = events[total & (TRACE_CAPACITY - 1)];
+    event.timestamp = timestamp ? timestamp : time_us_64();
+    event.type = type;
+    event.arg8 = arg8;
+    event.arg16 = arg16;
+    event.arg32 = arg32;
+    total++;
+}
+
+/**
+ * @brief Writes the recorded events, oldest first, to an output stream.
+ * @details Each event is written as one line of 32 hexadecimal characters representing the little-endian bytes of
+ * the TraceEvent struct. The block is enclosed in "TRACE BEGIN <count> <overwritten>" and "TRACE END" lines so it
+ * can be picked out of a console log by python/trace_decoder.py.
+ *
+ * @param out The stream to write to.
+ */
+void TraceRecorder::dump(std::ostream &out) const {
+    static const char hex[] = "0123456789abcdef";
+    const uint32_t count = size();
+    char line[sizeof(TraceEvent) * 2 + 2];
+
+    out << "TRACE BEGIN " << count << " " << overwritten() << "\n";
+    for (uint32_t i = total - count; i != total; ++i) {
+        uint8_t bytes[sizeof(TraceEvent)];
+        std::memcpy(bytes, &events[i & (TRACE_CAPACITY - 1)], sizeof(TraceEvent));
+        for (size_t b = 0; b < sizeof(bytes); ++b) {
+            line[b * 2] = hex[bytes[b] >> 4];
+            line[b * 2 + 1] = hex[bytes[b] & 0x0F];
+        }
+        line[sizeof(line) - 2] = '\n';
+        line[sizeof(line) - 1] = '\0';
+        out << line;
+    }
+    out << "TRACE END" << std::endl;
+}
+
+/**
+ * @brief Discards all recorded events.
+ */
+void TraceRecorder::clear() { total = 0; }
+
+/**
+ * @brief Returns the number of events currently held in the buffer.
+ *
+ * @return uint32_t Number of events.
+ */
+uint32_t TraceRecorder::size() const { return total < TRACE_CAPACITY ? total : TRACE_CAPACITY; }
+
+/**
+ * @brief Returns the number of events that have been overwritten since the last clear.
+ *
+ * @return uint32_t Number of overwritten events.
+ */
+uint32_t TraceRecorder::overwritten() const { return total - size(); }
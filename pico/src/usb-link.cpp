@@ -0,0 +1,227 @@
+/**
+ * @file usb-link.cpp
+ * @brief Implementation of the UsbLink class and the USB console for the Raspberry Pi Pico.
+ */
+
+#include "usb-link.hpp"
+
+#include "debug.hpp"
+
+#include <hardware/irq.h>
+#include <pico/mutex.h>
+#include <pico/stdio/driver.h>
+#include <pico/stdlib.h>
+#include <tusb.h>
+
+// TinyUSB isn't reentrant. The background task skips a turn while the main loop or the console holds the mutex.
+auto_init_mutex(usb_mutex);
+static repeating_timer_t usb_timer;
+static int usb_irq = -1;
+
+/**
+ * @brief Runs the TinyUSB task in the low priority interrupt, unless TinyUSB is in use.
+ */
+static void usb_irq_handler() {
+    uint32_t owner;
+    if (!mutex_try_enter(&usb_mutex, &owner)) return;
+    tud_task();
+    mutex_exit(&usb_mutex);
+}
+
+/**
+ * @brief Raises the low priority interrupt that runs the TinyUSB task.
+ * @details tud_task() can take a while, so it doesn't run in the timer interrupt that the alarms share.
+ *
+ * @param timer The repeating timer.
+ * @return bool True to keep the timer running.
+ */
+static bool usb_timer_callback(repeating_timer_t *timer) {
+    (void)timer;
+    irq_set_pending(usb_irq);
+    return true;
+}
+
+/**
+ * @brief Writes console output to the first CDC interface.
+ * @details Output is dropped while no terminal is connected, so the firmware never blocks on a missing host. Output
+ * from an interrupt that preempted a holder of the mutex, e.g. a DEBUG in an alarm handler, is dropped as well.
+ *
+ * @param buffer Characters to write.
+ * @param length Number of characters.
+ */
+static void usb_console_out_chars(const char *buffer, int length) {
+    if (!mutex_try_enter_block_until(&usb_mutex, make_timeout_time_ms(USB_WRITE_TIMEOUT_MS))) return;
+    if (tud_cdc_n_connected(USB_CONSOLE_ITF)) {
+        uint64_t start = time_us_64();
+        while (length > 0 && time_us_64() - start < USB_WRITE_TIMEOUT_MS * 1000) {
+            uint32_t count = tud_cdc_n_write(USB_CONSOLE_ITF, buffer, length);
+            buffer += count;
+            length -= count;
+            if (length > 0) {
+                tud_cdc_n_write_flush(USB_CONSOLE_ITF);
+                tud_task();
+            }
+        }
+    }
+    mutex_exit(&usb_mutex);
+}
+
+/**
+ * @brief Sends buffered console output.
+ */
+static void usb_console_out_flush() {
+    if (!mutex_try_enter_block_until(&usb_mutex, make_timeout_time_ms(USB_WRITE_TIMEOUT_MS))) return;
+    tud_cdc_n_write_flush(USB_CONSOLE_ITF);
+    mutex_exit(&usb_mutex);
+}
+
+/**
+ * @brief Reads console input from the first CDC interface.
+ *
+ * @param buffer Buffer for the characters.
+ * @param length Size of the buffer.
+ * @return int Number of characters read, PICO_ERROR_NO_DATA if none are available.
+ */
+static int usb_console_in_chars(char *buffer, int length) {
+    if (!mutex_try_enter_block_until(&usb_mutex, make_timeout_time_ms(USB_WRITE_TIMEOUT_MS))) return PICO_ERROR_NO_DATA;
+    int count = tud_cdc_n_available(USB_CONSOLE_ITF) ? tud_cdc_n_read(USB_CONSOLE_ITF, buffer, length) : 0;
+    mutex_exit(&usb_mutex);
+    return count > 0 ? count : PICO_ERROR_NO_DATA;
+}
+
+static stdio_driver_t usb_console_driver = {
+    .out_chars = usb_console_out_chars,
+    .out_flush = usb_console_out_flush,
+    .in_chars = usb_console_in_chars,
+#if PICO_STDIO_ENABLE_CRLF_SUPPORT
+    .crlf_enabled = PICO_STDIO_DEFAULT_CRLF,
+#endif
+};
+
+/**
+ * @brief Starts the USB device and its background task, and installs the console as a stdio driver.
+ */
+UsbLink::UsbLink() {
+    tusb_init();
+    usb_irq = user_irq_claim_unused(true);
+    irq_set_exclusive_handler(usb_irq, usb_irq_handler);
+    irq_set_priority(usb_irq, PICO_LOWEST_IRQ_PRIORITY);
+    irq_set_enabled(usb_irq, true);
+    add_repeating_timer_us(USB_TASK_INTERVAL_US, usb_timer_callback, nullptr, &usb_timer);
+    stdio_set_driver_enabled(&usb_console_driver, true);
+}
+
+/**
+ * @brief Parses the messages received on the link interface.
+ * @details Call on every iteration of the main loop. Messages are kept for receive() until the queue is full, after
+ * that they are dropped and counted. The mutex is only held while reading, so DEBUG output of the parser isn't lost.
+ */
+void UsbLink::poll() {
+    uint8_t buffer[CFG_TUD_CDC_EP_BUFSIZE];
+    for (;;) {
+        mutex_enter_blocking(&usb_mutex);
+        uint32_t count = tud_cdc_n_available(USB_LINK_ITF) ? tud_cdc_n_read(USB_LINK_ITF, buffer, sizeof(buffer)) : 0;
+        mutex_exit(&usb_mutex);
+        if (count == 0) break;
+        for (uint32_t i = 0; i < count; ++i) {
+            switch (framer.feed(buffer[i])) {
+                case msg::FrameParser::ASCII:
+                    deliver(framer.frame(), false);
+                    break;
+                case msg::FrameParser::BINARY:
+                    deliver(framer.frame(), true);
+                    break;
+                case msg::FrameParser::NONE:
+                    break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Takes the next message received from the laptop.
+ *
+ * @param rec Reference to store the message.
+ * @return bool True if a message was available.
+ */
+bool UsbLink::receive(msg::Record &rec) {
+    const msg::Record *front = queue.front();
+    if (front == nullptr) return false;
+    rec = *front;
+    queue.pop();
+    return true;
+}
+
+/**
+ * @brief Sends a message to the laptop.
+ * @details The whole frame is written at once, waiting up to USB_WRITE_TIMEOUT_MS for room in the transmit buffer.
+ *
+ * @param rec The message to send.
+ * @return bool True if the message was sent, False if no laptop is connected or the buffer stayed full.
+ */
+bool UsbLink::send(const msg::Record &rec) {
+    if (!connected()) return false;
+
+    char buffer[MSG_MAX_LENGTH];
+    size_t len = binary ? msg::encode_binary(rec, buffer, sizeof(buffer)) : 0;
+    if (len == 0) { len = msg::encode(rec, buffer, sizeof(buffer)); }
+    if (len == 0) return false;
+
+    mutex_enter_blocking(&usb_mutex);
+    uint64_t start = time_us_64();
+    bool room = true;
+    while (room && tud_cdc_n_write_available(USB_LINK_ITF) < len) {
+        room = time_us_64() - start <= USB_WRITE_TIMEOUT_MS * 1000;
+        tud_cdc_n_write_flush(USB_LINK_ITF);
+        tud_task();
+    }
+    if (room) {
+        tud_cdc_n_write(USB_LINK_ITF, buffer, len);
+        tud_cdc_n_write_flush(USB_LINK_ITF);
+    }
+    mutex_exit(&usb_mutex);
+    if (!room) DEBUG("USB link busy, dropped message of type", static_cast<int>(rec.type));
+    return room;
+}
+
+/**
+ * @brief Checks whether a program on the laptop has the link interface open.
+ *
+ * @return bool True if the DTR line of the link interface is set.
+ */
+bool UsbLink::connected() const {
+    mutex_enter_blocking(&usb_mutex);
+    bool connected = tud_cdc_n_connected(USB_LINK_ITF);
+    mutex_exit(&usb_mutex);
+    return connected;
+}
+
+/**
+ * @brief Returns the number of received messages that were dropped.
+ *
+ * @return uint32_t Messages that failed to decode or arrived while the queue was full.
+ */
+uint32_t UsbLink::dropped() const { return drop_count; }
+
+/**
+ * @brief Decodes a received frame and queues it.
+ *
+ * @param frame The frame reported by the FrameParser.
+ * @param is_binary True for a binary frame.
+ */
+void UsbLink::deliver(std::string_view frame, bool is_binary) {
+    msg::Record rec;
+    bool ok;
+    if (is_binary) {
+        ok = msg::decode_binary(frame, rec) == 0;
+    } else {
+        msg::View view;
+        ok = msg::decode(frame, view, framer.payload_crc()) == 0 && msg::to_record(view, rec);
+    }
+    if (!ok || !queue.push(rec)) {
+        DEBUG("Dropped message from the USB link, valid:", ok);
+        drop_count++;
+        return;
+    }
+    binary = is_binary;
+}
@@ -0,0 +1,129 @@
+#include "pico/unique_id.h"
+#include "tusb.h"
+
+#include <string.h>
+
+// PLACEHOLDER IDs: 0xCAFE/0x4002 is the pair of the TinyUSB examples, it isn't allocated to this device. Fine on a
+// development machine, but a released build must set USB_VID/USB_PID (the STARGAZER_USB_VID/PID CMake options) to
+// an allocated pair, e.g. the Raspberry Pi VID 0x2E8A with a PID requested from Raspberry Pi.
+#ifndef USB_VID
+#define USB_VID 0xCAFE
+#endif
+#ifndef USB_PID
+#define USB_PID 0x4002
+#endif
+#define USB_BCD 0x0200
+
+/** Interface numbers, each CDC interface has a control and a data interface */
+enum {
+    ITF_NUM_CONSOLE = 0,
+    ITF_NUM_CONSOLE_DATA,
+    ITF_NUM_LINK,
+    ITF_NUM_LINK_DATA,
+    ITF_NUM_TOTAL,
+};
+
+#define EPNUM_CONSOLE_NOTIF 0x81
+#define EPNUM_CONSOLE_OUT   0x02
+#define EPNUM_CONSOLE_IN    0x82
+#define EPNUM_LINK_NOTIF    0x83
+#define EPNUM_LINK_OUT      0x04
+#define EPNUM_LINK_IN       0x84
+
+#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + CFG_TUD_CDC * TUD_CDC_DESC_LEN)
+
+/** String descriptor indices */
+enum {
+    STRID_LANGID = 0,
+    STRID_MANUFACTURER,
+    STRID_PRODUCT,
+    STRID_SERIAL,
+    STRID_CONSOLE,
+    STRID_LINK,
+    STRID_COUNT,
+};
+
+static const tusb_desc_device_t desc_device = {
+    .bLength = sizeof(tusb_desc_device_t),
+    .bDescriptorType = TUSB_DESC_DEVICE,
+    .bcdUSB = USB_BCD,
+    // Interface association descriptors group the interfaces of each CDC function
+    .bDeviceClass = TUSB_CLASS_MISC,
+    .bDeviceSubClass = MISC_SUBCLASS_COMMON,
+    .bDeviceProtocol = MISC_PROTOCOL_IAD,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .idVendor = USB_VID,
+    .idProduct = USB_PID,
+    .bcdDevice = 0x0100,
+    .iManufacturer = STRID_MANUFACTURER,
+    .iProduct = STRID_PRODUCT,
+    .iSerialNumber = STRID_SERIAL,
+    .bNumConfigurations = 1,
+};
+
+static const uint8_t desc_configuration[] = {
+    TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0x00, 100),
+    TUD_CDC_DESCRIPTOR(ITF_NUM_CONSOLE, STRID_CONSOLE, EPNUM_CONSOLE_NOTIF, 8, EPNUM_CONSOLE_OUT, EPNUM_CONSOLE_IN,
+                       CFG_TUD_CDC_EP_BUFSIZE),
+    TUD_CDC_DESCRIPTOR(ITF_NUM_LINK, STRID_LINK, EPNUM_LINK_NOTIF, 8, EPNUM_LINK_OUT, EPNUM_LINK_IN,
+                       CFG_TUD_CDC_EP_BUFSIZE),
+};
+
+static const char *const strings[STRID_COUNT] = {
+    [STRID_MANUFACTURER] = "Stargazer",
+    [STRID_PRODUCT] = "Stargazer Pico",
+    [STRID_CONSOLE] = "Stargazer console",
+    [STRID_LINK] = "Stargazer message link",
+};
+
+/**
+ * Returns the device descriptor.
+ *
+ * @return Pointer to the descriptor.
+ */
+const uint8_t *tud_descriptor_device_cb(void) { return (const uint8_t *)&desc_device; }
+
+/**
+ * Returns the configuration descriptor.
+ *
+ * @param index Configuration index, there is only one.
+ * @return Pointer to the descriptor.
+ */
+const uint8_t *tud_descriptor_configuration_cb(uint8_t index) {
+    (void)index;
+    return desc_configuration;
+}
+
+/**
+ * Returns a string descriptor as UTF-16. The serial number is the unique ID of the flash chip.
+ *
+ * @param index String index.
+ * @param langid Requested language, only English is provided.
+ * @return Pointer to the descriptor, NULL for an unknown index.
+ */
+const uint16_t *tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
+    (void)langid;
+    static uint16_t descriptor[32 + 1];
+    static char serial[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+    size_t count;
+
+    if (index == STRID_LANGID) {
+        descriptor[1] = 0x0409; // English (United States)
+        count = 1;
+    } else {
+        if (index >= STRID_COUNT) return NULL;
+        const char *str = strings[index];
+        if (index == STRID_SERIAL) {
+            if (serial[0] == '\0') pico_get_unique_board_id_string(serial, sizeof(serial));
+            str = serial;
+        }
+        count = strlen(str);
+        if (count > 32) count = 32;
+        for (size_t i = 0; i < count; i++) {
+            descriptor[1 + i] = str[i];
+        }
+    }
+
+    descriptor[0] = (uint16_t)((TUSB_DESC_STRING << 8) | (2 * count + 2));
+    return descriptor;
+}
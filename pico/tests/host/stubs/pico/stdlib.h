@@ -0,0 +1,16 @@
+#pragma once
+
+// Host stand-in for the parts of the Pico SDK used by the modules tested on the host
+#include <cstdint>
+
+typedef unsigned int uint;
+
+typedef struct {
+    int16_t year;
+    int8_t month;
+    int8_t day;
+    int8_t dotw;
+    int8_t hour;
+    int8_t min;
+    int8_t sec;
+} datetime_t;
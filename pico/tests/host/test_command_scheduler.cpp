@@ -0,0 +1,84 @@
+#include "unity.h"
+#include "command-scheduler.hpp"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static Command command(uint64_t id) {
+    return Command{.id = id, .coords = {0, 0}, .time = {0, 0, 0, 0, 0, 0, 0}, .object_id = 0};
+}
+
+void test_pops_in_time_order(void) {
+    CommandScheduler scheduler;
+    const int64_t epochs[] = {300, 100, 500, 200, 400};
+    for (int i = 0; i < 5; ++i) {
+        TEST_ASSERT_TRUE(scheduler.insert(command(epochs[i]), epochs[i]));
+    }
+    TEST_ASSERT_EQUAL_INT(5, scheduler.size());
+    for (int64_t expected = 100; expected <= 500; expected += 100) {
+        TEST_ASSERT_EQUAL_INT64(expected, scheduler.top().epoch);
+        TEST_ASSERT_EQUAL_UINT64(expected, scheduler.pop().id);
+    }
+    TEST_ASSERT_TRUE(scheduler.empty());
+}
+
+void test_same_time_keeps_insertion_order(void) {
+    CommandScheduler scheduler;
+    for (uint64_t id = 1; id <= 4; ++id) {
+        scheduler.insert(command(id), 1000);
+    }
+    scheduler.insert(command(0), 999);
+    TEST_ASSERT_EQUAL_UINT64(0, scheduler.pop().id);
+    for (uint64_t id = 1; id <= 4; ++id) {
+        TEST_ASSERT_EQUAL_UINT64(id, scheduler.pop().id);
+    }
+}
+
+void test_insert_fails_when_full(void) {
+    CommandScheduler scheduler;
+    for (int i = 0; i < SCHEDULER_CAPACITY; ++i) {
+        TEST_ASSERT_TRUE(scheduler.insert(command(i), i));
+    }
+    TEST_ASSERT_FALSE(scheduler.insert(command(SCHEDULER_CAPACITY), 0));
+    TEST_ASSERT_EQUAL_INT(SCHEDULER_CAPACITY, scheduler.size());
+    TEST_ASSERT_EQUAL_UINT64(0, scheduler.top().command.id);
+}
+
+void test_insert_uses_command_time(void) {
+    CommandScheduler scheduler;
+    Command cmd = command(7);
+    cmd.time = datetime_t(2025, 1, 1, 0, 0, 0, 0);
+    scheduler.insert(cmd);
+    TEST_ASSERT_EQUAL_INT64(1735689600, scheduler.top().epoch);
+}
+
+void test_pop_expired_removes_only_older_commands(void) {
+    CommandScheduler scheduler;
+    scheduler.insert(command(3), 300);
+    scheduler.insert(command(1), 100);
+    scheduler.insert(command(2), 200);
+
+    Command expired;
+    TEST_ASSERT_TRUE(scheduler.pop_expired(250, expired));
+    TEST_ASSERT_EQUAL_UINT64(1, expired.id);
+    TEST_ASSERT_TRUE(scheduler.pop_expired(250, expired));
+    TEST_ASSERT_EQUAL_UINT64(2, expired.id);
+    TEST_ASSERT_FALSE(scheduler.pop_expired(250, expired));
+    TEST_ASSERT_EQUAL_INT(1, scheduler.size());
+
+    // A command at the limit hasn't expired
+    TEST_ASSERT_FALSE(scheduler.pop_expired(300, expired));
+    TEST_ASSERT_TRUE(scheduler.pop_expired(301, expired));
+    TEST_ASSERT_FALSE(scheduler.pop_expired(1000, expired));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_pops_in_time_order);
+    RUN_TEST(test_same_time_keeps_insertion_order);
+    RUN_TEST(test_insert_fails_when_full);
+    RUN_TEST(test_insert_uses_command_time);
+    RUN_TEST(test_pop_expired_removes_only_older_commands);
+    return UNITY_END();
+}
@@ -0,0 +1,88 @@
+#include "unity.h"
+#include "diagnostics-aggregator.hpp"
+
+#include <string>
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_counts_repeats(void) {
+    DiagnosticsAggregator diagnostics;
+    diagnostics.report(2, "Motor stalled", 100);
+    diagnostics.report(1, "GPS fix", 102);
+    diagnostics.report(2, "Motor stalled", 105);
+    diagnostics.report(2, "Motor stalled", 110);
+
+    msg::Message batch;
+    TEST_ASSERT_TRUE(diagnostics.flush(batch, 160));
+    TEST_ASSERT_EQUAL_INT(msg::DIAGNOSTICS, batch.type);
+    TEST_ASSERT_EQUAL_STRING("2", batch.content[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("Motor stalled x3 at 100+10s | GPS fix at 102", batch.content[1].c_str());
+    TEST_ASSERT_TRUE(diagnostics.empty());
+    TEST_ASSERT_FALSE(diagnostics.flush(batch, 160));
+}
+
+void test_due_after_flush_period(void) {
+    DiagnosticsAggregator diagnostics;
+    TEST_ASSERT_FALSE(diagnostics.due(100));
+    diagnostics.report(1, "Info", 100);
+    diagnostics.report(2, "Warning", 130);
+    TEST_ASSERT_FALSE(diagnostics.due(100 + DIAG_FLUSH_PERIOD_S - 1));
+    TEST_ASSERT_TRUE(diagnostics.due(100 + DIAG_FLUSH_PERIOD_S));
+    TEST_ASSERT_TRUE(diagnostics.due(50)); // Clock was set backwards
+}
+
+void test_urgent_diagnostics_are_due_at_once(void) {
+    DiagnosticsAggregator diagnostics;
+    diagnostics.report(DIAG_URGENT_STATUS, "Error", 200);
+    TEST_ASSERT_TRUE(diagnostics.due(200));
+
+    msg::Message batch;
+    diagnostics.flush(batch, 200);
+    diagnostics.report(DIAG_URGENT_STATUS, "Another error", 202);
+    TEST_ASSERT_FALSE(diagnostics.due(202));
+    TEST_ASSERT_TRUE(diagnostics.due(200 + DIAG_URGENT_HOLDOFF));
+}
+
+void test_full_aggregator_replaces_lower_status(void) {
+    DiagnosticsAggregator diagnostics;
+    for (int i = 0; i < DIAG_AGGREGATOR_SIZE; ++i) {
+        diagnostics.report(1, "d" + std::to_string(i), 100);
+    }
+    diagnostics.report(1, "dropped", 101); // No entry of a lower status to replace
+    diagnostics.report(2, "w", 102);       // Replaces the oldest info
+
+    msg::Message batch;
+    TEST_ASSERT_TRUE(diagnostics.flush(batch, 200));
+    TEST_ASSERT_EQUAL_STRING("2", batch.content[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("d1 at 100 | d2 at 100 | d3 at 100 | d4 at 100 | d5 at 100 | d6 at 100 | d7 at 100 | "
+                             "w at 102 | +2 diagnostics dropped",
+                             batch.content[1].c_str());
+    TEST_ASSERT_TRUE(diagnostics.empty());
+}
+
+void test_keeps_what_does_not_fit(void) {
+    DiagnosticsAggregator diagnostics;
+    const std::string long_text(DIAG_TEXT_LENGTH, 'x');
+    for (int i = 0; i < 4; ++i) {
+        diagnostics.report(1, std::to_string(i) + long_text, 100);
+    }
+
+    msg::Message batch;
+    TEST_ASSERT_TRUE(diagnostics.flush(batch, 200));
+    TEST_ASSERT_TRUE(batch.content[1].size() <= DIAG_BATCH_LENGTH);
+    TEST_ASSERT_FALSE(diagnostics.empty());
+    TEST_ASSERT_TRUE(diagnostics.flush(batch, 200));
+    TEST_ASSERT_TRUE(diagnostics.empty());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_counts_repeats);
+    RUN_TEST(test_due_after_flush_period);
+    RUN_TEST(test_urgent_diagnostics_are_due_at_once);
+    RUN_TEST(test_full_aggregator_replaces_lower_status);
+    RUN_TEST(test_keeps_what_does_not_fit);
+    return UNITY_END();
+}
@@ -0,0 +1,114 @@
+#include "unity.h"
+#include "ellipsoid-fit.hpp"
+
+#include <cmath>
+
+#define POINTS 200
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Soft-iron distortion and hard-iron offset applied to the generated samples
+static const double DISTORTION[3][3] = {{1.3, 0.2, 0.05}, {0.2, 0.8, 0.1}, {0.05, 0.1, 1.1}};
+static const double OFFSET[3] = {120, -80, 40};
+
+// Spreads points evenly over a sphere of the given radius, distorts and offsets them
+static void distorted_sphere(CompassSample *points, int count, double radius) {
+    const double golden_angle = M_PI * (3 - std::sqrt(5.0));
+    for (int i = 0; i < count; ++i) {
+        double z = 1 - 2 * (i + 0.5) / count;
+        double r = std::sqrt(1 - z * z);
+        double sphere[3] = {r * std::cos(golden_angle * i) * radius, r * std::sin(golden_angle * i) * radius,
+                            z * radius};
+        double p[3];
+        for (int row = 0; row < 3; ++row) {
+            p[row] = OFFSET[row];
+            for (int col = 0; col < 3; ++col) {
+                p[row] += DISTORTION[row][col] * sphere[col];
+            }
+        }
+        points[i] = {static_cast<int16_t>(std::lround(p[0])), static_cast<int16_t>(std::lround(p[1])),
+                     static_cast<int16_t>(std::lround(p[2]))};
+    }
+}
+
+static double corrected_radius(const CompassSample &point, const CompassCalibration &cal) {
+    double centered[3] = {point.x - cal.offset[0], point.y - cal.offset[1], point.z - cal.offset[2]};
+    double sum = 0;
+    for (int row = 0; row < 3; ++row) {
+        double value = 0;
+        for (int col = 0; col < 3; ++col) {
+            value += cal.matrix[row][col] * centered[col];
+        }
+        sum += value * value;
+    }
+    return std::sqrt(sum);
+}
+
+void test_recovers_offset_and_maps_to_sphere(void) {
+    CompassSample points[POINTS];
+    distorted_sphere(points, POINTS, 300);
+    CompassCalibration cal;
+    TEST_ASSERT_TRUE(fit_ellipsoid(points, POINTS, cal));
+    for (int i = 0; i < 3; ++i) {
+        TEST_ASSERT_DOUBLE_WITHIN(1.0, OFFSET[i], cal.offset[i]);
+    }
+
+    double min = INFINITY, max = 0;
+    for (const CompassSample &point : points) {
+        double radius = corrected_radius(point, cal);
+        min = std::fmin(min, radius);
+        max = std::fmax(max, radius);
+    }
+    TEST_ASSERT_TRUE(max - min < 0.02 * max);
+}
+
+void test_rejects_too_few_samples(void) {
+    CompassSample points[POINTS];
+    distorted_sphere(points, POINTS, 300);
+    CompassCalibration cal;
+    TEST_ASSERT_FALSE(fit_ellipsoid(points, 8, cal));
+    TEST_ASSERT_FALSE(fit_ellipsoid(points, 0, cal));
+}
+
+void test_rejects_identical_samples(void) {
+    CompassSample points[POINTS];
+    for (CompassSample &point : points) {
+        point = {100, -50, 20};
+    }
+    CompassCalibration cal;
+    TEST_ASSERT_FALSE(fit_ellipsoid(points, POINTS, cal));
+}
+
+void test_rejects_samples_in_a_plane(void) {
+    // The compass was only turned around one axis
+    CompassSample points[POINTS];
+    for (int i = 0; i < POINTS; ++i) {
+        double angle = 2 * M_PI * i / POINTS;
+        points[i] = {static_cast<int16_t>(std::lround(300 * std::cos(angle))),
+                     static_cast<int16_t>(std::lround(200 * std::sin(angle))), 45};
+    }
+    CompassCalibration cal;
+    TEST_ASSERT_FALSE(fit_ellipsoid(points, POINTS, cal));
+}
+
+void test_rejects_samples_on_a_line(void) {
+    CompassSample points[POINTS];
+    for (int i = 0; i < POINTS; ++i) {
+        int16_t t = static_cast<int16_t>(i - POINTS / 2);
+        points[i] = {t, static_cast<int16_t>(2 * t), static_cast<int16_t>(-t)};
+    }
+    CompassCalibration cal;
+    TEST_ASSERT_FALSE(fit_ellipsoid(points, POINTS, cal));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_recovers_offset_and_maps_to_sphere);
+    RUN_TEST(test_rejects_too_few_samples);
+    RUN_TEST(test_rejects_identical_samples);
+    RUN_TEST(test_rejects_samples_in_a_plane);
+    RUN_TEST(test_rejects_samples_on_a_line);
+    return UNITY_END();
+}
@@ -0,0 +1,80 @@
+#include "unity.h"
+#include "lane-queue.hpp"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_control_lane_goes_first(void) {
+    LaneQueue<int, 8> queue;
+    queue.push(1, msg::LANE_BULK);
+    queue.push(2, msg::LANE_COMMAND);
+    queue.push(3, msg::LANE_CONTROL);
+
+    const int expected[] = {3, 2, 1};
+    for (int value : expected) {
+        TEST_ASSERT_NOT_NULL(queue.front());
+        TEST_ASSERT_EQUAL_INT(value, *queue.front());
+        queue.pop();
+    }
+    TEST_ASSERT_NULL(queue.front());
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+void test_control_message_overtakes_looked_at_message(void) {
+    // The sender looks at the front while the link is busy, a control message queued meanwhile goes next
+    LaneQueue<int, 8> queue;
+    queue.push(1, msg::LANE_BULK);
+    TEST_ASSERT_EQUAL_INT(1, *queue.front());
+    queue.push(2, msg::LANE_CONTROL);
+    TEST_ASSERT_EQUAL_INT(2, *queue.front());
+    queue.pop();
+    TEST_ASSERT_EQUAL_INT(1, *queue.front());
+    queue.pop();
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+void test_pop_removes_the_message_looked_at(void) {
+    LaneQueue<int, 8> queue;
+    queue.push(1, msg::LANE_BULK);
+    TEST_ASSERT_EQUAL_INT(1, *queue.front());
+    queue.push(2, msg::LANE_CONTROL); // Queued between front() and pop()
+    queue.pop();
+    TEST_ASSERT_EQUAL_INT(1, queue.size());
+    TEST_ASSERT_EQUAL_INT(2, *queue.front());
+}
+
+void test_command_and_bulk_lanes_are_weighted(void) {
+    LaneQueue<int, 8> queue;
+    for (int i = 0; i < 6; ++i) {
+        queue.push(i, msg::LANE_COMMAND);
+    }
+    queue.push(100, msg::LANE_BULK);
+    queue.push(101, msg::LANE_BULK);
+
+    const int expected[] = {0, 1, 2, 3, 100, 4, 5, 101};
+    for (int value : expected) {
+        TEST_ASSERT_EQUAL_INT(value, *queue.front());
+        queue.pop();
+    }
+}
+
+void test_full_lane_counts_overflow(void) {
+    LaneQueue<int, 2> queue;
+    TEST_ASSERT_TRUE(queue.push(1, msg::LANE_BULK));
+    TEST_ASSERT_TRUE(queue.push(2, msg::LANE_BULK));
+    TEST_ASSERT_FALSE(queue.push(3, msg::LANE_BULK));
+    TEST_ASSERT_TRUE(queue.push(4, msg::LANE_CONTROL));
+    TEST_ASSERT_EQUAL_UINT32(1, queue.overflows());
+    TEST_ASSERT_EQUAL_INT(2, queue.size(msg::LANE_BULK));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_control_lane_goes_first);
+    RUN_TEST(test_control_message_overtakes_looked_at_message);
+    RUN_TEST(test_pop_removes_the_message_looked_at);
+    RUN_TEST(test_command_and_bulk_lanes_are_weighted);
+    RUN_TEST(test_full_lane_counts_overflow);
+    return UNITY_END();
+}
@@ -0,0 +1,104 @@
+#include "unity.h"
+#include "nmea.hpp"
+
+#include <string_view>
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Feeds a string and returns the last result other than NONE
+static NmeaParser::Result feed(NmeaParser &parser, std::string_view text) {
+    NmeaParser::Result result = NmeaParser::NONE;
+    for (char c : text) {
+        if (NmeaParser::Result r = parser.feed(c); r != NmeaParser::NONE) result = r;
+    }
+    return result;
+}
+
+static void assert_field(const NmeaParser &parser, size_t index, std::string_view expected) {
+    std::string_view field = parser.field(index);
+    TEST_ASSERT_EQUAL_INT(expected.size(), field.size());
+    TEST_ASSERT_EQUAL_STRING_LEN(expected.data(), field.data(), expected.size());
+}
+
+void test_parses_fields_of_valid_sentence(void) {
+    NmeaParser parser;
+    TEST_ASSERT_EQUAL_INT(NmeaParser::SENTENCE,
+                          feed(parser, "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47"));
+    TEST_ASSERT_EQUAL_INT(15, parser.field_count());
+    assert_field(parser, 0, "GPGGA");
+    assert_field(parser, 2, "4807.038");
+    assert_field(parser, 5, "E");
+    assert_field(parser, 13, "");
+    assert_field(parser, 14, "");
+    assert_field(parser, 15, ""); // Past the last field
+    TEST_ASSERT_EQUAL_UINT32(0, parser.errors());
+}
+
+void test_accepts_lower_case_checksum(void) {
+    NmeaParser parser;
+    TEST_ASSERT_EQUAL_INT(NmeaParser::SENTENCE, feed(parser, "$GPGLL,4916.45,N,12311.12,W,225444,A*31"));
+    TEST_ASSERT_EQUAL_INT(NmeaParser::SENTENCE, feed(parser, "\r\n$GPZDA,201530.00,04,07,2002,00,00*60"));
+    TEST_ASSERT_EQUAL_INT(NmeaParser::SENTENCE, feed(parser, "$GPTXT,x*1b"));
+}
+
+void test_rejects_wrong_checksum(void) {
+    NmeaParser parser;
+    TEST_ASSERT_EQUAL_INT(NmeaParser::INVALID, feed(parser, "$GPGLL,4916.45,N,12311.12,W,225444,A*32"));
+    TEST_ASSERT_EQUAL_INT(NmeaParser::INVALID, feed(parser, "$GPGLL,4916.45,N,12311.12,W,225444,A*3G"));
+    TEST_ASSERT_EQUAL_UINT32(2, parser.errors());
+}
+
+void test_dollar_restarts_sentence(void) {
+    NmeaParser parser;
+    feed(parser, "$GPGGA,1235");
+    TEST_ASSERT_EQUAL_INT(NmeaParser::INVALID, parser.feed('$'));
+    TEST_ASSERT_EQUAL_INT(NmeaParser::SENTENCE, feed(parser, "GPGLL,4916.45,N,12311.12,W,225444,A*31"));
+    assert_field(parser, 1, "4916.45");
+}
+
+void test_rejects_long_sentence_and_control_bytes(void) {
+    NmeaParser parser;
+    // Rejected at the byte past NMEA_MAX_LENGTH, the rest of it is skipped
+    TEST_ASSERT_EQUAL_INT(
+        NmeaParser::INVALID,
+        feed(parser, "$GPTXT,01234567890123456789012345678901234567890123456789012345678901234567890123456789*00"));
+    TEST_ASSERT_EQUAL_UINT32(1, parser.errors());
+    TEST_ASSERT_EQUAL_INT(NmeaParser::INVALID, feed(parser, "$GPTXT,a\tb"));
+    TEST_ASSERT_EQUAL_UINT32(2, parser.errors());
+    // Bytes before the next '$' are skipped
+    TEST_ASSERT_EQUAL_INT(NmeaParser::SENTENCE, feed(parser, "*00\r\n$GPTXT,x*1B"));
+}
+
+void test_converts_coordinates(void) {
+    int32_t value = 0;
+    TEST_ASSERT_TRUE(nmea_to_fixed("4807.038", "N", value));
+    TEST_ASSERT_EQUAL_INT32(481173000, value);
+    TEST_ASSERT_TRUE(nmea_to_fixed("01131.000", "W", value));
+    TEST_ASSERT_EQUAL_INT32(-115166667, value);
+    TEST_ASSERT_TRUE(nmea_to_fixed("6015.51936", "S", value));
+    TEST_ASSERT_EQUAL_INT32(-602586560, value);
+}
+
+void test_rejects_invalid_coordinates(void) {
+    int32_t value = 0;
+    TEST_ASSERT_FALSE(nmea_to_fixed("4807.038", "E", value));  // Latitude digits for a longitude
+    TEST_ASSERT_FALSE(nmea_to_fixed("4807.038", "X", value));
+    TEST_ASSERT_FALSE(nmea_to_fixed("4860.000", "N", value));  // 60 minutes
+    TEST_ASSERT_FALSE(nmea_to_fixed("9000.001", "N", value));  // Past the pole
+    TEST_ASSERT_FALSE(nmea_to_fixed("48a7.038", "N", value));
+    TEST_ASSERT_FALSE(nmea_to_fixed("", "N", value));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_parses_fields_of_valid_sentence);
+    RUN_TEST(test_accepts_lower_case_checksum);
+    RUN_TEST(test_rejects_wrong_checksum);
+    RUN_TEST(test_dollar_restarts_sentence);
+    RUN_TEST(test_rejects_long_sentence_and_control_bytes);
+    RUN_TEST(test_converts_coordinates);
+    RUN_TEST(test_rejects_invalid_coordinates);
+    return UNITY_END();
+}
@@ -0,0 +1,173 @@
+# Decodes event traces dumped by the Pico "trace_dump" config mode command.
+# Usage:
+#   python3 trace_decoder.py <console_log.txt> [--events]
+#   cat /dev/ttyACM0 | python3 trace_decoder.py -
+#
+# The dump is a block of 32 hex character lines between "TRACE BEGIN" and "TRACE END".
+# Each line is one little-endian TraceEvent (see pico/inc/trace-recorder.hpp):
+#   uint64 timestamp_us, uint8 type, uint8 arg8, uint16 arg16, uint32 arg32
+
+import argparse
+import math
+import struct
+import sys
+
+EVENT_FORMAT = "<QBBHI"
+
+# TraceEventType
+STATE_CHANGE = 1
+MSG_SEND = 2
+MSG_RECV = 3
+ALARM_FIRE = 4
+MOTOR_START = 5
+MOTOR_STOP = 6
+
+EVENT_NAMES = {
+    STATE_CHANGE: "STATE",
+    MSG_SEND: "SEND",
+    MSG_RECV: "RECV",
+    ALARM_FIRE: "ALARM",
+    MOTOR_START: "MOTOR_START",
+    MOTOR_STOP: "MOTOR_STOP",
+}
+
+# Controller::State
+STATE_NAMES = [
+    "SLEEP", "COMM_READ", "COMM_SEND", "CHECK_QUEUES", "COMM_PROCESS", "INSTR_PROCESS",
+    "MOTOR_CALIBRATE", "MOTOR_CONTROL", "MOTOR_WAIT", "MOTOR_OFF", "TRACE",
+]
+
+# msg::MessageType
+MSG_RESPONSE = 1
+MSG_PICTURE = 6
+MSG_NAMES = [
+    "UNASSIGNED", "RESPONSE", "DATETIME", "DEVICE_STATUS", "INSTRUCTIONS", "CMD_STATUS",
+    "PICTURE", "DIAGNOSTICS", "WIFI", "SERVER", "API",
+]
+
+
+def name(table, index):
+    return table[index] if index < len(table) else str(index)
+
+
+def read_dumps(lines):
+    '''
+    Returns a list of dumps, each a list of (timestamp, type, arg8, arg16, arg32) tuples.
+    Lines outside of TRACE BEGIN/END blocks are ignored so a full console log can be passed in.
+    '''
+    dumps = []
+    current = None
+    for line in lines:
+        line = line.strip()
+        if line.startswith("TRACE BEGIN"):
+            current = []
+        elif line.startswith("TRACE END"):
+            if current is not None:
+                dumps.append(current)
+            current = None
+        elif current is not None and len(line) == struct.calcsize(EVENT_FORMAT) * 2:
+            try:
+                current.append(struct.unpack(EVENT_FORMAT, bytes.fromhex(line)))
+            except ValueError:
+                print(f"Skipping malformed line: {line}", file=sys.stderr)
+    return dumps
+
+
+def describe(event):
+    timestamp, ev_type, arg8, arg16, arg32 = event
+    text = f"{timestamp / 1e6:12.6f} {EVENT_NAMES.get(ev_type, str(ev_type)):<12}"
+    if ev_type == STATE_CHANGE:
+        text += f"{name(STATE_NAMES, arg16)} -> {name(STATE_NAMES, arg8)}"
+    elif ev_type == MSG_SEND:
+        text += name(MSG_NAMES, arg8)
+    elif ev_type == MSG_RECV:
+        text += name(MSG_NAMES, arg8)
+        if arg8 == MSG_RESPONSE:
+            text += " ACK" if arg16 else " NACK"
+    elif ev_type in (MOTOR_START, MOTOR_STOP):
+        text += f"command {arg32}"
+    return text
+
+
+def measure_phases(events):
+    '''
+    Pairs events into latency samples (in milliseconds):
+      ACK round trip: SEND of a non-RESPONSE, non-PICTURE message -> next RECV RESPONSE
+      Slew duration:  MOTOR_START -> MOTOR_STOP
+      Capture wait:   SEND PICTURE -> next RECV RESPONSE (ESP acks after the picture is taken)
+    '''
+    phases = {"ACK round trip": [], "Slew duration": [], "Capture wait": []}
+    pending_send = None
+    pending_picture = None
+    motor_start = None
+
+    for timestamp, ev_type, arg8, _, _ in events:
+        if ev_type == MSG_SEND and arg8 == MSG_PICTURE:
+            pending_picture = timestamp
+        elif ev_type == MSG_SEND and arg8 != MSG_RESPONSE:
+            pending_send = timestamp
+        elif ev_type == MSG_RECV and arg8 == MSG_RESPONSE:
+            if pending_picture is not None:
+                phases["Capture wait"].append((timestamp - pending_picture) / 1000)
+                pending_picture = None
+            elif pending_send is not None:
+                phases["ACK round trip"].append((timestamp - pending_send) / 1000)
+                pending_send = None
+        elif ev_type == MOTOR_START:
+            motor_start = timestamp
+        elif ev_type == MOTOR_STOP and motor_start is not None:
+            phases["Slew duration"].append((timestamp - motor_start) / 1000)
+            motor_start = None
+
+    return phases
+
+
+def print_histogram(title, samples, width=40):
+    print(f"\n{title}: {len(samples)} samples")
+    if not samples:
+        return
+    samples = sorted(samples)
+    print(f"  min {samples[0]:.1f} ms  median {samples[len(samples) // 2]:.1f} ms  max {samples[-1]:.1f} ms")
+
+    # Power of two buckets starting at 1 ms
+    buckets = {}
+    for sample in samples:
+        bucket = 0 if sample < 1 else int(math.log2(sample)) + 1
+        buckets[bucket] = buckets.get(bucket, 0) + 1
+    peak = max(buckets.values())
+    for bucket in range(min(buckets), max(buckets) + 1):
+        count = buckets.get(bucket, 0)
+        low = 0 if bucket == 0 else 2 ** (bucket - 1)
+        high = 2 ** bucket
+        bar = "#" * max(1 if count else 0, round(count / peak * width))
+        print(f"  {low:>8}-{high:<8} ms {count:>5} {bar}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode Pico event traces into latency histograms")
+    parser.add_argument("file", help="Console log containing trace_dump output, or - for stdin")
+    parser.add_argument("--events", action="store_true", help="Print the decoded event timeline")
+    args = parser.parse_args()
+
+    source = sys.stdin if args.file == "-" else open(args.file, encoding="utf-8", errors="replace")
+    with source:
+        dumps = read_dumps(source)
+
+    if not dumps:
+        print("No trace dumps found")
+        return
+
+    # Use the latest dump, it contains the most recent events
+    events = dumps[-1]
+    print(f"Found {len(dumps)} dump(s), decoding the last one with {len(events)} events")
+
+    if args.events:
+        for event in events:
+            print(describe(event))
+
+    for title, samples in measure_phases(events).items():
+        print_histogram(title, samples)
+
+
+if __name__ == "__main__":
+    main()
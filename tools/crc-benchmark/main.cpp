@@ -0,0 +1,96 @@
+/**
+ * @file main.cpp
+ * @brief Host micro-benchmark comparing the CRC-16 implementations in common/src/crc.cpp.
+ * @details Each variant is run over message sized inputs and the average time per byte is printed. Build with:
+ *   cmake -S tools/crc-benchmark -B build-crc && cmake --build build-crc && ./build-crc/crc-benchmark
+ */
+
+#include "crc.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t INPUT_COUNT = 64;
+constexpr size_t TARGET_BYTES = 64 * 1024 * 1024; // Bytes processed per variant and size
+
+uint16_t crc16_streaming(std::string_view input) {
+    Crc16 crc;
+    for (char c : input) {
+        crc.update(static_cast<uint8_t>(c));
+    }
+    return crc.value();
+}
+
+struct Variant {
+    const char *name;
+    uint16_t (*function)(std::string_view);
+};
+
+constexpr Variant VARIANTS[] = {
+    {"bitwise", crc16_bitwise},
+    {"table", crc16_table},
+    {"slice4", crc16_slice4},
+    {"streaming", crc16_streaming},
+};
+
+std::vector<std::string> make_inputs(size_t length) {
+    std::mt19937 rng(length);
+    std::uniform_int_distribution<int> dist(0x20, 0x7E);
+    std::vector<std::string> inputs(INPUT_COUNT);
+    for (auto &input : inputs) {
+        input.resize(length);
+        for (auto &c : input) {
+            c = static_cast<char>(dist(rng));
+        }
+    }
+    return inputs;
+}
+
+} // namespace
+
+int main() {
+    // Sanity check, all variants must agree with the MODBUS check value
+    for (const auto &variant : VARIANTS) {
+        if (variant.function("123456789") != 0x4B37) {
+            std::printf("%s: wrong check value %04X\n", variant.name, variant.function("123456789"));
+            return 1;
+        }
+    }
+
+    // Typical sizes: ACK, datetime, instructions, diagnostics and a maximum length message
+    const size_t sizes[] = {4, 16, 32, 64, 128, 256};
+
+    std::printf("%8s", "bytes");
+    for (const auto &variant : VARIANTS) {
+        std::printf(" %12s", variant.name);
+    }
+    std::printf("   (ns/byte)\n");
+
+    for (size_t size : sizes) {
+        const auto inputs = make_inputs(size);
+        const size_t rounds = TARGET_BYTES / (size * INPUT_COUNT);
+
+        std::printf("%8zu", size);
+        for (const auto &variant : VARIANTS) {
+            volatile uint16_t sink = 0;
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t r = 0; r < rounds; ++r) {
+                for (const auto &input : inputs) {
+                    sink = sink ^ variant.function(input);
+                }
+            }
+            const auto end = std::chrono::steady_clock::now();
+            const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            std::printf(" %12.3f", ns / static_cast<double>(rounds * INPUT_COUNT * size));
+        }
+        std::printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "wire.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#define UART_TX_BUFFER_SIZE 256 // Same as the Pico driver
+#define UART_HOST_RX_CHUNK  512 // Largest part of a received write handed out at once
+
+/**
+ * @class PicoUart
+ * @brief Host stand-in for the Pico UART driver on top of two simulated lines.
+ * @details Received bytes are handed out one write of the sender at a time, so the harness can tell which write a
+ * parsed frame came from. Writes are limited by the free space of a UART_TX_BUFFER_SIZE byte transmit buffer like
+ * on the Pico, write_frame() may use one more UART_TX_BUFFER_SIZE for the pending slot.
+ */
+class PicoUart {
+  public:
+    PicoUart(sim::Wire &rx_line, sim::Wire &tx_line) : rx_line(rx_line), tx_line(tx_line) {}
+    PicoUart(const PicoUart &) = delete;
+    int read(uint8_t *buffer, int size);
+    std::span<const uint8_t> peek();
+    void consume(size_t count);
+    int write(const uint8_t *buffer, int size);
+    bool write_frame(const uint8_t *buffer, size_t size);
+    bool tx_ready() const;
+    int flush();
+    uint32_t overflows() const { return 0; }
+    uint32_t rx_high_water() const { return 0; }
+    uint32_t tx_high_water() const { return 0; }
+
+    std::function<void(int marker)> on_unit; // Called when the last byte of a received write has been consumed
+
+  private:
+    sim::Wire &rx_line;
+    sim::Wire &tx_line;
+    uint8_t staged[UART_HOST_RX_CHUNK];
+    size_t staged_len = 0;
+    size_t staged_pos = 0;
+    sim::Wire::Unit staged_unit;
+};
@@ -0,0 +1,3 @@
+#pragma once
+
+// Host stand-in, the UART pins are set up with uart_set_pin()
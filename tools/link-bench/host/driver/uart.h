@@ -0,0 +1,50 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF UART driver, data goes through the simulated line set up by the harness
+#include "freertos/FreeRTOS.h"
+
+#include <cstddef>
+#include <cstdint>
+
+typedef int esp_err_t;
+#define ESP_OK             0
+#define ESP_ERROR_CHECK(x) ((void)(x))
+#define UART_PIN_NO_CHANGE (-1)
+
+typedef int uart_port_t;
+#define UART_NUM_0 0
+
+enum uart_word_length_t { UART_DATA_8_BITS = 3 };
+enum uart_parity_t { UART_PARITY_DISABLE = 0 };
+enum uart_stop_bits_t { UART_STOP_BITS_1 = 1 };
+enum uart_hw_flowcontrol_t { UART_HW_FLOWCTRL_DISABLE = 0 };
+enum uart_sclk_t { UART_SCLK_DEFAULT = 0 };
+
+struct uart_config_t {
+    int baud_rate;
+    uart_word_length_t data_bits;
+    uart_parity_t parity;
+    uart_stop_bits_t stop_bits;
+    uart_hw_flowcontrol_t flow_ctrl;
+    uint8_t rx_flow_ctrl_thresh;
+    uart_sclk_t source_clk;
+    uint32_t flags;
+};
+
+enum uart_event_type_t { UART_DATA, UART_BREAK, UART_BUFFER_FULL, UART_FIFO_OVF, UART_FRAME_ERR, UART_PARITY_ERR };
+
+struct uart_event_t {
+    uart_event_type_t type;
+    size_t size;
+};
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config);
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num);
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                              QueueHandle_t *uart_queue, int intr_alloc_flags);
+esp_err_t uart_driver_delete(uart_port_t uart_num);
+esp_err_t uart_flush_input(uart_port_t uart_num);
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size);
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait);
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size);
+esp_err_t uart_get_tx_buffer_free_size(uart_port_t uart_num, size_t *size);
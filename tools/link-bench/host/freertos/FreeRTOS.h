@@ -0,0 +1,21 @@
+#pragma once
+
+// Host stand-in for FreeRTOS, one tick is a millisecond of simulated time
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void *QueueHandle_t;
+
+#define portMAX_DELAY     ((TickType_t)0xFFFFFFFF)
+#define pdTRUE            1
+#define pdFALSE           0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdTICKS_TO_MS(t)  ((uint32_t)(t))
+
+QueueHandle_t xQueueCreate(uint32_t length, uint32_t item_size);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticks_to_wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+void vQueueDelete(QueueHandle_t queue);
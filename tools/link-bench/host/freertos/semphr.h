@@ -0,0 +1,13 @@
+#pragma once
+
+// Host stand-in, the harness runs both devices on one thread so the mutexes never block
+#include "freertos/FreeRTOS.h"
+
+typedef void *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore);
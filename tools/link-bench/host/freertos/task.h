@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stand-in, vTaskDelay() runs the rest of the simulation for the delay
+#include "freertos/FreeRTOS.h"
+
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t ticks);
@@ -0,0 +1,153 @@
+/**
+ * @file host.cpp
+ * @brief Host implementations of the Pico UART driver and the ESP-IDF UART and FreeRTOS functions used by the
+ * communication code.
+ */
+
+#include "host.hpp"
+
+#include "PicoUart.hpp"
+#include "driver/uart.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace host {
+
+sim::Wire *esp_rx = nullptr;
+sim::Wire *esp_tx = nullptr;
+int esp_write_marker = -1;
+std::function<void(uint32_t)> delay;
+
+} // namespace host
+
+/* PicoUart */
+
+int PicoUart::read(uint8_t *buffer, int size) {
+    int count = 0;
+    while (count < size) {
+        std::span<const uint8_t> region = peek();
+        if (region.empty()) break;
+        const int chunk = std::min<int>(region.size(), size - count);
+        memcpy(buffer + count, region.data(), chunk);
+        consume(chunk);
+        count += chunk;
+    }
+    return count;
+}
+
+std::span<const uint8_t> PicoUart::peek() {
+    if (staged_pos == staged_len) {
+        staged_pos = 0;
+        staged_len = rx_line.read(staged, sizeof(staged), &staged_unit);
+    }
+    return {staged + staged_pos, staged_len - staged_pos};
+}
+
+void PicoUart::consume(size_t count) {
+    staged_pos += count;
+    if (staged_pos == staged_len && staged_unit.end) {
+        if (on_unit) on_unit(staged_unit.marker);
+        staged_unit = {};
+    }
+}
+
+int PicoUart::write(const uint8_t *buffer, int size) {
+    const size_t free = UART_TX_BUFFER_SIZE - std::min<size_t>(UART_TX_BUFFER_SIZE, tx_line.in_transit());
+    const int count = std::min<size_t>(size, free);
+    tx_line.write({buffer, static_cast<size_t>(count)});
+    return count;
+}
+
+// The pending slot of the Pico driver is modelled as a second buffer behind the transmit ring
+bool PicoUart::write_frame(const uint8_t *buffer, size_t size) {
+    if (size > UART_TX_BUFFER_SIZE || !tx_ready()) return false;
+    tx_line.write({buffer, size});
+    return true;
+}
+
+bool PicoUart::tx_ready() const { return tx_line.in_transit() <= UART_TX_BUFFER_SIZE; }
+
+int PicoUart::flush() {
+    uint8_t discard[UART_HOST_RX_CHUNK];
+    int count = 0;
+    while (int len = read(discard, sizeof(discard))) {
+        count += len;
+    }
+    return count;
+}
+
+/* ESP-IDF UART driver */
+
+esp_err_t uart_param_config(uart_port_t, const uart_config_t *) { return ESP_OK; }
+
+esp_err_t uart_set_pin(uart_port_t, int, int, int, int) { return ESP_OK; }
+
+esp_err_t uart_driver_install(uart_port_t, int, int, int, QueueHandle_t *, int) { return ESP_OK; }
+
+esp_err_t uart_driver_delete(uart_port_t) { return ESP_OK; }
+
+esp_err_t uart_flush_input(uart_port_t) {
+    uint8_t discard[64];
+    while (host::esp_rx->read(discard, sizeof(discard))) {}
+    return ESP_OK;
+}
+
+int uart_write_bytes(uart_port_t, const void *src, size_t size) {
+    host::esp_tx->write({static_cast<const uint8_t *>(src), size}, host::esp_write_marker);
+    host::esp_write_marker = -1;
+    return size;
+}
+
+// The harness only calls this once the bytes have arrived, so it doesn't wait
+int uart_read_bytes(uart_port_t, void *buf, uint32_t length, TickType_t) {
+    return host::esp_rx->read(static_cast<uint8_t *>(buf), length);
+}
+
+// The simulated line has no driver buffers, the harness reports its own queue levels
+esp_err_t uart_get_buffered_data_len(uart_port_t, size_t *size) {
+    *size = 0;
+    return ESP_OK;
+}
+
+esp_err_t uart_get_tx_buffer_free_size(uart_port_t, size_t *size) {
+    *size = 512; // UART_RING_BUFFER_SIZE, nothing waits in the transmit buffer
+    return ESP_OK;
+}
+
+/* FreeRTOS */
+
+// Queues are only created by the handler, the harness reads the UART itself
+QueueHandle_t xQueueCreate(uint32_t, uint32_t) { return nullptr; }
+
+BaseType_t xQueueSend(QueueHandle_t, const void *, TickType_t) { return pdFALSE; }
+
+BaseType_t xQueueReceive(QueueHandle_t, void *, TickType_t) { return pdFALSE; }
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t) { return 0; }
+
+void vQueueDelete(QueueHandle_t) {}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return nullptr; }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t, UBaseType_t) { return nullptr; }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+
+void vSemaphoreDelete(SemaphoreHandle_t) {}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t) { return 0; }
+
+TickType_t xTaskGetTickCount() { return sim::now_us() / 1000; }
+
+void vTaskDelay(TickType_t ticks) {
+    if (host::delay) {
+        host::delay(ticks);
+    } else {
+        sim::advance(ticks * 1000ull);
+    }
+}
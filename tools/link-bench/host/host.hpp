@@ -0,0 +1,16 @@
+#pragma once
+
+#include "wire.hpp"
+
+#include <cstdint>
+#include <functional>
+
+// Connects the ESP-IDF and FreeRTOS stand-ins to the simulation
+namespace host {
+
+extern sim::Wire *esp_rx;                   // Line the ESP UART reads from
+extern sim::Wire *esp_tx;                   // Line the ESP UART writes to
+extern int esp_write_marker;                // Marker for the next uart_write_bytes(), -1 for none
+extern std::function<void(uint32_t)> delay; // Runs the simulation for the given milliseconds in vTaskDelay()
+
+} // namespace host
@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stand-in for the parts of the Pico SDK used by CommBridge
+#include "pico/time.h"
+
+// Busy waits let the simulated line make progress
+inline void tight_loop_contents() { sim::advance(10); }
@@ -0,0 +1,13 @@
+#pragma once
+
+// Host stand-in for the Pico SDK time functions, time comes from the simulated clock
+#include "wire.hpp"
+
+#include <cstdint>
+
+typedef uint64_t absolute_time_t;
+
+inline absolute_time_t get_absolute_time() { return sim::now_us(); }
+inline uint32_t to_ms_since_boot(absolute_time_t t) { return t / 1000; }
+inline uint64_t time_us_64() { return sim::now_us(); }
+inline void sleep_ms(uint32_t ms) { sim::advance(ms * 1000ull); }
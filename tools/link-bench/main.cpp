@@ -0,0 +1,424 @@
+/**
+ * @file main.cpp
+ * @brief Host benchmark of the Pico <-> ESP UART link, end to end.
+ * @details The Pico side runs the real CommBridge. The ESP side runs the real EspPicoCommHandler and reads the UART
+ * with extract_msg_from_uart_buffer() like uart_read_task does. The two are connected by simulated lines paced at the
+ * baud rate, with injected byte errors. Time is simulated, so a run is repeatable for a seed and much faster than real
+ * time. The Pico sends a mix of command status, diagnostics and picture messages, the ESP acknowledges each one and
+ * sends instructions in between. Build and run with:
+ *   cmake -S tools/link-bench -B build-link && cmake --build build-link && ./build-link/link-bench --errors 1e-4
+ */
+
+#include "commbridge.hpp"
+#include "defines.hpp"
+#include "espPicoUartCommHandler.hpp"
+#include "host.hpp"
+#include "wire.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t STEP_US = 100;               // Resolution of the simulation
+constexpr size_t ESP_FIFO_THRESHOLD = 120;      // Received bytes that raise a UART_DATA event on the ESP
+constexpr uint64_t ESP_RX_TIMEOUT_CHARS = 10;   // Idle character times that raise a UART_DATA event on the ESP
+constexpr uint64_t ESP_READ_WAIT_US = 100'000;  // uart_read_task waits this long for a full buffer
+constexpr uint64_t STATUS_RETRY_US = 1'000'000; // The Pico resends its device status until the ESP answers
+constexpr uint64_t DRAIN_US = 30'000'000;       // Time allowed for the last messages after everything was sent
+constexpr uint64_t SIMULATION_LIMIT_US = 3600'000'000ull;
+
+struct Options {
+    uint32_t baud = 115200;
+    double errors = 0.0;         // Probability of a byte being corrupted
+    int messages = 1000;         // Messages sent by the Pico
+    int instructions_every = 10; // The ESP sends instructions after every n messages from the Pico, 0 disables
+    double rate = 0.0;           // Messages per second offered by the Pico, 0 sends as fast as the link allows
+    int mix[3] = {4, 3, 3};      // Weights of command status, diagnostics and picture messages
+    bool binary = true;
+    bool legacy = false; // The Pico doesn't advertise capabilities, so the link is ASCII stop-and-wait
+    uint32_t seed = 1;
+};
+
+/**
+ * @brief Delivery bookkeeping for one direction.
+ * @details Every message carries a unique id, so losses, duplicates and reordering are visible to the receiver.
+ */
+struct Direction {
+    std::vector<uint64_t> sent_at; // Index is the message id - 1
+    std::vector<bool> delivered;
+    int delivered_count = 0;
+    int duplicates = 0;
+    int reordered = 0;
+    int last_id = 0;
+    uint64_t last_delivery = 0;
+    std::vector<double> latency_ms;
+
+    int send() {
+        sent_at.push_back(sim::now_us());
+        delivered.push_back(false);
+        return sent_at.size();
+    }
+
+    void receive(int id) {
+        if (id < 1 || id > static_cast<int>(sent_at.size())) return;
+        if (delivered[id - 1]) {
+            ++duplicates;
+            return;
+        }
+        if (id < last_id) ++reordered;
+        last_id = std::max(last_id, id);
+        delivered[id - 1] = true;
+        ++delivered_count;
+        last_delivery = sim::now_us();
+        latency_ms.push_back((sim::now_us() - sent_at[id - 1]) / 1000.0);
+    }
+
+    bool complete() const { return delivered_count == static_cast<int>(sent_at.size()); }
+};
+
+double percentile(std::vector<double> samples, double p) {
+    if (samples.empty()) return 0.0;
+    std::sort(samples.begin(), samples.end());
+    return samples[std::min(samples.size() - 1, static_cast<size_t>(p * (samples.size() - 1) + 0.5))];
+}
+
+void print_percentiles(const char *name, const std::vector<double> &samples) {
+    std::printf("%-22s p50 %7.1f  p90 %7.1f  p99 %7.1f  max %7.1f ms  (%zu samples)\n", name,
+                percentile(samples, 0.5), percentile(samples, 0.9), percentile(samples, 0.99),
+                percentile(samples, 1.0), samples.size());
+}
+
+/**
+ * @class Bench
+ * @brief Runs both devices on the simulated clock and collects the results.
+ */
+class Bench {
+  public:
+    explicit Bench(const Options &options);
+    void run();
+    void report() const;
+
+  private:
+    void step();
+    void pico_poll();
+    void pico_handle(const msg::Record &rec);
+    void pico_generate();
+    void esp_poll();
+    void esp_read();
+    void esp_route(const msg::Record &rec);
+    void esp_generate();
+
+    Options options;
+    std::mt19937 rng;
+    sim::Wire pico_to_esp;
+    sim::Wire esp_to_pico;
+
+    // Pico
+    std::shared_ptr<PicoUart> uart;
+    std::shared_ptr<MessageQueue> queue;
+    CommBridge bridge;
+    bool pico_ready = false; // ESP device status received
+    bool waiting = false;    // Waiting for the ESP to acknowledge a message, like Controller::waiting_for_response
+    size_t queue_seen = 0;   // Queue size after the previous received write
+    uint64_t status_due = 0;
+    uint64_t next_due = 0;
+    uint64_t start = 0;
+    uint64_t last_send = 0;
+
+    // ESP
+    EspPicoCommHandler esp;
+    bool esp_ready = false;   // Pico device status received
+    bool esp_reading = false; // uart_read_task is waiting in uart_read_bytes()
+    bool esp_sending = false; // The ESP is blocked in send_msg()
+    uint64_t esp_read_deadline = 0;
+    uint64_t esp_serviced = 0;
+    int esp_decode_errors = 0;
+
+    Direction to_esp;
+    Direction to_pico;
+    std::vector<double> ack_rtt_ms;
+};
+
+Bench::Bench(const Options &options)
+    : options(options), rng(options.seed), pico_to_esp(options.baud, options.errors, options.seed * 2 + 1),
+      esp_to_pico(options.baud, options.errors, options.seed * 2 + 2),
+      uart(std::make_shared<PicoUart>(esp_to_pico, pico_to_esp)), queue(std::make_shared<MessageQueue>()),
+      bridge(uart, queue) {
+    host::esp_rx = &pico_to_esp;
+    host::esp_tx = &esp_to_pico;
+    host::delay = [this](uint32_t ms) {
+        const uint64_t end = sim::now_us() + ms * 1000ull;
+        while (sim::now_us() < end) step();
+    };
+    bridge.allow_binary(options.binary);
+
+    // Each ESP write is one frame, an ACK is attributed to the message it answers if it reaches the Pico queue
+    uart->on_unit = [this](int marker) {
+        if (marker > 0 && queue->size() > queue_seen) {
+            ack_rtt_ms.push_back((sim::now_us() - to_esp.sent_at[marker - 1]) / 1000.0);
+        }
+        queue_seen = queue->size();
+    };
+}
+
+void Bench::run() {
+    while (sim::now_us() < SIMULATION_LIMIT_US) {
+        step();
+        if (static_cast<int>(to_esp.sent_at.size()) < options.messages) continue;
+        if (to_esp.complete() && to_pico.complete() && !waiting && pico_to_esp.idle() && esp_to_pico.idle()) break;
+        if (sim::now_us() - last_send > DRAIN_US) break;
+    }
+}
+
+void Bench::step() {
+    pico_poll();
+    pico_generate();
+    esp_poll();
+    esp_generate();
+    sim::advance(STEP_US);
+}
+
+/* Pico, does what Controller does with CommBridge */
+
+void Bench::pico_poll() {
+    queue_seen = queue->size();
+    bridge.read_and_parse(1, true);
+    while (const msg::Record *rec = queue->front()) {
+        pico_handle(*rec);
+        queue->pop();
+    }
+}
+
+void Bench::pico_handle(const msg::Record &rec) {
+    switch (rec.type) {
+        case msg::DEVICE_STATUS: {
+            int capabilities = msg::CAP_NONE;
+            if (!options.legacy && rec.count >= 2) rec.field_to_int(1, capabilities);
+            bridge.set_peer_capabilities(capabilities);
+            bridge.send(msg::response(true));
+            if (!pico_ready) start = sim::now_us();
+            pico_ready = true;
+            break;
+        }
+        case msg::INSTRUCTIONS: {
+            int id = 0;
+            if (rec.field_to_int(1, id)) to_pico.receive(id);
+            bridge.send(msg::response(true));
+            break;
+        }
+        case msg::RESPONSE:
+            waiting = false;
+            break;
+        default:
+            break;
+    }
+}
+
+void Bench::pico_generate() {
+    const uint64_t now = sim::now_us();
+    if (!pico_ready) {
+        if (now >= status_due) {
+            bridge.send(options.legacy ? msg::device_status(true) : msg::device_status(true, bridge.capabilities()));
+            status_due = now + STATUS_RETRY_US;
+        }
+        return;
+    }
+    if (waiting) {
+        if (!bridge.ready_to_send()) return;
+        waiting = false; // The ESP didn't respond, carry on like the controller does
+    }
+    if (static_cast<int>(to_esp.sent_at.size()) >= options.messages) return;
+    if (options.rate > 0 && now < next_due) return;
+    if (!bridge.can_send()) return;
+
+    std::discrete_distribution<int> pick(std::begin(options.mix), std::end(options.mix));
+    const int id = to_esp.send();
+    msg::Message message;
+    switch (pick(rng)) {
+        case 0:
+            message = msg::cmd_status(id, 1, 1700000000 + id);
+            break;
+        case 1:
+            message = msg::diagnostics(1, std::to_string(id) + " motor calibration finished");
+            break;
+        default:
+            message = msg::picture(id);
+            break;
+    }
+    bridge.send(message);
+    last_send = now;
+    next_due = (next_due == 0 ? now : next_due) + (options.rate > 0 ? 1e6 / options.rate : 0);
+    if (message.type == msg::PICTURE || !bridge.sequencing()) waiting = true;
+}
+
+/* ESP, does what uart_read_task and handle_uart_data_task do with EspPicoCommHandler */
+
+void Bench::esp_poll() {
+    const uint64_t now = sim::now_us();
+    const size_t available = pico_to_esp.available();
+    if (!esp_reading && available > 0 &&
+        (available >= ESP_FIFO_THRESHOLD ||
+         now - pico_to_esp.newest_arrival_us() >= ESP_RX_TIMEOUT_CHARS * pico_to_esp.byte_time_us())) {
+        esp_reading = true;
+        esp_read_deadline = now + ESP_READ_WAIT_US;
+    }
+    if (esp_reading && (available >= UART_RING_BUFFER_SIZE - 1 || now >= esp_read_deadline)) {
+        esp_reading = false;
+        esp_read();
+        esp.service_link();
+        esp_serviced = now;
+    } else if (!esp_reading && now - esp_serviced >= LINK_SERVICE_PERIOD * 1000) {
+        esp.service_link();
+        esp_serviced = now;
+    }
+}
+
+void Bench::esp_read() {
+    char data[UART_RING_BUFFER_SIZE];
+    size_t len = uart_read_bytes(esp.get_uart_num(), data, sizeof(data) - 1, pdMS_TO_TICKS(100));
+    data[len] = '\0';
+
+    UartReceivedData received;
+    msg::Record record;
+    int return_code = extract_msg_from_uart_buffer(data, &len, &received);
+    while (return_code == 0) {
+        if (esp.decode_msg(received, record) != 0) {
+            ++esp_decode_errors;
+        } else {
+            if (esp.accept_msg(record)) esp_route(record);
+            while (esp.next_msg(record)) {
+                esp_route(record);
+            }
+        }
+        return_code = extract_msg_from_uart_buffer(data, &len, &received);
+    }
+}
+
+void Bench::esp_route(const msg::Record &rec) {
+    if (esp.get_waiting_for_response()) {
+        esp.check_if_confirmation_msg(rec);
+        return;
+    }
+    int id = 0;
+    switch (rec.type) {
+        case msg::DEVICE_STATUS: {
+            int capabilities = msg::CAP_NONE;
+            if (rec.count >= 2) rec.field_to_int(1, capabilities);
+            esp.set_peer_capabilities(capabilities);
+            // The firmware waits for the ACK of its answer, the benchmark doesn't block on it
+            std::string str;
+            convert_to_string(msg::device_status(true, esp.get_capabilities()), str);
+            esp.send_data(str.data(), str.size());
+            esp_ready = true;
+            return;
+        }
+        case msg::CMD_STATUS:
+        case msg::PICTURE:
+            rec.field_to_int(0, id);
+            break;
+        case msg::DIAGNOSTICS:
+            id = std::atoi(std::string(rec.field(1)).c_str());
+            break;
+        default:
+            return;
+    }
+    to_esp.receive(id);
+    host::esp_write_marker = id;
+    esp.send_ACK_msg(true);
+}
+
+void Bench::esp_generate() {
+    if (!esp_ready || esp_sending || options.instructions_every == 0) return;
+    const size_t due = to_esp.sent_at.size() / options.instructions_every;
+    if (to_pico.sent_at.size() >= due) return;
+    esp_sending = true;
+    const int id = to_pico.send();
+    esp.send_msg(msg::instructions(2, id, 1)); // Blocks while the link window is full
+    esp_sending = false;
+}
+
+void Bench::report() const {
+    const double seconds = (std::max(to_esp.last_delivery, to_pico.last_delivery) - start) / 1e6;
+    std::printf("%u baud, byte error rate %g, %s, %s\n", options.baud, options.errors,
+                bridge.binary_framing() ? "binary framing" : "ASCII framing",
+                bridge.sequencing() ? "sequenced" : "stop-and-wait");
+    for (const auto &[name, dir] : {std::pair{"Pico -> ESP", &to_esp}, std::pair{"ESP -> Pico", &to_pico}}) {
+        const int sent = dir->sent_at.size();
+        std::printf("%s: sent %d, delivered %d, lost %.2f %%, duplicates %d, reordered %d\n", name, sent,
+                    dir->delivered_count, sent ? 100.0 * (sent - dir->delivered_count) / sent : 0.0,
+                    dir->duplicates, dir->reordered);
+    }
+    std::printf("Throughput: %.1f messages/s over %.2f s\n",
+                seconds > 0 ? (to_esp.delivered_count + to_pico.delivered_count) / seconds : 0.0, seconds);
+    print_percentiles("Delivery Pico -> ESP:", to_esp.latency_ms);
+    print_percentiles("Delivery ESP -> Pico:", to_pico.latency_ms);
+    print_percentiles("ACK round trip:", ack_rtt_ms);
+    std::printf("Wire: %llu bytes Pico -> ESP, %llu bytes ESP -> Pico, %llu corrupted, %d ESP decode errors\n",
+                static_cast<unsigned long long>(pico_to_esp.bytes()),
+                static_cast<unsigned long long>(esp_to_pico.bytes()),
+                static_cast<unsigned long long>(pico_to_esp.corrupted() + esp_to_pico.corrupted()),
+                esp_decode_errors);
+}
+
+void usage(const char *name) {
+    std::printf("Usage: %s [options]\n"
+                "  --baud N           Baud rate (115200)\n"
+                "  --errors P         Probability of a corrupted byte (0)\n"
+                "  --messages N       Messages sent by the Pico (1000)\n"
+                "  --rate N           Messages per second offered by the Pico, 0 for as fast as possible (0)\n"
+                "  --mix C,D,P        Weights of command status, diagnostics and picture messages (4,3,3)\n"
+                "  --instructions N   The ESP sends instructions after every N Pico messages, 0 disables (10)\n"
+                "  --ascii            Don't negotiate binary framing\n"
+                "  --legacy           Don't advertise capabilities, ASCII stop-and-wait\n"
+                "  --seed N           Seed for the traffic mix and the byte errors (1)\n",
+                name);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!std::strcmp(arg, "--ascii")) {
+            options.binary = false;
+        } else if (!std::strcmp(arg, "--legacy")) {
+            options.legacy = true;
+        } else if (value && !std::strcmp(arg, "--baud")) {
+            options.baud = std::atoi(value), ++i;
+        } else if (value && !std::strcmp(arg, "--errors")) {
+            options.errors = std::atof(value), ++i;
+        } else if (value && !std::strcmp(arg, "--messages")) {
+            options.messages = std::atoi(value), ++i;
+        } else if (value && !std::strcmp(arg, "--rate")) {
+            options.rate = std::atof(value), ++i;
+        } else if (value && !std::strcmp(arg, "--instructions")) {
+            options.instructions_every = std::atoi(value), ++i;
+        } else if (value && !std::strcmp(arg, "--seed")) {
+            options.seed = std::atoi(value), ++i;
+        } else if (value && !std::strcmp(arg, "--mix") &&
+                   std::sscanf(value, "%d,%d,%d", &options.mix[0], &options.mix[1], &options.mix[2]) == 3) {
+            ++i;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.baud == 0 || options.messages <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Bench bench(options);
+    bench.run();
+    bench.report();
+    return 0;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file wire.cpp
+ * @brief Simulated clock and UART line for the link benchmark.
+ */
+
+#include "wire.hpp"
+
+#include <algorithm>
+
+namespace sim {
+
+namespace {
+uint64_t clock_us = 0;
+} // namespace
+
+uint64_t now_us() { return clock_us; }
+
+void advance(uint64_t us) { clock_us += us; }
+
+/**
+ * @brief Constructs a line.
+ *
+ * @param baud Baud rate, a byte takes 10 bit times.
+ * @param error_rate Probability of a byte being corrupted.
+ * @param seed Seed for the error injection.
+ */
+Wire::Wire(uint32_t baud, double error_rate, uint32_t seed)
+    : byte_time(std::max<uint64_t>(1, 10'000'000ull / baud)), error_rate(error_rate), rng(seed) {}
+
+/**
+ * @brief Puts bytes on the line.
+ *
+ * @param data The bytes to send.
+ * @param marker Marker for the last byte, -1 for none.
+ */
+void Wire::write(std::span<const uint8_t> data, int marker) {
+    std::bernoulli_distribution corrupt(error_rate);
+    uint64_t time = std::max(line_free, now_us());
+    for (size_t i = 0; i < data.size(); ++i) {
+        uint8_t value = data[i];
+        if (corrupt(rng)) {
+            value ^= 1 << (rng() % 8);
+            ++corrupted_count;
+        }
+        time += byte_time;
+        const bool last = i + 1 == data.size();
+        line.push_back({time, value, last, last ? marker : -1});
+    }
+    line_free = time;
+    byte_count += data.size();
+}
+
+/**
+ * @brief Takes bytes that have arrived off the line.
+ *
+ * @param buffer Destination for the bytes.
+ * @param size Maximum number of bytes to take.
+ * @param unit If set, reading stops after the last byte of a write and the write is reported here.
+ * @return size_t Number of bytes taken.
+ */
+size_t Wire::read(uint8_t *buffer, size_t size, Unit *unit) {
+    if (unit) *unit = {};
+    size_t count = 0;
+    while (count < size && !line.empty() && line.front().arrival <= now_us()) {
+        const Byte byte = line.front();
+        line.pop_front();
+        buffer[count++] = byte.value;
+        if (unit && byte.unit_end) {
+            *unit = {true, byte.marker};
+            break;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Returns the number of bytes that have arrived and haven't been read.
+ */
+size_t Wire::available() const {
+    size_t count = 0;
+    for (const Byte &byte : line) {
+        if (byte.arrival > now_us()) break;
+        ++count;
+    }
+    return count;
+}
+
+/**
+ * @brief Returns the number of bytes written that haven't arrived yet.
+ */
+size_t Wire::in_transit() const { return line.size() - available(); }
+
+/**
+ * @brief Returns the arrival time of the newest byte that has arrived and hasn't been read, 0 if there is none.
+ */
+uint64_t Wire::newest_arrival_us() const {
+    uint64_t newest = 0;
+    for (const Byte &byte : line) {
+        if (byte.arrival > now_us()) break;
+        newest = byte.arrival;
+    }
+    return newest;
+}
+
+} // namespace sim
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <span>
+
+namespace sim {
+
+uint64_t now_us();
+void advance(uint64_t us);
+
+/**
+ * @class Wire
+ * @brief One direction of a simulated UART line.
+ * @details Written bytes are shifted out one character time (10 bits) apart after the bytes already on the line.
+ * Each byte is corrupted with the configured probability by flipping one of its bits. Every write() is a unit and the
+ * last byte of a unit can carry a marker, so the receiving side can tell which write a byte completed.
+ */
+class Wire {
+  public:
+    struct Unit {
+        bool end = false; // The last byte of a write was read
+        int marker = -1;  // Marker of that write
+    };
+
+    Wire(uint32_t baud, double error_rate, uint32_t seed);
+
+    void write(std::span<const uint8_t> data, int marker = -1);
+    size_t read(uint8_t *buffer, size_t size, Unit *unit = nullptr);
+    size_t available() const;
+    size_t in_transit() const;
+    uint64_t newest_arrival_us() const;
+    bool idle() const { return line.empty(); }
+    uint64_t byte_time_us() const { return byte_time; }
+    uint64_t bytes() const { return byte_count; }
+    uint64_t corrupted() const { return corrupted_count; }
+
+  private:
+    struct Byte {
+        uint64_t arrival;
+        uint8_t value;
+        bool unit_end;
+        int marker;
+    };
+
+    std::deque<Byte> line;
+    uint64_t byte_time;
+    uint64_t line_free = 0; // Time the last written byte has been shifted out
+    double error_rate;
+    std::mt19937 rng;
+    uint64_t byte_count = 0;
+    uint64_t corrupted_count = 0;
+};
+
+} // namespace sim